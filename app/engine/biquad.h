@@ -1,6 +1,8 @@
 #pragma once
 #include <cmath>
 
+#include "app/engine/filter_design.h"
+
 namespace recorder
 {
 
@@ -17,7 +19,7 @@ public:
     {
         centerFrequency_ = centerFrequency;
         Q_ = Q;
-        gain_ = std::pow(10, gainDB / 20.0); // Convert gain from dB to linear scale
+        gainDB_ = gainDB;
 
         UpdateFilter();
     }
@@ -39,31 +41,23 @@ public:
 protected:
     void UpdateFilter()
     {
-        float omega = 2 * M_PI * centerFrequency_ / sampleRate_;
-        float alpha = sin(omega) / (2 * Q_);
-        float A = gain_;
-
-        b0_ = 1 + alpha * A;
-        b1_ = -2 * cos(omega);
-        b2_ = 1 - alpha * A;
-        a0_ = 1 + alpha / A;
-        a1_ = -2 * cos(omega);
-        a2_ = 1 - alpha / A;
+        // Peaking EQ, gainDB_ at the center frequency
+        SOSCoefficients c =
+            design::Peaking(centerFrequency_, Q_, gainDB_, sampleRate_);
 
-        // Scaling coefficients for unity gain at the center frequency
-        b0_ /= a0_;
-        b1_ /= a0_;
-        b2_ /= a0_;
-        a1_ /= a0_;
-        a2_ /= a0_;
+        b0_ = c.b[0];
+        b1_ = c.b[1];
+        b2_ = c.b[2];
+        a1_ = c.a[0];
+        a2_ = c.a[1];
     }
 
     float sampleRate_;
     float centerFrequency_;
     float Q_;
-    float gain_;
+    float gainDB_;
 
-    float a0_, a1_, a2_;
+    float a1_, a2_;
     float b0_, b1_, b2_;
     float x1_, x2_;
     float y1_, y2_;
@@ -4,6 +4,7 @@
 #include <algorithm>
 
 #include "app/engine/envelope_follower.h"
+#include "util/fast_math.h"
 
 namespace recorder
 {
@@ -29,12 +30,23 @@ public:
     float Process(float in)
     {
         float envelope = follower_.Process(in * pregain_);
-        float sense = 20 * std::log10(envelope);
+        float sense = 20 * fast::Log10(envelope);
 
         float gain = Compression(sense);
-        // TODO: can probably use a rougher exponential approximation since gain
-        // is usually small
-        return in * std::pow(10.0, gain / 20);
+        return in * fast::Pow10(gain / 20);
+    }
+
+    // For running the gain computer at control rate: Track() every sample,
+    // and Gain() once per block for the gain to apply across the next one
+    void Track(float in)
+    {
+        follower_.Process(in * pregain_);
+    }
+
+    float Gain(void)
+    {
+        float gain = Compression(20 * fast::Log10(follower_.level()));
+        return fast::Pow10(gain / 20);
     }
 
 protected:
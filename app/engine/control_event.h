@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+#include "util/fifo.h"
+
+namespace recorder
+{
+
+// A change of the synth's controls, timed in audio callbacks. The synth
+// renders one sample per callback, so this is sample-accurate.
+struct ControlEvent
+{
+    enum Type : uint8_t
+    {
+        TYPE_KEY_ON,
+        TYPE_KEY_OFF,
+        TYPE_STRUM,
+        TYPE_CHORD,
+    };
+
+    // Callback count (Analog::callbacks()) the event applies at
+    uint32_t time;
+    Type type;
+    // Key, strum position or chord index
+    uint8_t value;
+};
+
+// Carries control events from the main loop to the audio callback, which
+// applies each one at the callback it's timed for. The main loop times
+// events a fixed delay after the input changed, which hides how long it
+// took to wake up and notice, so the latency stays constant; an event that
+// still arrives late applies at once.
+class ControlQueue
+{
+public:
+    static constexpr uint32_t kSize = 64;
+
+    void Init(void)
+    {
+        fifo_.Init();
+    }
+
+    // Main loop: returns false if the queue is full
+    bool Post(ControlEvent::Type type, uint8_t value, uint32_t time)
+    {
+        return fifo_.Push({time, type, value});
+    }
+
+    // Audio callback: pops the next event due at or before callback `now`
+    bool Next(uint32_t now, ControlEvent& event)
+    {
+        if (!fifo_.Peek(event) || int32_t(event.time - now) > 0)
+        {
+            return false;
+        }
+
+        fifo_.Pop();
+        return true;
+    }
+
+protected:
+    Fifo<ControlEvent, kSize> fifo_;
+};
+
+}
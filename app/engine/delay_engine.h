@@ -8,14 +8,27 @@
 #include "app/engine/compressor.h"
 #include "app/engine/envelope_follower.h"
 #include "app/engine/one_pole.h"
+#include "util/sample_storage.h"
 
 namespace recorder
 {
 
-class DelayEngine
+// Feedback delay with a compressor in the feedback path, and up to kMaxTaps
+// extra read taps mixed into the output.
+//
+// Audio runs in spans of up to kControlBlock samples. Between spans the
+// controls update: the smoothed delay time, the feedback amount and the
+// compressor's gain, which then ramp linearly across the next block; the
+// compressor's detector still runs every sample. A span also stops at the
+// end of the buffer, so writes never wrap inside one.
+//
+// Storage is one of the formats in util/sample_storage.h
+template <typename Storage, uint32_t kMaxTaps = 4>
+class BasicDelayEngine
 {
 public:
-    void Init(void)
+    // Feedback path compressor settings
+    struct Tuning
     {
         float threshold_dB = 1;
         float ratio = 1.05;
@@ -23,54 +36,93 @@ public:
         float attack_ms = 5;
         float decay_ms = 250;
         float hold_ms = 100;
-        compressor_.Init(threshold_dB, ratio, softness,
-            attack_ms, decay_ms, hold_ms, kAudioSampleRate);
+    };
 
-        attack_ms = 10;
-        decay_ms = kMinDelay * 1000;
-        hold_ms = kMaxDelay * 1000;
-        follower_.Init(attack_ms, decay_ms, hold_ms, kAudioSampleRate);
+    // An extra read tap at `ratio` times the delay time, added to the output
+    // (not the feedback) at `gain`: taps at 1/4, 1/2 and 3/4 make a multitap
+    // rhythm, and alternating their signs bounces it. Taps are clamped
+    // between a control block and the buffer's length.
+    struct Tap
+    {
+        float ratio;
+        float gain;
+    };
 
-        delay_time_lpf_.Init(10, kAudioSampleRate);
+    // 1 ms at 16 kHz
+    static constexpr uint32_t kControlBlock = 16;
+
+    void Init(void)
+    {
+        Init(Tuning());
+    }
+
+    void Init(const Tuning& tuning)
+    {
+        compressor_.Init(tuning.threshold_dB, tuning.ratio, tuning.softness,
+            tuning.attack_ms, tuning.decay_ms, tuning.hold_ms,
+            kAudioSampleRate);
+
+        follower_.Init(kTrailEnvelope);
+        delay_time_lpf_.Init(kDelayTimeLpf);
+        num_taps_ = 0;
 
         Reset();
     }
 
     void Reset(void)
     {
-        for (uint32_t i = 0; i < kBufferSize; i++)
-        {
-            buffer_[i] = 0;
-        }
+        std::fill(buffer_, buffer_ + kBufferSize, Storage::Encode(0));
 
         write_head_ = 0;
         compressor_.Reset();
         follower_.Reset();
         delay_time_lpf_.Reset();
         interpolator_history_ = 0;
+
+        count_ = 0;
+        delay_samples_ = kMinDelay * kAudioSampleRate;
+        delay_step_ = 0;
+        feedback_ = 0;
+        feedback_step_ = 0;
+        gain_ = 1;
+        gain_step_ = 0;
+        output_peak_ = 0;
     }
 
-    float Process(float input, float delay, float feedback)
+    void SetTaps(const Tap* taps, uint32_t count)
     {
-        delay *= delay;
-        delay = delay_time_lpf_.Process(delay);
-        float time = kMinDelay + delay * (kMaxDelay - kMinDelay);
-        time = std::clamp<float>(time, kMinDelay, kMaxDelay);
-        float delay_samples = time * kAudioSampleRate;
+        num_taps_ = std::min(count, kMaxTaps);
+        std::copy(taps, taps + num_taps_, taps_);
+    }
 
-        uint32_t i_a = ReadIndex(static_cast<uint32_t>(delay_samples));
-        uint32_t i_b = ReadIndex(static_cast<uint32_t>(delay_samples + 1));
-        float frac = delay_samples - static_cast<uint32_t>(delay_samples);
-        float output = AllpassInterpolator(buffer_[i_a], buffer_[i_b], frac);
+    float Process(float input, float delay, float feedback)
+    {
+        float output;
+        Process(&input, &output, 1, delay, feedback);
+        return output;
+    }
 
-        feedback = kMaxFeedback * std::clamp<float>(feedback, 0, 1);
-        output = std::clamp<float>(input + output * feedback, -2, 2);
-        buffer_[write_head_] = compressor_.Process(output);
-        write_head_ = (write_head_ + 1) % kBufferSize;
+    // `in` and `out` may be the same buffer. The controls are read once per
+    // control block.
+    void Process(const float* in, float* out, uint32_t size, float delay,
+        float feedback)
+    {
+        while (size)
+        {
+            if (count_ == 0)
+            {
+                UpdateControls(delay, feedback);
+                count_ = kControlBlock;
+            }
 
-        output *= 0.5;
-        follower_.Process(output);
-        return output;
+            uint32_t length = std::min({size, count_, kBufferSize - write_head_});
+            Render(in, out, length);
+            in += length;
+            out += length;
+            size -= length;
+            count_ -= length;
+            write_head_ = (write_head_ + length) % kBufferSize;
+        }
     }
 
     bool audible(void)
@@ -83,19 +135,110 @@ protected:
     static constexpr float kMaxDelay = 1.0;
     static constexpr float kMaxFeedback = 1.0;
     static constexpr float kTrailThreshold = std::pow(10.0, -60.0 / 20.0);
+    static constexpr float kControlRate = kAudioSampleRate / kControlBlock;
+    // 10 ms attack, and decay and hold over the delay's range
+    static constexpr auto kTrailEnvelope = design::Envelope(10,
+        kMinDelay * 1000, kMaxDelay * 1000, kControlRate);
+    static constexpr auto kDelayTimeLpf = design::OnePole(10, kControlRate);
 
     static constexpr uint32_t kBufferSize = std::round(std::exp2(std::ceil(
         std::log2(kMaxDelay * kAudioSampleRate + 1))));
-    float buffer_[kBufferSize];
+    static constexpr float kMaxTapDelay = kBufferSize - 2;
+    static_assert(kMinDelay * kAudioSampleRate > kControlBlock,
+        "Render() reads from before the span it writes");
+    typename Storage::Sample buffer_[kBufferSize];
     uint32_t write_head_;
     Compressor compressor_;
     EnvelopeFollower follower_;
     OnePoleLowpass delay_time_lpf_;
     float interpolator_history_;
+    Tap taps_[kMaxTaps];
+    uint32_t num_taps_;
 
-    uint32_t ReadIndex(uint32_t offset)
+    // Samples left in the control block, and the ramps across it
+    uint32_t count_;
+    float delay_samples_;
+    float delay_step_;
+    float feedback_;
+    float feedback_step_;
+    float gain_;
+    float gain_step_;
+    // For the trail follower, which runs at control rate
+    float output_peak_;
+
+    // The delay time's smoother runs at control rate, where it settles on
+    // its target. At audio rate its steps fell below float's resolution
+    // short of it: 0.011 samples short in the playback_pitch render, which
+    // the allpass interpolator turned into a phase shift 61 dB down.
+    void UpdateControls(float delay, float feedback)
     {
-        return (write_head_ + kBufferSize - offset) % kBufferSize;
+        delay = delay_time_lpf_.Process(delay * delay);
+        float time = kMinDelay + delay * (kMaxDelay - kMinDelay);
+        time = std::clamp<float>(time, kMinDelay, kMaxDelay);
+        delay_step_ = (time * kAudioSampleRate - delay_samples_) *
+            (1.f / kControlBlock);
+
+        feedback = kMaxFeedback * std::clamp<float>(feedback, 0, 1);
+        feedback_step_ = (feedback - feedback_) * (1.f / kControlBlock);
+
+        gain_step_ = (compressor_.Gain() - gain_) * (1.f / kControlBlock);
+
+        follower_.Process(output_peak_);
+        output_peak_ = 0;
+    }
+
+    // A span that doesn't wrap the write head. What goes into the buffer is
+    // encoded in one block at the end, as no read reaches into the span:
+    // the delay is longer than a block, and taps are clamped to a block.
+    void Render(const float* in, float* out, uint32_t length)
+    {
+        float write[kControlBlock];
+
+        for (uint32_t i = 0; i < length; i++)
+        {
+            delay_samples_ += delay_step_;
+            feedback_ += feedback_step_;
+            gain_ += gain_step_;
+
+            uint32_t head = write_head_ + i;
+            uint32_t whole = static_cast<uint32_t>(delay_samples_);
+            float frac = delay_samples_ - whole;
+            float delayed = AllpassInterpolator(Read(head - whole),
+                Read(head - whole - 1), frac);
+
+            float output = std::clamp<float>(in[i] + delayed * feedback_, -2, 2);
+            compressor_.Track(output);
+            write[i] = output * gain_;
+
+            for (uint32_t t = 0; t < num_taps_; t++)
+            {
+                output += taps_[t].gain * ReadTap(head, std::clamp<float>(
+                    delay_samples_ * taps_[t].ratio, kControlBlock,
+                    kMaxTapDelay));
+            }
+
+            output *= 0.5;
+            output_peak_ = std::max(output_peak_, std::fabs(output));
+            out[i] = output;
+        }
+
+        Storage::Encode(write, &buffer_[write_head_], length);
+    }
+
+    // The reads wrap per sample (a mask, as kBufferSize is a power of 2),
+    // since they move with the delay time
+    float Read(uint32_t index)
+    {
+        return Storage::Decode(buffer_[index % kBufferSize]);
+    }
+
+    // Linear interpolation, which needs no state per tap
+    float ReadTap(uint32_t head, float delay_samples)
+    {
+        uint32_t whole = static_cast<uint32_t>(delay_samples);
+        float frac = delay_samples - whole;
+        float a = Read(head - whole);
+        return a + (Read(head - whole - 1) - a) * frac;
     }
 
     float AllpassInterpolator(float a, float b, float t)
@@ -113,4 +256,10 @@ protected:
     }
 };
 
+// Half floats halve the buffer to 32 KB, for about 72 dB of SNR against float
+// at any level in delaybench. Q15Storage<2> measures 87 dB at -6 dBFS but 53
+// dB at -40, so its fixed step leaves the quiet end of a decaying echo much
+// coarser.
+using DelayEngine = BasicDelayEngine<HalfStorage>;
+
 }
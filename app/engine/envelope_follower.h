@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <cmath>
 
+#include "app/engine/filter_design.h"
+
 namespace recorder
 {
 
@@ -11,9 +13,14 @@ class EnvelopeFollower
 public:
     void Init(float attack_ms, float decay_ms, float hold_ms, float sample_rate)
     {
-        attack_rate_ = 1 - std::exp(-1000 / (attack_ms * sample_rate));
-        decay_rate_ = 1 - std::exp(-1000 / (decay_ms * sample_rate));
-        hold_samples_ = std::round(hold_ms * sample_rate / 1000);
+        Init(design::Envelope(attack_ms, decay_ms, hold_ms, sample_rate));
+    }
+
+    void Init(const design::EnvelopeCoefficients& coefficients)
+    {
+        attack_rate_ = coefficients.attack;
+        decay_rate_ = coefficients.decay;
+        hold_samples_ = coefficients.hold;
         Reset();
     }
 
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <array>
+
+#include "app/engine/sos.h"
+#include "util/fast_math.h"
+
+// Filter coefficient design. Every function is constexpr, so a filter with
+// fixed settings can take its coefficients from a constant and cost nothing
+// at run time:
+//
+//     static constexpr auto kLowpass = design::Lowpass(1000, 0.707, 16000);
+//
+// The biquad, one-pole and envelope designs are in float with the
+// approximations in util/fast_math.h, so they're cheap enough to use at run
+// time too. The Butterworth and elliptic cascades are in double with
+// <cmath>, which GCC evaluates at compile time; they're meant for constants
+// only.
+namespace recorder::design
+{
+
+struct OnePoleCoefficients
+{
+    float factor;
+};
+
+struct EnvelopeCoefficients
+{
+    float attack;
+    float decay;
+    uint32_t hold;
+};
+
+namespace detail
+{
+
+// 1 - e^-x for x >= 0, without losing the small x to rounding
+constexpr float OneMinusExp(float x)
+{
+    if (x < 0.03f)
+    {
+        return x * (1 - x * (1.f / 2 - x * (1.f / 6 - x * (1.f / 24))));
+    }
+
+    return 1 - fast::Exp(-x);
+}
+
+constexpr SOSCoefficients Normalise(float b0, float b1, float b2, float a0,
+    float a1, float a2)
+{
+    return {{b0 / a0, b1 / a0, b2 / a0}, {a1 / a0, a2 / a0}};
+}
+
+}
+
+// The rate of a one-pole lowpass, y += factor * (x - y), with the time
+// constant 1 / cutoff; note that's not 1 / (2 pi cutoff)
+constexpr OnePoleCoefficients OnePole(float cutoff, float sample_rate)
+{
+    return {detail::OneMinusExp(cutoff / sample_rate)};
+}
+
+// Attack and decay rates for time constants in ms, and the hold in samples
+constexpr EnvelopeCoefficients Envelope(float attack_ms, float decay_ms,
+    float hold_ms, float sample_rate)
+{
+    return {
+        detail::OneMinusExp(1000 / (attack_ms * sample_rate)),
+        detail::OneMinusExp(1000 / (decay_ms * sample_rate)),
+        uint32_t(hold_ms * sample_rate / 1000 + 0.5f),
+    };
+}
+
+// Coefficients of a trapezoidal (zero-delay feedback) state-variable filter,
+// as in Simper, "Linear Trapezoidal Integrated SVF" (2013): g is the
+// prewarped integrator gain and k = 1 / q the damping. They take one Tan()
+// and one division, so they're cheap enough to change every sample.
+struct SvfCoefficients
+{
+    float g;
+    float k;
+    float a1;
+    float a2;
+    float a3;
+};
+
+// `frequency` below the Nyquist frequency
+constexpr SvfCoefficients Svf(float frequency, float q, float sample_rate)
+{
+    float g = fast::Tan((fast::kTwoPi / 2) * frequency / sample_rate);
+    float k = 1 / q;
+    float a1 = 1 / (1 + g * (g + k));
+    return {g, k, a1, g * a1, g * g * a1};
+}
+
+// RBJ Audio EQ Cookbook biquads, normalised so that a0 = 1, with `frequency`
+// and `sample_rate` in Hz. The shelves and the peak take their gain in dB;
+// the shelves have a slope of 1.
+
+constexpr SOSCoefficients Lowpass(float frequency, float q, float sample_rate)
+{
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float alpha = fast::Sin(omega) / (2 * q);
+    return detail::Normalise((1 - cosine) / 2, 1 - cosine, (1 - cosine) / 2,
+        1 + alpha, -2 * cosine, 1 - alpha);
+}
+
+constexpr SOSCoefficients Highpass(float frequency, float q, float sample_rate)
+{
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float alpha = fast::Sin(omega) / (2 * q);
+    return detail::Normalise((1 + cosine) / 2, -(1 + cosine), (1 + cosine) / 2,
+        1 + alpha, -2 * cosine, 1 - alpha);
+}
+
+// 0 dB at the centre frequency
+constexpr SOSCoefficients Bandpass(float frequency, float q, float sample_rate)
+{
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float alpha = fast::Sin(omega) / (2 * q);
+    return detail::Normalise(alpha, 0, -alpha, 1 + alpha, -2 * cosine,
+        1 - alpha);
+}
+
+constexpr SOSCoefficients Notch(float frequency, float q, float sample_rate)
+{
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float alpha = fast::Sin(omega) / (2 * q);
+    return detail::Normalise(1, -2 * cosine, 1, 1 + alpha, -2 * cosine,
+        1 - alpha);
+}
+
+constexpr SOSCoefficients Peaking(float frequency, float q, float gain_dB,
+    float sample_rate)
+{
+    float a = fast::Pow10(gain_dB / 40);
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float alpha = fast::Sin(omega) / (2 * q);
+    return detail::Normalise(1 + alpha * a, -2 * cosine, 1 - alpha * a,
+        1 + alpha / a, -2 * cosine, 1 - alpha / a);
+}
+
+constexpr SOSCoefficients LowShelf(float frequency, float gain_dB,
+    float sample_rate)
+{
+    float a = fast::Pow10(gain_dB / 40);
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    // alpha with a slope of 1, times 2 sqrt(a)
+    float beta = fast::Sin(omega) * std::sqrt(a);
+    return detail::Normalise(
+        a * ((a + 1) - (a - 1) * cosine + beta),
+        2 * a * ((a - 1) - (a + 1) * cosine),
+        a * ((a + 1) - (a - 1) * cosine - beta),
+        (a + 1) + (a - 1) * cosine + beta,
+        -2 * ((a - 1) + (a + 1) * cosine),
+        (a + 1) + (a - 1) * cosine - beta);
+}
+
+constexpr SOSCoefficients HighShelf(float frequency, float gain_dB,
+    float sample_rate)
+{
+    float a = fast::Pow10(gain_dB / 40);
+    float omega = fast::kTwoPi * frequency / sample_rate;
+    float cosine = fast::Cos(omega);
+    float beta = fast::Sin(omega) * std::sqrt(a);
+    return detail::Normalise(
+        a * ((a + 1) + (a - 1) * cosine + beta),
+        -2 * a * ((a - 1) + (a + 1) * cosine),
+        a * ((a + 1) + (a - 1) * cosine - beta),
+        (a + 1) - (a - 1) * cosine + beta,
+        2 * ((a - 1) - (a + 1) * cosine),
+        (a + 1) - (a - 1) * cosine - beta);
+}
+
+namespace detail
+{
+
+// -fsingle-precision-constant would round a literal to float
+inline constexpr double kPi = std::acos(double(-1));
+
+struct Complex
+{
+    double re;
+    double im;
+};
+
+constexpr Complex operator+(Complex a, Complex b)
+{
+    return {a.re + b.re, a.im + b.im};
+}
+
+constexpr Complex operator-(Complex a, Complex b)
+{
+    return {a.re - b.re, a.im - b.im};
+}
+
+constexpr Complex operator*(Complex a, Complex b)
+{
+    return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+}
+
+constexpr Complex operator/(Complex a, Complex b)
+{
+    double d = b.re * b.re + b.im * b.im;
+    return {(a.re * b.re + a.im * b.im) / d, (a.im * b.re - a.re * b.im) / d};
+}
+
+constexpr double Abs(Complex z)
+{
+    return std::sqrt(z.re * z.re + z.im * z.im);
+}
+
+constexpr Complex Sqrt(Complex z)
+{
+    double r = Abs(z);
+    double im = std::sqrt(std::max<double>(0, (r - z.re) / 2));
+    return {std::sqrt(std::max<double>(0, (r + z.re) / 2)), z.im < 0 ? -im : im};
+}
+
+constexpr Complex Cos(Complex z)
+{
+    return {std::cos(z.re) * std::cosh(z.im), -std::sin(z.re) * std::sinh(z.im)};
+}
+
+// -i ln(z + i sqrt(1 - z^2))
+constexpr Complex Acos(Complex z)
+{
+    Complex w = z + Complex{0, 1} * Sqrt(Complex{1, 0} - z * z);
+    return {std::atan2(w.im, w.re), -std::log(Abs(w))};
+}
+
+// Descending Landen moduli of k, for the Jacobi elliptic functions in the
+// form of Orfanidis, "Lecture Notes on Elliptic Filter Design" (2006). They
+// are worked out from the complementary modulus kp, as 1 - k^2 loses it when
+// k is close to 1.
+struct Landen
+{
+    static constexpr uint32_t kSteps = 10;
+    double k[kSteps];
+
+    constexpr Landen(double complement) : k{}
+    {
+        for (uint32_t n = 0; n < kSteps; n++)
+        {
+            double next = (1 - complement) / (1 + complement);
+            complement = 2 * std::sqrt(complement) / (1 + complement);
+            k[n] = next;
+        }
+    }
+};
+
+// Complete elliptic integral of the first kind K(k)
+constexpr double EllipticK(double k, double kp)
+{
+    Landen landen{kp};
+    double product = kPi / 2;
+
+    for (double v : landen.k)
+    {
+        product *= 1 + v;
+    }
+
+    return product;
+}
+
+// cd(u K, k)
+constexpr Complex Cd(Complex u, double k, double kp)
+{
+    Landen landen{kp};
+    Complex w = Cos(u * Complex{kPi / 2, 0});
+
+    for (uint32_t n = Landen::kSteps; n-- > 0;)
+    {
+        w = Complex{1 + landen.k[n], 0} * w /
+            (Complex{1, 0} + Complex{landen.k[n], 0} * w * w);
+    }
+
+    return w;
+}
+
+// u with sn(u K, k) = w
+constexpr Complex InverseSn(Complex w, double k, double kp)
+{
+    Landen landen{kp};
+
+    for (uint32_t n = 0; n < Landen::kSteps; n++)
+    {
+        double previous = (n == 0) ? k : landen.k[n - 1];
+        w = w / (Complex{1, 0} + Sqrt(Complex{1, 0} -
+            w * w * Complex{previous * previous, 0})) *
+            Complex{2 / (1 + landen.k[n]), 0};
+    }
+
+    // sn = cd shifted by a quarter period
+    return Complex{1, 0} - Acos(w) * Complex{2 / kPi, 0};
+}
+
+// A conjugate pair of poles, and of zeros, in the z plane
+struct Pair
+{
+    Complex pole;
+    Complex zero;
+};
+
+// Bilinear transform of an s plane root, with the s plane scaled so that 1
+// maps to `frequency`
+constexpr Complex Bilinear(Complex s, double frequency, double sample_rate)
+{
+    s = s * Complex{std::tan(kPi * frequency / sample_rate), 0};
+    return (Complex{1, 0} + s) / (Complex{1, 0} - s);
+}
+
+// Sections in order of the poles' distance from the origin, each pole pair
+// taking the nearest zeros left, from the outermost in (as scipy's zpk2sos
+// does); unity gain at DC, all in the first section
+template <size_t kSections>
+constexpr std::array<SOSCoefficients, kSections> Cascade(
+    std::array<Pair, kSections> pairs)
+{
+    for (uint32_t i = 0; i < kSections; i++)
+    {
+        for (uint32_t j = i + 1; j < kSections; j++)
+        {
+            if (Abs(pairs[j].pole) < Abs(pairs[i].pole))
+            {
+                std::swap(pairs[i].pole, pairs[j].pole);
+            }
+        }
+    }
+
+    for (uint32_t i = kSections; i-- > 0;)
+    {
+        for (uint32_t j = 0; j < i; j++)
+        {
+            if (Abs(pairs[j].zero - pairs[i].pole) <
+                Abs(pairs[i].zero - pairs[i].pole))
+            {
+                std::swap(pairs[i].zero, pairs[j].zero);
+            }
+        }
+    }
+
+    std::array<SOSCoefficients, kSections> sections{};
+    double gain = 1;
+
+    for (uint32_t i = 0; i < kSections; i++)
+    {
+        Complex p = pairs[i].pole;
+        Complex z = pairs[i].zero;
+        double b1 = -2 * z.re;
+        double b2 = z.re * z.re + z.im * z.im;
+        double a1 = -2 * p.re;
+        double a2 = p.re * p.re + p.im * p.im;
+        gain *= (1 + b1 + b2) / (1 + a1 + a2);
+        sections[i] = {{1, float(b1), float(b2)}, {float(a1), float(a2)}};
+    }
+
+    for (float& b : sections[0].b)
+    {
+        b = float(double(b) / gain);
+    }
+
+    return sections;
+}
+
+}
+
+// The same cascade with its gain spread over the sections for fixed point:
+// each section's output peaks at 0 dB for a full scale sine at the input,
+// and the last keeps the cascade's overall response. The peaks are taken
+// over a grid of frequencies, so they can be a little above 0 dB.
+template <size_t kSections>
+constexpr std::array<SOSCoefficients, kSections> PeakScaled(
+    std::array<SOSCoefficients, kSections> sections)
+{
+    using namespace detail;
+    constexpr uint32_t kGrid = 1024;
+
+    for (uint32_t i = 0; i + 1 < kSections; i++)
+    {
+        double peak = 0;
+
+        for (uint32_t n = 0; n <= kGrid; n++)
+        {
+            double w = kPi * n / kGrid;
+            Complex z1{std::cos(w), -std::sin(w)};
+            Complex z2 = z1 * z1;
+            Complex h{1, 0};
+
+            for (uint32_t j = 0; j <= i; j++)
+            {
+                const SOSCoefficients& s = sections[j];
+                h = h * (Complex{s.b[0], 0} + Complex{s.b[1], 0} * z1 +
+                    Complex{s.b[2], 0} * z2) /
+                    (Complex{1, 0} + Complex{s.a[0], 0} * z1 +
+                    Complex{s.a[1], 0} * z2);
+            }
+
+            peak = std::max(peak, Abs(h));
+        }
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            sections[i].b[k] = float(double(sections[i].b[k]) / peak);
+            sections[i + 1].b[k] = float(double(sections[i + 1].b[k]) * peak);
+        }
+    }
+
+    return sections;
+}
+
+// Butterworth lowpass of an even order, as second-order sections with unity
+// gain at DC, and -3 dB at `cutoff`
+template <uint32_t kOrder>
+constexpr std::array<SOSCoefficients, kOrder / 2> ButterworthLowpass(
+    double cutoff, double sample_rate)
+{
+    static_assert(kOrder > 0 && kOrder % 2 == 0);
+    using namespace detail;
+    std::array<Pair, kOrder / 2> pairs{};
+
+    for (uint32_t i = 0; i < kOrder / 2; i++)
+    {
+        double angle = kPi * (2 * i + kOrder + 1) / (2 * kOrder);
+        Complex pole{std::cos(angle), std::sin(angle)};
+        pairs[i] = {Bilinear(pole, cutoff, sample_rate), {-1, 0}};
+    }
+
+    return Cascade(pairs);
+}
+
+// The lowest order of elliptic lowpass that ripples by no more than
+// `ripple_dB` up to `passband`, and attenuates by `attenuation_dB` from
+// `stopband`, as scipy's ellipord works it out. The stopband must be below
+// the Nyquist frequency.
+constexpr uint32_t EllipticOrder(double passband, double stopband,
+    double ripple_dB, double attenuation_dB, double sample_rate)
+{
+    using namespace detail;
+    double ratio = std::tan(kPi * passband / sample_rate) /
+        std::tan(kPi * stopband / sample_rate);
+    double discrimination = std::sqrt((std::pow(10, ripple_dB / 10) - 1) /
+        (std::pow(10, attenuation_dB / 10) - 1));
+    double order =
+        EllipticK(ratio, std::sqrt(1 - ratio * ratio)) *
+        EllipticK(std::sqrt(1 - discrimination * discrimination),
+            discrimination) /
+        (EllipticK(std::sqrt(1 - ratio * ratio), ratio) *
+            EllipticK(discrimination,
+                std::sqrt(1 - discrimination * discrimination)));
+    return std::ceil(order);
+}
+
+// Elliptic (Cauer) lowpass of an even order, as second-order sections with
+// unity gain at DC: the passband ripples by `ripple_dB` up to `passband`, and
+// the stopband is `attenuation_dB` down, starting as soon as the order
+// allows. Matches scipy's ellip and zpk2sos, with the gain raised by the
+// ripple so that DC is at 0 dB.
+template <uint32_t kOrder>
+constexpr std::array<SOSCoefficients, kOrder / 2> EllipticLowpass(
+    double passband, double ripple_dB, double attenuation_dB,
+    double sample_rate)
+{
+    static_assert(kOrder > 0 && kOrder % 2 == 0);
+    using namespace detail;
+
+    double ep = std::sqrt(std::pow(10, ripple_dB / 10) - 1);
+    double es = std::sqrt(std::pow(10, attenuation_dB / 10) - 1);
+    double k1 = ep / es;
+    double k1p = std::sqrt(1 - k1 * k1);
+
+    // Solve the degree equation for the selectivity k through its nome
+    double q = std::exp(-kPi * EllipticK(k1p, k1) /
+        (kOrder * EllipticK(k1, k1p)));
+    double numerator = 0;
+    double denominator = 1;
+
+    for (uint32_t m = 0; m < 8; m++)
+    {
+        numerator += std::pow(q, m * (m + 1));
+        denominator += (m > 0) ? 2 * std::pow(q, m * m) : 0;
+    }
+
+    double k = 4 * std::sqrt(q) * (numerator / denominator) *
+        (numerator / denominator);
+    double kp = std::sqrt(1 - k * k);
+
+    // Imaginary part of the poles' offset
+    Complex v0 = Complex{0, -1 / double(kOrder)} *
+        InverseSn(Complex{0, 1 / ep}, k1, k1p);
+    std::array<Pair, kOrder / 2> pairs{};
+
+    for (uint32_t i = 0; i < kOrder / 2; i++)
+    {
+        double u = double(2 * i + 1) / kOrder;
+        double zeta = Cd(Complex{u, 0}, k, kp).re;
+        Complex zero{0, 1 / (k * zeta)};
+        Complex pole = Complex{0, 1} * Cd(Complex{u, 0} -
+            Complex{0, 1} * v0, k, kp);
+        pairs[i] = {
+            Bilinear(pole, passband, sample_rate),
+            Bilinear(zero, passband, sample_rate),
+        };
+    }
+
+    return Cascade(pairs);
+}
+
+}
@@ -3,7 +3,9 @@
 
 #include <cstdint>
 #include <cmath>
+#include <algorithm>
 #include "common/config.h"
+#include "app/engine/saturator.h"
 #include "waveform_generator.h"
 
 namespace recorder
@@ -21,6 +23,7 @@ namespace recorder
             note_timer_ = 0;
             voice_.SetWaveform(WaveformGenerator::Waveform::SINE);
             voice_.SetFrequency(0.0f);
+            saturator_.Init(1.5f);
         }
 
         // Start playing the startup jingle
@@ -101,7 +104,7 @@ namespace recorder
 
             // Clamp and pack into oversampling buffer just like SynthEngine
             // give it a little saturation
-            sample = tanh(1.5 * sample);
+            sample = saturator_.Process(sample);
 
             sample = std::clamp(sample, -1.0f, 1.0f);
             sample *= kAudioOSFactor * kAudioOutputLevel;
@@ -154,6 +157,7 @@ namespace recorder
         };
 
         WaveformGenerator voice_;
+        Saturator saturator_;
         bool is_active_ = false;
         bool is_startup_ = true;
         int current_note_ = 0;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace recorder
+{
+
+// Lookahead peak limiter. The input is delayed by two blocks, and the gain
+// is worked out once per block: for the block about to come out it ramps
+// linearly to a target that holds the loudest sample of that block and the
+// next one to the threshold. Both ends of the ramp keep the outgoing block
+// within the threshold, so every sample between them does too, and the gain
+// is already down by the time a transient comes out. Above the threshold the
+// gain recovers towards 1 with the release time.
+//
+// The window always lines up with the blocks, so the max of the last two
+// blocks' peaks is the sliding max over it.
+template <uint32_t kBlockSize>
+class Limiter
+{
+public:
+    // Input to output delay, in samples
+    static constexpr uint32_t kLatency = 2 * kBlockSize;
+
+    void Init(float threshold, float release_time, float sample_rate)
+    {
+        threshold_ = threshold;
+        release_factor_ = std::exp(-float(kBlockSize) /
+            (release_time * sample_rate));
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        std::fill(delay_, delay_ + kLatency, 0.f);
+        position_ = 0;
+        count_ = 0;
+        peak_ = 0;
+        next_peak_ = 0;
+        current_peak_ = 0;
+        gain_ = 1;
+        step_ = 0;
+        delayed_ = 0;
+    }
+
+    float Process(float in)
+    {
+        if (count_ == 0)
+        {
+            StartBlock();
+            count_ = kBlockSize;
+        }
+
+        count_--;
+        delayed_ = delay_[position_];
+        delay_[position_] = in;
+
+        if (++position_ == kLatency)
+        {
+            position_ = 0;
+        }
+
+        current_peak_ = std::max(current_peak_, std::fabs(in));
+
+        gain_ += step_;
+        return delayed_ * gain_;
+    }
+
+    // In place
+    void Process(float* block, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            block[i] = Process(block[i]);
+        }
+    }
+
+    // The last output before the gain, for mixing it back in
+    float delayed(void) const
+    {
+        return delayed_;
+    }
+
+    float gain(void) const
+    {
+        return gain_;
+    }
+
+protected:
+    float delay_[kLatency];
+    uint32_t position_;
+    // Samples left in the current block
+    uint32_t count_;
+    float threshold_;
+    float release_factor_;
+    // Peaks of the block coming out, the one after it, and the one coming in
+    float peak_;
+    float next_peak_;
+    float current_peak_;
+    float gain_;
+    float step_;
+    float delayed_;
+
+    void StartBlock(void)
+    {
+        peak_ = next_peak_;
+        next_peak_ = current_peak_;
+        current_peak_ = 0;
+
+        float peak = std::max(peak_, next_peak_);
+        float limit = peak > threshold_ ? threshold_ / peak : 1;
+        float released = 1 - (1 - gain_) * release_factor_;
+        step_ = (std::min(limit, released) - gain_) * (1.f / kBlockSize);
+    }
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "util/fixed.h"
+
+namespace recorder
+{
+
+// Sums kChannels inputs, each at a gain of its own, such as a bank of voices
+// into one output. Gains are set in float for any sample type.
+template <typename T, uint32_t kChannels>
+class Mixer
+{
+public:
+    void Init(void)
+    {
+        std::fill(gain_, gain_ + kChannels, 0.f);
+    }
+
+    void SetGain(uint32_t channel, float gain)
+    {
+        gain_[channel] = gain;
+    }
+
+    // A sample from each channel, in[0] to in[kChannels - 1]
+    T Process(const T* in)
+    {
+        T sum = 0;
+
+        for (uint32_t i = 0; i < kChannels; i++)
+        {
+            sum += in[i] * gain_[i];
+        }
+
+        return sum;
+    }
+
+protected:
+    float gain_[kChannels];
+};
+
+// Q15 inputs at Q15 gains, so each gain is within [-1, 1). Channels go two at
+// a time through SMLALD into a 64 bit sum, which only saturates once it's
+// rounded back to Q15 at the output.
+template <uint32_t kChannels>
+class Mixer<Q15, kChannels>
+{
+public:
+    void Init(void)
+    {
+        std::fill(gain_, gain_ + kChannels, 0);
+    }
+
+    void SetGain(uint32_t channel, float gain)
+    {
+        gain_[channel] = Q15(gain).raw();
+    }
+
+    Q15 Process(const Q15* in)
+    {
+        int64_t sum = kRound;
+        uint32_t i = 0;
+
+        for (; i + 1 < kChannels; i += 2)
+        {
+            sum = fixed::DualMultiplyAccumulateLong(fixed::LoadPair(&in[i]),
+                fixed::LoadPair(&gain_[i]), sum);
+        }
+
+        if (i < kChannels)
+        {
+            sum += int32_t(in[i].raw()) * gain_[i];
+        }
+
+        return Q15::FromRaw(fixed::Saturate<16>(sum >> Q15::kFractionBits));
+    }
+
+protected:
+    static constexpr int64_t kRound = 1 << (Q15::kFractionBits - 1);
+
+    int16_t gain_[kChannels];
+};
+
+}
@@ -3,6 +3,8 @@
 #include <cmath>
 #include <limits>
 
+#include "app/engine/filter_design.h"
+
 namespace recorder
 {
 
@@ -11,7 +13,13 @@ class OnePoleLowpass
 public:
     void Init(float cutoff, float sample_rate, float initial_value = 0)
     {
-        factor_ = 1 - std::exp(-cutoff / sample_rate);
+        Init(design::OnePole(cutoff, sample_rate), initial_value);
+    }
+
+    void Init(const design::OnePoleCoefficients& coefficients,
+        float initial_value = 0)
+    {
+        factor_ = coefficients.factor;
         Reset(initial_value);
     }
 
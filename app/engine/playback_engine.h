@@ -3,12 +3,15 @@
 #include <cstdint>
 
 #include "common/config.h"
+#include "common/io.h"
+#include "common/tap.h"
 #include "app/engine/sample_player.h"
 #include "app/engine/delay_engine.h"
 #include "app/engine/aafilter.h"
-#include "app/engine/resonant_filter.h"
+#include "app/engine/svf.h"
 #include "app/engine/ring_modulator.h"
 #include "app/engine/biquad.h"
+#include "util/fast_math.h"
 
 namespace recorder
 {
@@ -19,10 +22,10 @@ namespace recorder
     public:
         PlaybackEngine(T &memory) : memory_{memory} {}
 
-        void Init(void)
+        void Init(const DelayEngine::Tuning& delay_tuning = {})
         {
             sample_player_.Init();  
-            delay_.Init();
+            delay_.Init(delay_tuning);
             aa_filter_.Init();
             res_filter_.Init(16000, 700, 10);
             ring_mod_.Init(16000, 400, .7);
@@ -94,8 +97,8 @@ namespace recorder
 
         void SetCutoffAndQ(float q, float cutoff)
         {
-            res_filter_.SetQ(mapFloat(q, 0.0, 1.0, .5, 20));
-            res_filter_.SetCutoffFrequency(mapFloat(cutoff, 0.0, 1.0, 30, 8000));
+            res_filter_.Set(mapFloat(cutoff, 0.0, 1.0, 30, 8000),
+                mapFloat(q, 0.0, 1.0, .5, 20));
         }
         void SetRingMod(float freq, float mix)
         {
@@ -118,7 +121,10 @@ namespace recorder
             {
                 pitch = 1.0;
             }
-            float speed = std::exp2(pitch);
+            // Within 0.0003 cents of std::exp2 over the pot's range; against
+            // it, the read position drifts by under 0.01 samples in the
+            // playback_pitch render
+            float speed = fast::Exp2(pitch);
             float sample = 0;
 
             if (state_ == STATE_STOPPED)
@@ -174,9 +180,10 @@ namespace recorder
                     float delay = pot[kPotDelayTime];
                     float feedback = pot[kPotDelayFeedback];
                     sample = delay_.Process(sample, delay, feedback);
+                    tap::tap_.Write(tap::POINT_DELAY, sample);
                 }
             }
-            // sample = res_filter_.Process(sample);
+            // sample = res_filter_.Process(sample).lowpass;
             if (ringModOn)
             {
                 // ring mod processing
@@ -207,12 +214,16 @@ namespace recorder
         };
 
         T &memory_;
-        SamplePlayer<T> sample_player_{memory_};
+        // Hermite until SincKernel<8>'s cycles are measured on the device.
+        // The sinc keeps images and aliases 37 dB down where Hermite's reach
+        // 13 dB (host/resamplebench), but it reads up to 32 samples per
+        // output to Hermite's 4, and costs 5 to 9 times as much on the host
+        SamplePlayer<T, HermiteKernel> sample_player_{memory_};
         State state_;
         bool cue_play_;
         bool cue_stop_;
         DelayEngine delay_;
-        ResonantFilter res_filter_;
+        Svf res_filter_;
         RingModulator ring_mod_;
         Biquad main_filter_;
         AAFilter<float> aa_filter_;
@@ -6,6 +6,7 @@
 #include "common/config.h"
 #include "app/engine/resampler.h"
 #include "app/engine/aafilter.h"
+#include "util/fast_math.h"
 
 namespace recorder
 {
@@ -31,7 +32,7 @@ public:
 
     void Process(const float (&block)[kAudioOSFactor], float pitch)
     {
-        float ratio = std::exp2(pitch);
+        float ratio = fast::Exp2(pitch);
         float sample = 0;
 
         for (uint32_t i = 0; i < kAudioOSFactor; i++)
@@ -41,15 +42,19 @@ public:
 
         resampler_.Push(sample, ratio);
 
-        while (resampler_.Pop(sample))
-        {
-            memory_.Append(sample);
-        }
+        auto output = resampler_.AcquireRead();
+        memory_.Append(output.data[0], output.length[0]);
+        memory_.Append(output.data[1], output.length[1]);
+        resampler_.Release(output.total());
     }
 
 protected:
     T& memory_;
-    Resampler<16> resampler_;
+    // Hermite, as for playback, until the sinc kernels' cycles in the audio
+    // callback are measured on the device. The recording keeps its images,
+    // which SincKernel<16> would hold 65 dB down to Hermite's 13 (see
+    // host/resamplebench), for about 10 times the time on the host
+    Resampler<16, HermiteKernel> resampler_;
     AAFilter<float> aa_filter_;
 };
 
@@ -5,14 +5,30 @@
 #include <algorithm>
 
 #include "util/fifo.h"
+#include "app/engine/resampling_kernel.h"
 
 namespace recorder
 {
 
-// Ratio is output sampling rate divided by input sampling rate
-template <uint32_t max_ratio>
+// Ratio is output sampling rate divided by input sampling rate. Kernel is
+// one of those in app/engine/resampling_kernel.h; its reach sets the delay,
+// which is kMaxReach input samples whatever the ratio.
+//
+// Input is pushed and the output queued for reading, or output is pulled
+// and the input read from a source as needed. A resampler is used one way
+// or the other, not both.
+template <uint32_t max_ratio, typename Kernel = LinearKernel>
 class Resampler
 {
+protected:
+    static constexpr uint32_t kFifoSize = std::round(std::exp2(std::ceil(
+        std::log2(max_ratio + 1))));
+    static constexpr uint32_t kReach = Kernel::kMaxReach;
+    static constexpr uint32_t kHistorySize = std::round(std::exp2(std::ceil(
+        std::log2(2 * kReach))));
+
+    using Output = Fifo<float, kFifoSize>;
+
 public:
     void Init(void)
     {
@@ -22,26 +38,62 @@ public:
     void Reset(void)
     {
         output_.Flush();
-        input_phase_ = 1;
-        history_ = 0;
+        std::fill(history_, history_ + 2 * kHistorySize, 0.f);
+        write_head_ = 0;
+        input_phase_ = 2;
     }
 
+    // Output that doesn't fit is dropped
     void Push(float sample, float ratio)
+    {
+        Push(&sample, 1, ratio);
+    }
+
+    void Push(const float* in, uint32_t size, float ratio)
     {
         float speed = 1 / ratio;
+        float cutoff = std::min(ratio, 1.f);
 
-        while (input_phase_ <= 1)
+        for (uint32_t i = 0; i < size; i++)
         {
-            if (!output_.full())
+            float output[kFifoSize];
+            uint32_t length = 0;
+
+            Write(in[i]);
+            input_phase_ -= 1;
+
+            while (input_phase_ <= 1)
             {
-                output_.Push(std::lerp(history_, sample, input_phase_));
+                if (length < kFifoSize)
+                {
+                    output[length++] = Interpolate(cutoff);
+                }
+
+                input_phase_ += speed;
             }
 
-            input_phase_ += speed;
+            output_.PushSpan(output, length);
         }
+    }
 
-        input_phase_ -= 1;
-        history_ = sample;
+    // Fills `out`, calling source() for each input sample it needs
+    template <typename Source>
+    void Pull(float* out, uint32_t size, float ratio, Source&& source)
+    {
+        float speed = 1 / ratio;
+        float cutoff = std::min(ratio, 1.f);
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            while (input_phase_ > 1)
+            {
+                Write(source());
+                input_phase_ -= 1;
+            }
+
+            out[i] = Interpolate(cutoff);
+            input_phase_ += speed;
+        }
     }
 
     bool Pop(float& item)
@@ -49,13 +101,39 @@ public:
         return output_.Pop(item);
     }
 
-protected:
-    static constexpr uint32_t kFifoSize = std::round(std::exp2(std::ceil(
-        std::log2(max_ratio + 1))));
+    // Output to read in place, freed by Release()
+    typename Output::Span AcquireRead(void)
+    {
+        return output_.AcquireRead();
+    }
+
+    void Release(uint32_t length)
+    {
+        output_.Release(length);
+    }
 
-    Fifo<float, kFifoSize> output_;
+protected:
+    Output output_;
+    // Each sample is written twice, kHistorySize apart, so that the last
+    // kHistorySize of them are always in one piece
+    float history_[2 * kHistorySize];
+    uint32_t write_head_;
+    // Position of the next output, in input samples after the one kReach
+    // before the newest
     float input_phase_;
-    float history_;
+
+    void Write(float sample)
+    {
+        write_head_ = (write_head_ + 1) % kHistorySize;
+        history_[write_head_] = sample;
+        history_[write_head_ + kHistorySize] = sample;
+    }
+
+    float Interpolate(float cutoff)
+    {
+        const float* x = &history_[write_head_ + kHistorySize - kReach];
+        return Kernel::Interpolate(x, input_phase_, cutoff);
+    }
 };
 
 }
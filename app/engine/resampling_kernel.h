@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "util/lut.h"
+
+namespace recorder
+{
+
+// Interpolation kernels for Resampler and SamplePlayer, in rising order of
+// cost and quality. Each one works out a sample between x[0] and x[1], `frac`
+// of the way along, reading x[1 - Reach(cutoff)] to x[Reach(cutoff)], and no
+// more than kMaxReach samples either side.
+//
+// `cutoff` is the output's Nyquist frequency over the input's: below 1, when
+// reading faster than the input's rate, the sinc kernels stretch to lowpass
+// at it, so that what the output can't hold is filtered rather than aliased.
+// They stretch by up to kMaxStretch (an octave up), reading more samples as
+// they do; the others don't filter at all.
+//
+// host/resamplebench measures the cost and the alias rejection of each.
+
+// Straight line between x[0] and x[1]
+struct LinearKernel
+{
+    static constexpr uint32_t kMaxReach = 1;
+
+    static constexpr uint32_t Reach(float cutoff)
+    {
+        return 1;
+    }
+
+    static float Interpolate(const float* x, float frac, float cutoff)
+    {
+        return x[0] + (x[1] - x[0]) * frac;
+    }
+};
+
+// 4 point, 3rd order Hermite (Catmull-Rom) spline
+struct HermiteKernel
+{
+    static constexpr uint32_t kMaxReach = 2;
+
+    static constexpr uint32_t Reach(float cutoff)
+    {
+        return 2;
+    }
+
+    static float Interpolate(const float* x, float frac, float cutoff)
+    {
+        float c1 = 0.5f * (x[1] - x[-1]);
+        float c2 = x[-1] - 2.5f * x[0] + 2 * x[1] - 0.5f * x[2];
+        float c3 = 0.5f * (x[2] - x[-1]) + 1.5f * (x[0] - x[1]);
+        return ((c3 * frac + c2) * frac + c1) * frac + x[0];
+    }
+};
+
+// Kaiser-windowed sinc, kTaps samples wide at a cutoff of 1. The half kernel
+// is a polyphase table of lut::kSincPhases points per sample, read with
+// linear interpolation between phases; stretching the kernel only changes
+// the step through the table.
+template <uint32_t kTaps>
+class SincKernel
+{
+public:
+    static_assert(kTaps == 8 || kTaps == 16);
+
+    static constexpr uint32_t kMaxStretch = 2;
+    static constexpr uint32_t kMaxReach = kTaps / 2 * kMaxStretch;
+
+    static uint32_t Reach(float cutoff)
+    {
+        cutoff = std::clamp(cutoff, kMinCutoff, 1.f);
+        return std::ceil((kTaps / 2) / cutoff);
+    }
+
+    static float Interpolate(const float* x, float frac, float cutoff)
+    {
+        cutoff = std::clamp(cutoff, kMinCutoff, 1.f);
+        uint32_t reach = std::ceil((kTaps / 2) / cutoff);
+        // Table position per sample of distance from the centre
+        float step = cutoff * (2.f / kTaps);
+        float sum = 0;
+
+        // Outwards from x[0] to the left and from x[1] to the right
+        float left = frac * step;
+        float right = (1 - frac) * step;
+
+        for (uint32_t i = 0; i < reach; i++)
+        {
+            sum += x[-int32_t(i)] * Table().Clamped(left);
+            sum += x[i + 1] * Table().Clamped(right);
+            left += step;
+            right += step;
+        }
+
+        return sum * cutoff;
+    }
+
+protected:
+    static constexpr float kMinCutoff = 1.f / kMaxStretch;
+
+    static constexpr auto& Table(void)
+    {
+        if constexpr (kTaps == 8)
+        {
+            return lut::kSinc8;
+        }
+        else
+        {
+            return lut::kSinc16;
+        }
+    }
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include "app/engine/envelope_follower.h"
+#include "util/lut.h"
 namespace recorder
 {
 
@@ -15,7 +16,7 @@ public:
         SetFrequency(frequency);
         SetMix(mix);
         
-        envFollower_.Init(50, 200, 500, 16000);
+        envFollower_.Init(kEnvelope);
     }
 
     void SetFrequency(float frequency)
@@ -31,7 +32,7 @@ public:
 
     float Process(float input)
     {
-        float oscillatorOutput = sin(phase_);
+        float oscillatorOutput = lut::Sine(phase_ * (0.5 / M_PI));
 
         // Update oscillator phase with envelope follower
         float envelope = envFollower_.Process(input);
@@ -56,6 +57,7 @@ protected:
     float phase_;
     float phaseIncrement_;
     float twoPiOverSampleRate_;
+    static constexpr auto kEnvelope = design::Envelope(50, 200, 500, 16000);
     EnvelopeFollower envFollower_;
 };
 
@@ -5,11 +5,16 @@
 #include <algorithm>
 #include <chrono>
 #include "drivers/system.h"
+#include "app/engine/resampling_kernel.h"
+#include "util/lut.h"
 
 namespace recorder
 {
 
-template <typename T>
+// Kernel is one of those in app/engine/resampling_kernel.h, which
+// interpolates between samples when the speed isn't 1 and, for the sinc
+// kernels, filters out what would alias when it's above 1
+template <typename T, typename Kernel = LinearKernel>
 class SamplePlayer
 {
 public:
@@ -116,13 +121,10 @@ public:
 
         if (state_ != STATE_STOPPED)
         {
-            uint32_t index_a = position_;
-            uint32_t index_b = index_a + 1;
-            float sample_a = memory_[index_a];
-            float sample_b = (index_b < length) ? memory_[index_b] : 0;
-
-            float frac = position_ - index_a;
-            sample = std::lerp(sample_a, sample_b, frac);
+            uint32_t index = position_;
+            float frac = position_ - index;
+            float rate = std::fabs(speed * speed_multiplier_);
+            sample = Interpolate(index, frac, 1 / std::max(rate, 1.f), length);
 
             bool fade_in = (position_ < kFadeDuration);
             bool fade_out = (length - 1 - position_ < kFadeDuration);
@@ -182,7 +184,6 @@ public:
     }
 
 protected:
-    static constexpr float kPi = 3.141592653589793;
     static constexpr float kFadeDuration = kAudioSampleRate * kAudioFadeTime;
     std::chrono::time_point<std::chrono::steady_clock> potTime;
 
@@ -207,8 +208,26 @@ protected:
 
     float FadeCurve(float tau)
     {
-        tau = std::clamp<float>(tau, 0, 1);
-        return 0.5 * (1 - std::cos(kPi * tau));
+        return lut::RaisedCosine(tau);
+    }
+
+    // Samples outside the recording are taken as silence. The part of the
+    // window inside it comes in one Read(), which finds its place in the
+    // memory once rather than per sample.
+    float Interpolate(uint32_t index, float frac, float cutoff, uint32_t length)
+    {
+        float window[2 * Kernel::kMaxReach] = {};
+        float* x = &window[Kernel::kMaxReach - 1];
+        int32_t reach = Kernel::Reach(cutoff);
+        int32_t first = std::max<int32_t>(1 - reach, -int32_t(index));
+        int32_t last = std::min<int32_t>(reach, int32_t(length - index) - 1);
+
+        if (first <= last)
+        {
+            memory_.Read(index + first, &x[first], last - first + 1);
+        }
+
+        return Kernel::Interpolate(x, frac, cutoff);
     }
 
 };
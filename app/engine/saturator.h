@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "util/fast_math.h"
+
+namespace recorder
+{
+
+// Soft clipper, close to tanh(drive * x), with first-order antiderivative
+// anti-aliasing: each output is the mean of the curve between the last two
+// inputs, (F(x[n]) - F(x[n-1])) / (x[n] - x[n-1]) for the curve's
+// antiderivative F. That smooths away most of the harmonics that would
+// alias, without oversampling, for half a sample of delay.
+//
+// The curve is the rational x (27 + x^2) / (27 + 9 x^2), which meets +-1
+// with zero slope at |x| = 3 and stays there.
+class Saturator
+{
+public:
+    void Init(float drive)
+    {
+        drive_ = drive;
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        x_ = 0;
+        antiderivative_ = 0;
+    }
+
+    void SetDrive(float drive)
+    {
+        drive_ = drive;
+    }
+
+    float Process(float in)
+    {
+        float x = in * drive_;
+        float antiderivative = Antiderivative(x);
+        float delta = x - x_;
+        float out = std::fabs(delta) < kMinDelta ?
+            Curve(0.5f * (x + x_)) :
+            (antiderivative - antiderivative_) / delta;
+        x_ = x;
+        antiderivative_ = antiderivative;
+        return out;
+    }
+
+    // In place
+    void Process(float* block, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            block[i] = Process(block[i]);
+        }
+    }
+
+    static float Curve(float x)
+    {
+        x = std::clamp(x, -3.f, 3.f);
+        float x2 = x * x;
+        return x * (27 + x2) / (27 + 9 * x2);
+    }
+
+protected:
+    // Below this step between inputs, rounding in the antiderivatives would
+    // outweigh the smoothing, so the curve is taken at the midpoint instead.
+    // Either way the error is within 3e-5.
+    static constexpr float kMinDelta = 0.03;
+
+    float drive_;
+    float x_;
+    float antiderivative_;
+
+    // x^2 / 18 + 4/3 ln(1 + x^2 / 3), continuing with slope +-1 beyond +-3
+    static float Antiderivative(float x)
+    {
+        float magnitude = std::fabs(x);
+        float clipped = std::min(magnitude, 3.f);
+        float x2 = clipped * clipped;
+        return x2 * (1.f / 18) +
+            (4.f / 3 / fast::kLog2e) * fast::Log2(1 + x2 * (1.f / 3)) +
+            (magnitude - clipped);
+    }
+};
+
+}
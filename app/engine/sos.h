@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
+#include "util/fixed.h"
+
 namespace recorder
 {
 
@@ -83,4 +87,107 @@ protected:
     T x_[max_num_sections + 1][3];
 };
 
+// Q15 samples, in direct form I like the float filter. The coefficients are
+// Q2.30, so within [-2, 2), and the state between and inside the sections is
+// Q4.28, within [-8, 8). The fraction bits keep the early sections of a peak
+// scaled cascade, which pass the band's low end well below full scale, from
+// rounding it away. The headroom is for the worst case input: scaling only
+// bounds the gain to a sine, and full scale samples timed against the
+// impulse response take the anti-aliasing filter's last section to 3.4 (see
+// host/fixedbench).
+//
+// Each section sums its five 32x32 products in 64 bits with SMLALs, which
+// holds while the sum of each coefficient's magnitude times its state's
+// peak stays under 32; for the anti-aliasing filter it reaches 12.7. The
+// output is rounded and saturated to Q15 once.
+template <int max_num_sections>
+class SOSFilter<Q15, max_num_sections>
+{
+public:
+    void Init(int num_sections, const SOSCoefficients* sections)
+    {
+        num_sections_ = num_sections;
+        Reset();
+        SetCoefficients(sections);
+    }
+
+    void Reset()
+    {
+        for (int n = 0; n <= num_sections_; n++)
+        {
+            x_[n][0] = 0;
+            x_[n][1] = 0;
+            x_[n][2] = 0;
+        }
+    }
+
+    void SetCoefficients(const SOSCoefficients* sections)
+    {
+        for (int n = 0; n < num_sections_; n++)
+        {
+            const SOSCoefficients& s = sections[n];
+            sections_[n].b[0] = Coefficient(s.b[0]);
+            sections_[n].b[1] = Coefficient(s.b[1]);
+            sections_[n].b[2] = Coefficient(s.b[2]);
+            sections_[n].a[0] = Coefficient(-s.a[0]);
+            sections_[n].a[1] = Coefficient(-s.a[1]);
+        }
+    }
+
+    Q15 Process(Q15 in)
+    {
+        int32_t sample = int32_t(in.raw()) << kExtraStateBits;
+
+        for (int n = 0; n < num_sections_; n++)
+        {
+            // Shift x state
+            x_[n][2] = x_[n][1];
+            x_[n][1] = x_[n][0];
+            x_[n][0] = sample;
+
+            const Section& s = sections_[n];
+            int64_t sum = kRound;
+            sum = fixed::MultiplyAccumulateLong(x_[n][0], s.b[0], sum);
+            sum = fixed::MultiplyAccumulateLong(x_[n][1], s.b[1], sum);
+            sum = fixed::MultiplyAccumulateLong(x_[n][2], s.b[2], sum);
+            sum = fixed::MultiplyAccumulateLong(x_[n + 1][0], s.a[0], sum);
+            sum = fixed::MultiplyAccumulateLong(x_[n + 1][1], s.a[1], sum);
+            sample = fixed::Saturate<32>(sum >> kCoefficientBits);
+        }
+
+        // Shift final section x state
+        x_[num_sections_][2] = x_[num_sections_][1];
+        x_[num_sections_][1] = x_[num_sections_][0];
+        x_[num_sections_][0] = sample;
+
+        constexpr int32_t kHalf = 1 << (kExtraStateBits - 1);
+        return Q15::FromRaw(fixed::Saturate<16>(
+            (int64_t(sample) + kHalf) >> kExtraStateBits));
+    }
+
+protected:
+    static constexpr int kCoefficientBits = 30;
+    static constexpr int64_t kRound = int64_t(1) << (kCoefficientBits - 1);
+    // The state's fraction bits beyond Q15's, leaving it a range of [-8, 8)
+    static constexpr int kExtraStateBits = 13;
+
+    // Q2.30 coefficients, the a terms negated
+    struct Section
+    {
+        int32_t b[3];
+        int32_t a[2];
+    };
+
+    int num_sections_;
+    Section sections_[max_num_sections];
+    int32_t x_[max_num_sections + 1][3];
+
+    // Exact in float, which holds the coefficients to 24 bits anyway
+    static int32_t Coefficient(float c)
+    {
+        c *= 1 << kCoefficientBits;
+        return fixed::Saturate<32>(int64_t(c + ((c < 0) ? -0.5f : 0.5f)));
+    }
+};
+
 }
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "app/engine/filter_design.h"
+
+namespace recorder
+{
+
+// Trapezoidal (zero-delay feedback) state-variable filter, with lowpass,
+// bandpass and highpass outputs from the same state. It stays stable and in
+// tune however fast the cutoff moves, and a change of cutoff or Q costs a
+// fast::Tan() and a division (see design::Svf()), so both can be modulated
+// every sample.
+class Svf
+{
+public:
+    struct Outputs
+    {
+        float lowpass;
+        float bandpass;
+        float highpass;
+    };
+
+    void Init(float sample_rate, float frequency, float q)
+    {
+        sample_rate_ = sample_rate;
+        Set(frequency, q);
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        ic1eq_ = 0;
+        ic2eq_ = 0;
+    }
+
+    // The frequency is clamped to kMaxFrequency of the sampling rate
+    void Set(float frequency, float q)
+    {
+        frequency_ = std::clamp(frequency, 0.f, kMaxFrequency * sample_rate_);
+        q_ = q;
+        coeffs_ = design::Svf(frequency_, q_, sample_rate_);
+    }
+
+    void SetFrequency(float frequency)
+    {
+        Set(frequency, q_);
+    }
+
+    void SetQ(float q)
+    {
+        Set(frequency_, q);
+    }
+
+    Outputs Process(float in)
+    {
+        float v3 = in - ic2eq_;
+        float v1 = coeffs_.a1 * ic1eq_ + coeffs_.a2 * v3;
+        float v2 = ic2eq_ + coeffs_.a2 * ic1eq_ + coeffs_.a3 * v3;
+        ic1eq_ = 2 * v1 - ic1eq_;
+        ic2eq_ = 2 * v2 - ic2eq_;
+        return {v2, v1, in - coeffs_.k * v1 - v2};
+    }
+
+    // Within fast::Tan()'s accurate range
+    static constexpr float kMaxFrequency = 0.47;
+
+protected:
+    float sample_rate_;
+    float frequency_;
+    float q_;
+    design::SvfCoefficients coeffs_;
+    // The integrators' states
+    float ic1eq_;
+    float ic2eq_;
+};
+
+// kSize Svf instances, such as one per synth voice, with each coefficient and
+// state in an array of its own: Process() runs them all a sample at a time in
+// plain loops over the arrays, which the compiler can unroll and schedule
+// better than a loop over Svf objects.
+template <uint32_t kSize>
+class SvfBank
+{
+public:
+    void Init(float sample_rate, float frequency, float q)
+    {
+        sample_rate_ = sample_rate;
+
+        for (uint32_t i = 0; i < kSize; i++)
+        {
+            Set(i, frequency, q);
+        }
+
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        std::fill(ic1eq_, ic1eq_ + kSize, 0.f);
+        std::fill(ic2eq_, ic2eq_ + kSize, 0.f);
+    }
+
+    // As Svf::Set(), for instance i
+    void Set(uint32_t i, float frequency, float q)
+    {
+        frequency = std::clamp(frequency, 0.f,
+            Svf::kMaxFrequency * sample_rate_);
+        auto coeffs = design::Svf(frequency, q, sample_rate_);
+        k_[i] = coeffs.k;
+        a1_[i] = coeffs.a1;
+        a2_[i] = coeffs.a2;
+        a3_[i] = coeffs.a3;
+    }
+
+    // A sample of each instance, from in[i] to lowpass[i], bandpass[i] and
+    // highpass[i]
+    void Process(const float* in, float* lowpass, float* bandpass,
+        float* highpass)
+    {
+        for (uint32_t i = 0; i < kSize; i++)
+        {
+            float v3 = in[i] - ic2eq_[i];
+            float v1 = a1_[i] * ic1eq_[i] + a2_[i] * v3;
+            float v2 = ic2eq_[i] + a2_[i] * ic1eq_[i] + a3_[i] * v3;
+            ic1eq_[i] = 2 * v1 - ic1eq_[i];
+            ic2eq_[i] = 2 * v2 - ic2eq_[i];
+            lowpass[i] = v2;
+            bandpass[i] = v1;
+            highpass[i] = in[i] - k_[i] * v1 - v2;
+        }
+    }
+
+protected:
+    float sample_rate_;
+    float k_[kSize];
+    float a1_[kSize];
+    float a2_[kSize];
+    float a3_[kSize];
+    float ic1eq_[kSize];
+    float ic2eq_[kSize];
+};
+
+}
@@ -2,8 +2,14 @@
 
 #include <cstdint>
 #include <cmath>
+#include <algorithm>
 #include "common/config.h"
+#include "common/tap.h"
 #include "app/engine/aafilter.h"
+#include "app/engine/control_event.h"
+#include "util/fast_math.h"
+#include "app/engine/saturator.h"
+#include "app/engine/limiter.h"
 #include "waveform_generator.h"
 
 namespace recorder
@@ -14,10 +20,32 @@ class SynthEngine
     enum { kNumVoices = 4, kNumChords = 8, kNumStrum = 6 }; // Changed kNumStrum to 6
 
 public:
+    // Voicing constants that are worth auditioning without a reflash; the
+    // host sweep tool renders the engine across grids of these. The defaults
+    // are what the firmware uses.
+    struct Tuning
+    {
+        float strum_min_rel_time = 0.05f;
+        float strum_max_rel_time = 1.9f;
+        // For the 5 older voices when all 6 are active
+        float attenuation_levels[5] = { 0.9f, 0.8f, 0.7f, 0.6f, 0.5f };
+        // Output limiter
+        float comp_threshold = 1.0f;
+        float comp_release_time = 0.200f;
+    };
+
     SynthEngine() = default;
 
-    void Init()
+    void Init(void)
     {
+        Init(Tuning());
+    }
+
+    void Init(const Tuning& tuning)
+    {
+        tuning_ = tuning;
+        strum_rel_log2_ratio_ = std::log2(
+            tuning_.strum_max_rel_time / tuning_.strum_min_rel_time);
         mode_ = false;
         current_chord_ = 0;
         base_frequency_ = 261.63f; // Default to middle C
@@ -34,6 +62,7 @@ public:
             env_state_[v] = ENV_IDLE;
             env_level_[v] = 0.0f;
             gate_[v] = false;
+            key_[v] = false;
         }
 
         // Strum voices (sine)
@@ -52,12 +81,10 @@ public:
         last_strum_ = -1;
         strum_activation_counter_ = 0;
         aa_filter_.Init();
+        saturator_.Init(2.5f);
 
-        // Compressor init
-        compEnv_ = 0.0f;
-        compGain_ = 1.0f;
-        alphaAtk_ = std::exp(-1.0f/(kCompAttackTime * kAudioSampleRate));
-        alphaRel_ = std::exp(-1.0f/(kCompReleaseTime* kAudioSampleRate));
+        limiter_.Init(tuning_.comp_threshold, tuning_.comp_release_time,
+            kAudioSampleRate);
 
         updateChordTargets(false, false);
     }
@@ -83,15 +110,42 @@ public:
         return base_frequency_;
     }
 
+    // Chord selected by the chord pot
+    static int ChordIndex(float chord_pot)
+    {
+        return int(std::min(chord_pot, 0.9999f) * (float)(kNumChords - 1)) + (chord_pot >= 0.9999f);
+    }
+
+    // Applies a control event; call before Process() for the callback it's
+    // timed for
+    void Apply(const ControlEvent& event)
+    {
+        switch (event.type)
+        {
+            case ControlEvent::TYPE_KEY_ON:
+            case ControlEvent::TYPE_KEY_OFF:
+                if (event.value < kNumVoices)
+                    key_[event.value] = (event.type == ControlEvent::TYPE_KEY_ON);
+                break;
+            case ControlEvent::TYPE_STRUM:
+                // No strum activation in base freq mode
+                if (!in_base_freq_mode_ && event.value < kNumStrum)
+                    Strum(event.value);
+                break;
+            case ControlEvent::TYPE_CHORD:
+                if (event.value < kNumChords)
+                    current_chord_ = event.value;
+                break;
+        }
+    }
+
     // mode = false → major scale, true → minor scale
     // major7: apply major seventh; minor7: apply minor seventh
     // if both major7 and minor7: apply major sixth
+    // Keys, strums and chord changes arrive through Apply().
     void Process(float (&block)[kAudioOSFactor],
-                 const bool button[kNumVoices],
                  float chord_pot,
                  float hold_pot,
-                 int strum_idx,
-                 int strum_idx_changed,
                  bool mode,
                  bool major7,
                  bool minor7)
@@ -125,64 +179,8 @@ public:
             // mode switch?
             if (mode != mode_) { mode_ = mode; }
 
-            // chord change
-            int chord_idx = int(Min(chord_pot, 0.9999f) * (float)(kNumChords - 1)) + (chord_pot >= 0.9999f);
-            if (chord_idx != current_chord_)
-            {
-                current_chord_ = chord_idx;
-            }
-
             // update targets based on chord, mode, and 7th/6th flags
             updateChordTargets(major7, minor7);
-
-            // strum trigger (now 6 positions for 6 voices)
-            
-            if (strum_idx_changed)
-            { 
-                
-                last_strum_ = strum_idx;
-                
-                // Direct voice mapping - no cycling needed
-                int voice_idx = strum_idx;
-                
-                // Calculate the target frequency immediately
-                int idx = strum_idx % kNumVoices;
-                int oct = strum_idx / kNumVoices;
-                const float* scale_multipliers = mode_ ? minor_scale_multipliers_ : major_scale_multipliers_;
-                const int* chord_types = mode_ ? minor_scale_chord_types_ : major_scale_chord_types_;
-                float root_freq = base_frequency_ * scale_multipliers[current_chord_];
-                int chord_type = chord_types[current_chord_];
-                const float* chord_multipliers;
-                
-                switch (chord_type) {
-                    case 0: chord_multipliers = major_chord_multipliers_; break;
-                    case 1: chord_multipliers = minor_chord_multipliers_; break;
-                    case 2: chord_multipliers = diminished_chord_multipliers_; break;
-                    default: chord_multipliers = major_chord_multipliers_;
-                }
-                
-                float note = root_freq * chord_multipliers[idx];
-                float target_note = note * (1 << oct);
-                
-                // Set current frequency to the target to avoid sudden changes
-                strum_current_[voice_idx] = target_note;
-                strum_target_[voice_idx] = target_note;
-                strum_voices_[voice_idx].SetFrequency(target_note);
-                
-                // Start envelope from 0 to prevent clicks
-                strum_level_[voice_idx] = 0.0f;
-                strum_state_[voice_idx] = ENV_ATTACK;
-                strum_activation_time_[voice_idx] = ++strum_activation_counter_;
-                strum_attenuation_[voice_idx] = 1.0f;
-                
-                // Update frequencies for all active voices (if chord/mode changed)
-                updateStrum();
-                
-                // Update attenuation factors for all active voices
-                updateStrumAttenuation();
-                
-            }
-            
         } else {
             // Base frequency selection mode
             int chromatic_idx = int(chord_pot * 12.99f); // 0-12 for C4-C5
@@ -218,7 +216,7 @@ public:
         // 5) gates → envelopes (hold=1 → infinite sustain)
         for (int v = 0; v < kNumVoices; ++v)
         {
-            bool g = button[v];
+            bool g = key_[v];
             if (in_base_freq_mode_ && v != 0) {
                 // In base frequency mode, all voices except first are off
                 g = false;
@@ -231,11 +229,11 @@ public:
         }
 
         // 6) dynamic release via exp2 for buttons
-        float releaseTime = kMinRelTime * exp2f(hold_pot * kRelLog2Ratio);
+        float releaseTime = kMinRelTime * fast::Exp2(hold_pot * kRelLog2Ratio);
         float relInc = 1.0f / (releaseTime * kAudioSampleRate);
         
         // Dynamic release for strum voices
-        float strumReleaseTime = kStrumMinRelTime * exp2f(hold_pot * kStrumRelLog2Ratio);
+        float strumReleaseTime = tuning_.strum_min_rel_time * fast::Exp2(hold_pot * strum_rel_log2_ratio_);
         float strumRelInc = 1.0f / (strumReleaseTime * kAudioSampleRate);
 
         // if knob just turned down, force release
@@ -308,13 +306,18 @@ public:
             }
         }
         
-        // apply dynamic compressor (NYC style)
-        float dry = mix;
-        float wet = ApplyCompressor(mix);
+        // apply the limiter in parallel (NYC style)
+        // The taps take values the path uses anyway: tapping `wet` as well
+        // would stop -ffast-math from refactoring the mix below, and change
+        // its rounding
+        tap::tap_.Write(tap::POINT_SYNTH_VOICES, mix);
+        float wet = limiter_.Process(mix);
+        float dry = limiter_.delayed();
         mix = dry * 0.3f + wet * .7f;
+        tap::tap_.Write(tap::POINT_SYNTH_COMPRESSOR, mix);
 
         // give it a little saturation
-        mix = tanh(2.5 * mix);
+        mix = saturator_.Process(mix);
         
         // 8) oversample‑pack
         mix *= kAudioOSFactor * kAudioOutputLevel;
@@ -343,13 +346,8 @@ private:
     static constexpr float kMaxRelTime   = 10.0f;
     static constexpr float kRelLog2Ratio = std::log2(kMaxRelTime/kMinRelTime);
 
-    // Strum release constants
-    static constexpr float kStrumMinRelTime = 0.05f;
-    static constexpr float kStrumMaxRelTime = 1.9f;
-    static constexpr float kStrumRelLog2Ratio = std::log2(kStrumMaxRelTime/kStrumMinRelTime);
-
-    // Updated attenuation levels array for 5 older voices when all 6 are active
-    static constexpr float kAttenuationLevels[5] = { 0.9f, 0.8f, 0.7f, 0.6f, 0.5f };
+    Tuning tuning_;
+    float strum_rel_log2_ratio_;
 
     static constexpr float kAttackInc    = 1.0f/(kAttackTime*kAudioSampleRate);
     static constexpr float kDecayInc     = (1.0f-kSustain)/(kDecayTime*kAudioSampleRate);
@@ -358,14 +356,9 @@ private:
     static constexpr float kVoiceScale   = 0.25;
     static constexpr float kSynthGain    = 1.0f;
 
-    // Compressor state & params
-    float compEnv_{0.0f};       // current detected envelope
-    float compGain_{1.0f};      // current gain multiplier
-    float alphaAtk_{0.0f}, alphaRel_{0.0f}; // filter coeffs
+    // 1.5 ms of lookahead
+    Limiter<12> limiter_;
 
-    static constexpr float kCompThreshold   = 1.0f;
-    static constexpr float kCompAttackTime  = 0.000001f;
-    static constexpr float kCompReleaseTime = 0.200f;
 
     // Seventh and sixth ratios
     static constexpr float kMinor7Ratio = 1.781797f; // 2^(10/12)
@@ -459,6 +452,8 @@ private:
     EnvelopeState env_state_[kNumVoices];
     float env_level_[kNumVoices];
     bool gate_[kNumVoices];
+    // Key states from the last KEY_ON/KEY_OFF events
+    bool key_[kNumVoices];
 
     WaveformGenerator strum_voices_[kNumStrum];
     float strum_current_[kNumStrum], strum_target_[kNumStrum];
@@ -472,6 +467,7 @@ private:
     float strum_attenuation_[kNumStrum];  // Attenuation factor for each voice
 
     AAFilter<float> aa_filter_;
+    Saturator saturator_;
     int current_chord_;
     bool mode_;
 
@@ -481,21 +477,49 @@ private:
         c += (d > 0 ? r : -r) * (fabsf(d) > r);
     }
 
-    inline float ApplyCompressor(float in)
+    // strum trigger (6 positions for 6 voices)
+    inline void Strum(int strum_idx)
     {
-        float absIn = fabsf(in);
-        if (absIn > compEnv_)
-            compEnv_ = alphaAtk_ * compEnv_ + (1 - alphaAtk_) * absIn;
-        else
-            compEnv_ = alphaRel_ * compEnv_ + (1 - alphaRel_) * absIn;
-        float targetGain = (compEnv_ > kCompThreshold)
-                            ? (kCompThreshold / compEnv_)
-                            : 1.0f;
-        if (targetGain < compGain_)
-            compGain_ = alphaAtk_ * compGain_ + (1 - alphaAtk_) * targetGain;
-        else
-            compGain_ = alphaRel_ * compGain_ + (1 - alphaRel_) * targetGain;
-        return in * compGain_;
+        last_strum_ = strum_idx;
+
+        // Direct voice mapping - no cycling needed
+        int voice_idx = strum_idx;
+
+        // Calculate the target frequency immediately
+        int idx = strum_idx % kNumVoices;
+        int oct = strum_idx / kNumVoices;
+        const float* scale_multipliers = mode_ ? minor_scale_multipliers_ : major_scale_multipliers_;
+        const int* chord_types = mode_ ? minor_scale_chord_types_ : major_scale_chord_types_;
+        float root_freq = base_frequency_ * scale_multipliers[current_chord_];
+        int chord_type = chord_types[current_chord_];
+        const float* chord_multipliers;
+
+        switch (chord_type) {
+            case 0: chord_multipliers = major_chord_multipliers_; break;
+            case 1: chord_multipliers = minor_chord_multipliers_; break;
+            case 2: chord_multipliers = diminished_chord_multipliers_; break;
+            default: chord_multipliers = major_chord_multipliers_;
+        }
+
+        float note = root_freq * chord_multipliers[idx];
+        float target_note = note * (1 << oct);
+
+        // Set current frequency to the target to avoid sudden changes
+        strum_current_[voice_idx] = target_note;
+        strum_target_[voice_idx] = target_note;
+        strum_voices_[voice_idx].SetFrequency(target_note);
+
+        // Start envelope from 0 to prevent clicks
+        strum_level_[voice_idx] = 0.0f;
+        strum_state_[voice_idx] = ENV_ATTACK;
+        strum_activation_time_[voice_idx] = ++strum_activation_counter_;
+        strum_attenuation_[voice_idx] = 1.0f;
+
+        // Update frequencies for all active voices (if chord/mode changed)
+        updateStrum();
+
+        // Update attenuation factors for all active voices
+        updateStrumAttenuation();
     }
 
     inline void updateStrumAttenuation()
@@ -548,7 +572,7 @@ private:
                 int att_idx = active_count - 2 - i; // Map to attenuation array (reverse order)
                 if (att_idx >= 5) att_idx = 4;      // Clamp to array bounds (5 elements now)
                 if (att_idx < 0) att_idx = 0;
-                strum_attenuation_[voice_idx] = kAttenuationLevels[att_idx];
+                strum_attenuation_[voice_idx] = tuning_.attenuation_levels[att_idx];
             }
         }
     }
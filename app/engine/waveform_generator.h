@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include "common/config.h"
+#include "util/lut.h"
 
 namespace recorder {
 
@@ -26,7 +27,7 @@ public:
     inline float Process() {
         float out;
         if (waveform_ == Waveform::SINE) {
-            out = sinf(phase_);
+            out = lut::Sine(phase_ * kInvTwoPi);
         } else {
             // TRIANGLE
             // normalize φ = phase_/π in [0,2)
@@ -48,6 +49,7 @@ private:
 
     static constexpr float kTwoPi        = 2.0f * (float)M_PI;
     static constexpr float kInvPi        = 1.0f / (float)M_PI;
+    static constexpr float kInvTwoPi     = 1.0f / kTwoPi;
     static constexpr float kPhaseFactor  = kTwoPi / (float)kAudioSampleRate;
     static constexpr float kOutputScale  = 0.08f;
 };
@@ -6,6 +6,7 @@
 #include <cmath>
 
 #include "drivers/system.h"
+#include "drivers/cycle_counter.h"
 #include "drivers/profiling.h"
 #include "drivers/switches.h"
 #include "drivers/analog.h"
@@ -13,9 +14,13 @@
 #include "drivers/gpio.h"
 
 #include "common/config.h"
+#include "common/events.h"
 #include "common/io.h"
+#include "common/log.h"
+#include "common/tap.h"
 #include "util/buffer_chain.h"
 #include "util/edge_detector.h"
+#include "util/latency_meter.h"
 #include "monitor/monitor.h"
 #include "app/engine/recording_engine.h"
 #include "app/engine/playback_engine.h"
@@ -58,9 +63,11 @@ namespace recorder
     SwitchID buttonIDs[numButtons] = {SWITCH_KEY_1, SWITCH_KEY_2, SWITCH_KEY_3, SWITCH_PLAY};
 
     std::atomic<State> state_;
+    uint32_t loop_count_;
     uint32_t idle_timeout_;
     uint32_t playback_timeout_;
     EdgeDetector play_button_;
+    LatencyMeter latency_;
 
     uint32_t record_button_hold_timer; //how long has the record button been held (tap or hold)
     EdgeDetector record_button_;
@@ -68,6 +75,7 @@ namespace recorder
     SampleMemory<__fp16> sample_memory_;
     RecordingEngine recording_{sample_memory_};
     PlaybackEngine playback_{sample_memory_};
+    Transfer<__fp16> transfer_{sample_memory_};
     DeviceIO io_;
     Monitor monitor_;
     OutputPin<GPIOC_BASE, 2> ledPin;
@@ -78,54 +86,98 @@ namespace recorder
     static int last_strum_idx = 0;
     //true if the strum pot has changed between positions (0-6), activating a strum
     bool strum_idx_changed = false;
+    // last chord sent to the synth
+    int last_chord_idx_ = -1;
+    // key states last sent to the synth, and whether a strum is waiting to
+    // be sent: whatever the control queue had no room for is sent on a
+    // later pass, so a key can't be left on
+    bool keys_posted_[numButtons] = {};
+    bool strum_pending_ = false;
+    bool controls_full_ = false;
+
+    // Keys, strums and chord changes for the audio callback, and the
+    // callback counts when the switches and pots last changed, which time
+    // them
+    ControlQueue controls_;
+    std::atomic<uint32_t> switch_edge_callback_;
+    std::atomic<uint32_t> pot_edge_callback_;
+    uint32_t switch_time_;
+    uint32_t pot_time_;
+    // last strum and chord positions the audio callback posted EVENT_POTS for
+    int strum_idx_posted_ = 0;
+    int chord_idx_posted_ = 0;
+
+    int StrumIndex(float strum_pot)
+    {
+        return int(strum_pot * 5.99f); // 0-5 for 6 strum positions
+    }
+
+    // Returns false if the control queue is full, logging the first of a
+    // run of failures
+    bool PostControl(ControlEvent::Type type, int value, uint32_t time)
+    {
+        bool posted = controls_.Post(type, value, time);
+
+        if (!posted && !controls_full_)
+        {
+            LOG("Control queue full");
+        }
+
+        controls_full_ = !posted;
+        return posted;
+    }
 
 
     void Transition(State new_state)
     {
-        printf("State: ");
+        const char* name = "";
+
         switch (new_state)
         {
         case STATE_IDLE:
-            printf("IDLE\n");
+            name = "IDLE";
             break;
         case STATE_SYNTH:
-            printf("SYNTH\n");
+            name = "SYNTH";
             break;
         case STATE_RECORD:
-            printf("RECORD\n");
+            name = "RECORD";
             break;
         case STATE_PLAY:
-            printf("PLAY\n");
+            name = "PLAY";
             break;
         case STATE_STOP:
-            printf("STOP\n");
+            name = "STOP";
             break;
         case STATE_SAVE:
-            printf("SAVE\n");
+            name = "SAVE";
             break;
         case STATE_SAVE_ERASE:
-            printf("ERASE\n");
+            name = "ERASE";
             break;
         case STATE_SAVE_BEGIN_WRITE:
-            printf("BEGIN_WRITE\n");
+            name = "BEGIN_WRITE";
             break;
         case STATE_SAVE_WRITE:
-            printf("WRITE\n");
+            name = "WRITE";
             break;
         case STATE_SAVE_COMMIT:
-            printf("COMMIT\n");
+            name = "COMMIT";
             break;
         case STATE_STANDBY:
-            printf("STANDBY\n");
+            name = "STANDBY";
             break;
         case STATE_STARTUP:
-            printf("STARTUP\n");
+            name = "STARTUP";
             break;
         case STATE_ENDING:
-            printf("ENDING\n");
+            name = "ENDING";
             break;
         }
+
+        LOG("State: %s", name);
         state_.store(new_state, std::memory_order_acq_rel);
+        latency_.Stop(cycle_counter::Read());
     }
 
     //starts appropriate processes if record or playback buttons are pressed
@@ -152,10 +204,12 @@ namespace recorder
         return false;
     }
 
-    void StateMachine(bool standby)
+    // Runs on every main-loop pass; timeouts count `tick`s, which come every
+    // millisecond
+    void StateMachine(bool standby, bool tick)
     {
         // Refresh inputs
-        switches_.Process(io_.human.in);
+        switches_.Process(io_.human.in, tick);
         play_button_.Process(io_.human.in.sw[SWITCH_LOOP]);
         //record_button_.Process(io_.human.in.sw[SWITCH_RECORD]);
 
@@ -165,7 +219,7 @@ namespace recorder
         // bool strum_moved = fabsf(strum_pot - last_strum_pot) > 0.00001f;          
         last_strum_pot = strum_pot;
         //also update index of strum position
-        int strum_idx = int(strum_pot * 5.99f); // 0-5 for 6 strum positions 
+        int strum_idx = StrumIndex(strum_pot);
         strum_idx_changed = (strum_idx != last_strum_idx); //did we change positions
         last_strum_idx = strum_idx;
         //if we are holding the record button, we are recording
@@ -198,6 +252,36 @@ namespace recorder
         for (int i = 0; i < numButtons; ++i)
             buttons[i].Process(io_.human.in.sw[buttonIDs[i]]);
 
+        // Queue the changes for the synth, a fixed delay after the inputs
+        // changed. Keys are sent as the state they're in now, so one that
+        // didn't fit goes on a later pass, and is late rather than lost.
+        // Events apply in the order they're posted, so a chord change goes
+        // before a strum at the same time, and a strum waits for a chord
+        // change that didn't fit, so that it strums the new chord.
+        constexpr uint32_t kDelay = kControlDelay * kAudioSampleRate;
+        for (int i = 0; i < numButtons; ++i)
+        {
+            bool key = buttons[i].is_high();
+            if (key != keys_posted_[i] &&
+                PostControl(key ? ControlEvent::TYPE_KEY_ON :
+                    ControlEvent::TYPE_KEY_OFF, i, switch_time_ + kDelay))
+            {
+                keys_posted_[i] = key;
+            }
+        }
+        int chord_idx = SynthEngine::ChordIndex(io_.human.in.pot[POT_5]);
+        if (chord_idx != last_chord_idx_ &&
+            PostControl(ControlEvent::TYPE_CHORD, chord_idx, pot_time_ + kDelay))
+        {
+            last_chord_idx_ = chord_idx;
+        }
+        strum_pending_ |= strum_idx_changed;
+        if (strum_pending_ && chord_idx == last_chord_idx_ &&
+            PostControl(ControlEvent::TYPE_STRUM, strum_idx, pot_time_ + kDelay))
+        {
+            strum_pending_ = false;
+        }
+
         State cur = state_.load(std::memory_order_relaxed);
 
         // Handle jingle states
@@ -249,7 +333,7 @@ namespace recorder
                 idle_timeout_ = 0; // Reset timeout on activity
                 Transition(STATE_SYNTH);
             }
-            else if (kEnableIdleStandby &&
+            else if (kEnableIdleStandby && tick &&
                      ++idle_timeout_ > kIdleStandbyTime * 1000)
             {
                 // After inactivity, transition to ending instead of directly to standby
@@ -288,7 +372,7 @@ namespace recorder
                 else if (checkRecordPlayback(record, play_button_.is_high())) {
                     //handled in function
                 }
-                else if (kEnableIdleStandby &&
+                else if (kEnableIdleStandby && tick &&
                          ++idle_timeout_ > kIdleStandbyTime * 1000)
                 {
                     // Transition to ending instead of directly to standby
@@ -301,7 +385,7 @@ namespace recorder
             static uint32_t synthReleaseCounter = 0;
             if (!synth_engine_.getActive())
             {
-                if (++synthReleaseCounter >= 10)
+                if (tick && ++synthReleaseCounter >= 10)
                 {
                     // Stop audio, keep ADC on for pot updates
                     analog_.MutePowerStage();
@@ -330,7 +414,7 @@ namespace recorder
             ledPin.Write(1);
             if (analog_.running())
             {
-                if ((++playback_timeout_ == kPlaybackExpireTime * 1000) ||
+                if ((tick && ++playback_timeout_ == kPlaybackExpireTime * 1000) ||
                     (play_button_.rising() && playback_.playing()))
                 {
                     playback_.Stop();
@@ -366,7 +450,7 @@ namespace recorder
                 }
                 else
                 {
-                    printf("Erase failed\n");
+                    LOG("Erase failed");
                     Transition(STATE_STANDBY);
                 }
             }
@@ -383,7 +467,7 @@ namespace recorder
             }
             else if (record || play_button_.is_high())
             {
-                printf("Save aborted\n");
+                LOG("Save aborted");
                 sample_memory_.AbortErase();
                 Transition(STATE_IDLE);
             }
@@ -400,7 +484,7 @@ namespace recorder
             }
             else
             {
-                printf("Write failed\n");
+                LOG("Write failed");
                 Transition(STATE_STANDBY);
             }
         }
@@ -412,7 +496,7 @@ namespace recorder
             }
             else if (record || play_button_.is_high())
             {
-                printf("Save aborted\n");
+                LOG("Save aborted");
                 sample_memory_.AbortWrite();
                 Transition(STATE_IDLE);
             }
@@ -421,12 +505,12 @@ namespace recorder
         {
             if (sample_memory_.Commit())
             {
-                printf("Save completed\n");
+                LOG("Save completed");
                 sample_memory_.PrintInfo("    ");
             }
             else
             {
-                printf("Commit failed\n");
+                LOG("Commit failed");
             }
 
             Transition(STATE_STANDBY);
@@ -451,19 +535,35 @@ namespace recorder
         AudioOutput audio_out = {};
         State cur = state_.load(std::memory_order_acquire);
 
-        if (cur == STATE_SYNTH)
+        // Wake the main loop for a strum or chord change rather than wait
+        // for its tick
+        int strum_idx = StrumIndex(pot[POT_2]);
+        int chord_idx = SynthEngine::ChordIndex(pot[POT_5]);
+        if (strum_idx != strum_idx_posted_ || chord_idx != chord_idx_posted_)
         {
-            bool synth_buttons[numButtons];
-            
-            // Use first 3 synth buttons normally
-            for (int i = 0; i < numButtons; ++i)
-                synth_buttons[i] = buttons[i].is_high();
-            
-            // Button 4 (index 3) is now what play_button was
-            //synth_buttons[3] = play_button_.is_high();
+            strum_idx_posted_ = strum_idx;
+            chord_idx_posted_ = chord_idx;
+            pot_edge_callback_.store(analog_.callbacks(),
+                std::memory_order_relaxed);
+            events::Post(events::EVENT_POTS);
+        }
 
+        // Apply the control events due by this callback. Keys and chords
+        // are states, so they apply in any state; strums only sound in
+        // STATE_SYNTH, as a strum queued in another state is stale by the
+        // time the synth runs again.
+        ControlEvent event;
+        while (controls_.Next(analog_.callbacks(), event))
+        {
+            if (cur == STATE_SYNTH || event.type != ControlEvent::TYPE_STRUM)
+            {
+                synth_engine_.Apply(event);
+            }
+        }
+
+        if (cur == STATE_SYNTH)
+        {
             float chord_pot = pot[POT_5];
-            float strum = pot[POT_2];
             float hold = pot[POT_1];
             bool mode = io_.human.in.sw[SWITCH_LOOP];
             
@@ -473,18 +573,19 @@ namespace recorder
             //FOR NOW
             bool minor_seventh = false; //io_.human.in.sw[SWITCH_RECORD];
 
+            ScopedProfilingPin<PROFILE_SYNTH> engine_profile;
             synth_engine_.Process(
                 audio_out[AUDIO_OUT_LINE],
-                synth_buttons,
-                chord_pot, hold, last_strum_idx, strum_idx_changed,
-                mode, seventh, minor_seventh);
+                chord_pot, hold, mode, seventh, minor_seventh);
         }
 
         if (cur == STATE_STARTUP || cur == STATE_ENDING)
         {
             // Process jingle audio
+            ScopedProfilingPin<PROFILE_JINGLE> engine_profile;
             jingle_engine_.Process(audio_out[AUDIO_OUT_LINE]);
         } else if (cur == STATE_PLAY) {
+            ScopedProfilingPin<PROFILE_PLAYBACK> engine_profile;
             playback_.Process(audio_out[AUDIO_OUT_LINE], true, false, pot);
         }
 
@@ -493,9 +594,13 @@ namespace recorder
             AudioInputID id = io_.human.in.detect[DETECT_LINE_IN] ?
                 AUDIO_IN_LINE : AUDIO_IN_MIC;
             float pitch = 1;//(1-io_.human.in.pot[POT_1]) * 2 - 1;
+            ScopedProfilingPin<PROFILE_RECORDING> engine_profile;
             recording_.Process(audio_in[id], pitch);
         }
 
+        tap::tap_.Write(tap::POINT_OUTPUT, audio_out[AUDIO_OUT_LINE]);
+        tap::tap_.Write(tap::POINT_MIC, audio_in[AUDIO_IN_MIC]);
+        tap::tap_.Write(tap::POINT_LINE_IN, audio_in[AUDIO_IN_LINE]);
         return audio_out;
     }
 
@@ -506,6 +611,15 @@ namespace recorder
 
         analog_.Init(Process);
         switches_.Init();
+        latency_.Init(cycle_counter::kFrequency);
+        controls_.Init();
+        // There is no interrupt for every switch pin, so scan them on the tick
+        system::SetTickCallback([]
+        {
+            if (switches_.Scan())
+                switch_edge_callback_.store(analog_.callbacks(),
+                    std::memory_order_relaxed);
+        });
         play_button_.Init();
         button_1_.Init();
         button_2_.Init();
@@ -521,6 +635,7 @@ namespace recorder
         monitor_.Init();
         playback_.Reset();
         sample_memory_.Init();
+        transfer_.Init();
         
         // Start with startup jingle instead of directly to synth
         analog_.Start(true); // Ensure audio is on for jingle
@@ -529,20 +644,25 @@ namespace recorder
         
         // Initialize idle timeout counter
         idle_timeout_ = 0;
+        loop_count_ = 0;
 
         bool expire_watchdog = false;
         if (kADCAlwaysOn)
             analog_.Start(false);
 
+        // Events that woke this pass; the first one runs straight away
+        uint32_t pending = events::EVENT_TICK;
+
         for (;;)
         {
+            bool tick = pending & events::EVENT_TICK;
             ProfilingPin<PROFILE_MAIN_LOOP>::Set();
             std::atomic_thread_fence(std::memory_order_acq_rel);
 
             bool standby = false;
-            auto message = monitor_.Receive();
+            auto& message = monitor_.Receive();
             if (message.type == Message::TYPE_QUERY)
-                monitor_.Report(io_);
+                monitor_.Report(io_, analog_, latency_);
             else if (message.type == Message::TYPE_STANDBY)
                 standby = true;
             else if (message.type == Message::TYPE_WATCHDOG)
@@ -554,13 +674,70 @@ namespace recorder
             }
             else if (message.type == Message::TYPE_ERASE)
                 sample_memory_.Erase();
+            else if (message.type == Message::TYPE_CAPTURE)
+                monitor_.EnableCapture(message.capture.enable);
+            else if (message.type == Message::TYPE_PROFILE)
+            {
+                monitor_.ReportProfile(message.profile.profile);
+                if (message.profile.reset)
+                    profiling::Profiler::Reset();
+            }
+            else if (message.type == Message::TYPE_RESET_LOAD)
+            {
+                analog_.ResetLoad();
+                latency_.Reset();
+            }
+            else if (message.type == Message::TYPE_TAP)
+                monitor_.SelectTap(message.tap.point, message.tap.decimation,
+                    message.tap.codec);
+            else if (message.type == Message::TYPE_TRANSFER_INFO ||
+                     message.type == Message::TYPE_DOWNLOAD ||
+                     message.type == Message::TYPE_UPLOAD ||
+                     message.type == Message::TYPE_UPLOAD_END)
+            {
+                // Keep out of sample memory while the audio callback uses it
+                State cur = state_.load(std::memory_order_relaxed);
+                bool allowed = (cur == STATE_IDLE || cur == STATE_SYNTH ||
+                    cur == STATE_STOP);
+                transfer_.Request(message, monitor_.data_length(),
+                    monitor_.binary(), allowed);
+            }
+
+            if (transfer_.Process())
+                monitor_.ReportTransfer(transfer_.reply(),
+                    transfer_.reply_length(), transfer_.data(),
+                    transfer_.data_size());
 
             if (!expire_watchdog)
                 system::ReloadWatchdog();
 
-            StateMachine(standby);
+            // Time switch edges to the transition they cause, if any
+            if (pending & events::EVENT_SWITCH)
+                latency_.Start(switches_.edge_time());
+            uint32_t now = analog_.callbacks();
+            switch_time_ = (pending & events::EVENT_SWITCH) ?
+                switch_edge_callback_.load(std::memory_order_relaxed) : now;
+            pot_time_ = (pending & events::EVENT_POTS) ?
+                pot_edge_callback_.load(std::memory_order_relaxed) : now;
+            StateMachine(standby, tick);
+            latency_.Cancel();
+
+            // Captures are timed in ticks, as replays run a pass per tick
+            if (tick)
+                monitor_.Capture(io_.human.in, loop_count_++,
+                    analog_.callbacks());
+            monitor_.DrainLog();
+            monitor_.DrainTap();
+
+            // Flash jobs advance a step per pass, so poll them sooner than
+            // the next tick
+            State cur = state_.load(std::memory_order_relaxed);
+            if (transfer_.busy() ||
+                (cur >= STATE_SAVE && cur <= STATE_SAVE_COMMIT))
+                system::RequestPoll();
+
             ProfilingPin<PROFILE_MAIN_LOOP>::Clear();
-            system::Delay_ms(1);
+            pending = system::WaitForEvents();
         }
     }
 } // namespace recorder
\ No newline at end of file
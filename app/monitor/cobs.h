@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Consistent Overhead Byte Stuffing: encodes data without any zero bytes, at
+// a cost of one byte in 254, so a zero can delimit frames.
+namespace cobs
+{
+
+constexpr size_t MaxEncodedSize(size_t size)
+{
+    return size + size / 254 + 1;
+}
+
+// Encodes one byte at a time, handing each block to `sink(block, size)` as
+// it completes: a code byte and up to 254 data bytes. Only a block is held,
+// rather than the whole encoded frame.
+template <typename Sink>
+class Encoder
+{
+public:
+    explicit Encoder(Sink sink) : sink_{sink}, length_{1} {}
+
+    void Put(uint8_t byte)
+    {
+        if (byte)
+        {
+            block_[length_++] = byte;
+        }
+
+        if (byte == 0 || length_ == 0xFF)
+        {
+            Flush();
+        }
+    }
+
+    void Put(const void* data, size_t size)
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+
+        while (size--)
+        {
+            Put(*bytes++);
+        }
+    }
+
+    void Finish(void)
+    {
+        Flush();
+    }
+
+protected:
+    Sink sink_;
+    uint8_t block_[0xFF];
+    size_t length_;
+
+    void Flush(void)
+    {
+        block_[0] = length_;
+        sink_(block_, length_);
+        length_ = 1;
+    }
+};
+
+// Decodes a frame without its delimiter, which may be done in place. Returns
+// the decoded length, or 0 if the frame is malformed.
+inline size_t Decode(uint8_t* data, const uint8_t* encoded, size_t size)
+{
+    size_t length = 0;
+    size_t i = 0;
+
+    while (i < size)
+    {
+        uint8_t code = encoded[i++];
+
+        if (code == 0 || i + code - 1 > size)
+        {
+            return 0;
+        }
+
+        for (uint32_t j = 1; j < code; j++)
+        {
+            uint8_t byte = encoded[i++];
+
+            if (byte == 0)
+            {
+                return 0;
+            }
+
+            data[length++] = byte;
+        }
+
+        if (code != 0xFF && i < size)
+        {
+            data[length++] = 0;
+        }
+    }
+
+    return length;
+}
+
+}
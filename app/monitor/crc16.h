@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no
+// reflection), the same as Python's binascii.crc_hqx(data, 0xFFFF).
+namespace crc16
+{
+
+constexpr uint16_t kInit = 0xFFFF;
+
+struct Table
+{
+    uint16_t entry[256];
+
+    constexpr Table() : entry{}
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint16_t crc = i << 8;
+
+            for (uint32_t bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+            }
+
+            entry[i] = crc;
+        }
+    }
+};
+
+inline constexpr Table kTable;
+
+inline uint16_t Update(uint16_t crc, uint8_t byte)
+{
+    return (crc << 8) ^ kTable.entry[(crc >> 8) ^ byte];
+}
+
+inline uint16_t Update(uint16_t crc, const void* data, size_t size)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+
+    while (size--)
+    {
+        crc = Update(crc, *bytes++);
+    }
+
+    return crc;
+}
+
+}
@@ -7,6 +7,9 @@ namespace recorder
 
 struct __attribute__ ((packed)) Message
 {
+    // Only binary frames can carry more than a line of text
+    static constexpr uint32_t kMaxDataSize = 4096;
+
     enum Type
     {
         TYPE_NONE,
@@ -17,6 +20,15 @@ struct __attribute__ ((packed)) Message
         TYPE_STANDBY = 's',
         TYPE_ERASE = 'e',
         TYPE_WATCHDOG = 'w',
+        TYPE_CAPTURE = 'c',
+        TYPE_PROFILE = 'f',
+        TYPE_RESET_LOAD = 'l',
+        TYPE_BINARY = 'b',
+        TYPE_TRANSFER_INFO = 'i',
+        TYPE_DOWNLOAD = 'd',
+        TYPE_UPLOAD = 'u',
+        TYPE_UPLOAD_END = 'n',
+        TYPE_TAP = 't',
     };
 
     uint8_t type;
@@ -24,6 +36,56 @@ struct __attribute__ ((packed)) Message
     union
     {
         char text[128];
+        uint8_t data[kMaxDataSize];
+
+        struct __attribute__ ((packed))
+        {
+            uint8_t enable;
+        } capture;
+
+        struct __attribute__ ((packed))
+        {
+            uint8_t profile;
+            uint8_t reset;
+        } profile;
+
+        struct __attribute__ ((packed))
+        {
+            uint8_t enable;
+        } binary;
+
+        // Transfers (see app/monitor/transfer.h) count offsets and lengths
+        // in samples for sample memory and in bytes for flash
+        struct __attribute__ ((packed))
+        {
+            uint8_t region;
+            uint8_t codec;
+            uint32_t offset;
+            uint16_t length;
+        } download;
+
+        struct __attribute__ ((packed))
+        {
+            uint8_t region;
+            uint8_t codec;
+            uint32_t offset;
+            uint16_t length;
+            uint32_t crc32;
+            uint8_t data[kMaxDataSize - 12];
+        } upload;
+
+        struct __attribute__ ((packed))
+        {
+            uint32_t length;
+        } upload_end;
+
+        // Points are tap::Point, and codecs TransferReply::Codec
+        struct __attribute__ ((packed))
+        {
+            uint8_t point;
+            uint8_t decimation;
+            uint8_t codec;
+        } tap;
     };
 };
 
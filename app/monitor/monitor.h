@@ -1,11 +1,25 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 #include "common/io.h"
+#include "common/capture.h"
+#include "common/log.h"
+#include "common/tap.h"
+#include "drivers/system.h"
+#include "drivers/profiling.h"
+#include "drivers/analog.h"
 #include "app/monitor/a85.h"
+#include "app/monitor/cobs.h"
+#include "app/monitor/crc16.h"
 #include "app/monitor/packet.h"
 #include "app/monitor/message.h"
+#include "app/monitor/transfer.h"
+#include "util/adpcm.h"
+#include "util/latency_meter.h"
 
 namespace recorder
 {
@@ -16,65 +30,283 @@ public:
     void Init(void)
     {
         length_ = 0;
+        frame_length_ = 0;
+        binary_ = false;
+        capturing_ = false;
+        capture_length_ = 0;
+        SelectTap(tap::POINT_OFF, 1, TransferReply::CODEC_ADPCM);
     }
 
+    // Parses whatever the serial port has received, straight from its FIFO,
+    // and returns at most one message per call. The host starts out talking
+    // in lines, packets being ASCII85 with a '\xff' header, and can switch
+    // to binary frames with TYPE_BINARY: those are COBS-encoded and delimited
+    // by zeros, hold a channel byte, the payload and a CRC-16, and can carry
+    // up to Message::kMaxDataSize bytes of data. Replies, captures and logs
+    // follow the host's framing.
     const Message& Receive(void)
     {
-        char* result =
-            std::fgets(line_ + length_, sizeof(line_) - length_, stdin);
+        message_.payload.type = Message::TYPE_NONE;
 
-        if (result != nullptr)
+        while (system::SerialBytesAvailable())
         {
-            length_ = std::strlen(line_);
-        }
+            uint8_t byte = system::SerialGetByteBlocking();
 
-        if (length_ == 0 || line_[length_ - 1] != '\n')
-        {
-            message_.payload.type = Message::TYPE_NONE;
-        }
-        else
-        {
-            if (line_[0] == '\xff' && length_ > 1)
+            if (binary_ ? ReceiveFrameByte(byte) : ReceiveLineByte(byte))
             {
-                line_[length_ - 1] = '\0';
-                a85::Decode(&message_, sizeof(message_), line_ + 1);
-
-                if (message_.Verify())
+                if (message_.payload.type != Message::TYPE_TEXT)
                 {
                     Ack();
                 }
-                else
+
+                if (message_.payload.type == Message::TYPE_BINARY)
                 {
-                    message_.payload.type = Message::TYPE_NONE;
+                    binary_ = message_.payload.binary.enable;
                 }
+
+                break;
             }
-            else
+        }
+
+        return message_.payload;
+    }
+
+    // Length of the last message after its type
+    uint32_t data_length(void) const
+    {
+        return data_length_;
+    }
+
+    // Whether the host talks in binary frames
+    bool binary(void) const
+    {
+        return binary_;
+    }
+
+    void Report(const DeviceIO& io, Analog& analog,
+        const LatencyMeter& latency)
+    {
+        PopulateState(io, analog, latency);
+        Send(kReplyHeader, state_, state_line_);
+    }
+
+    // Input capture is streamed as packets on lines starting with '\xfe' (or
+    // frames on that channel) so the host can tell them apart from replies
+    // and plain text. The first packet begins with the capture header.
+    void EnableCapture(bool enable)
+    {
+        if (enable && !capturing_)
+        {
+            encoder_.Init();
+            capture_length_ = capture::Encoder::Header(capture_.payload.data);
+            capture_age_ = 0;
+        }
+        else if (!enable && capturing_)
+        {
+            FlushCapture();
+        }
+
+        capturing_ = enable;
+    }
+
+    void Capture(const HumanInput& in, uint32_t loop, uint32_t callback)
+    {
+        if (!capturing_)
+        {
+            return;
+        }
+
+        if (capture_length_ + capture::kMaxRecordSize > kCaptureChunkSize)
+        {
+            FlushCapture();
+        }
+
+        capture::Frame frame;
+        frame.loop = loop;
+        frame.callback = callback;
+        frame.Read(in);
+        capture_length_ +=
+            encoder_.Encode(frame, capture_.payload.data + capture_length_);
+
+        if (capture_length_ && ++capture_age_ >= kCaptureFlushInterval)
+        {
+            FlushCapture();
+        }
+    }
+
+    // Sends queued LOG() records as a packet on a line starting with '\xfd'
+    // (or a frame on that channel), but only once the serial port can take
+    // the whole line without blocking. The packet starts with the number of records dropped since
+    // the last one, followed by each record's format ID, argument count and
+    // arguments.
+    void DrainLog(void)
+    {
+        // Header, CR and LF, or the channel, CRC and delimiters of a frame
+        static constexpr uint32_t kMaxLineLength = std::max(
+            sizeof(log_line_) + 2,
+            cobs::MaxEncodedSize(1 + sizeof(LogChunk) + 2) + 2);
+
+        if (system::SerialTxSpace() < kMaxLineLength)
+        {
+            return;
+        }
+
+        auto& data = log_.payload.data;
+        uint16_t dropped = std::min<uint32_t>(log::queue_.TakeDropped(),
+            UINT16_MAX);
+        std::memcpy(data, &dropped, sizeof(dropped));
+        uint32_t length = sizeof(dropped);
+        log::Record record;
+
+        while (length + kMaxLogRecordSize <= kLogChunkSize &&
+            log::queue_.Pop(record))
+        {
+            std::memcpy(data + length, &record.format, sizeof(record.format));
+            length += sizeof(record.format);
+            data[length++] = record.num_args;
+            std::memcpy(data + length, record.args,
+                record.num_args * sizeof(record.args[0]));
+            length += record.num_args * sizeof(record.args[0]);
+        }
+
+        if (length > sizeof(dropped) || dropped)
+        {
+            Send(kLogHeader, log_, log_line_, length);
+        }
+    }
+
+    // Streams the signal at a tap point (see common/tap.h), decimated and
+    // either raw or as IMA ADPCM, as packets on lines starting with '\xfc' (or
+    // frames on that channel). Each packet says where its samples start in
+    // the stream, counting the samples dropped before them, so the host can
+    // fill the gaps and keep time.
+    void SelectTap(uint8_t point, uint32_t decimation, uint8_t codec)
+    {
+        tap::tap_.Select(point, decimation);
+        tap_codec_ = (codec == TransferReply::CODEC_RAW) ?
+            TransferReply::CODEC_RAW : TransferReply::CODEC_ADPCM;
+        tap_dropped_ = 0;
+        tap_encoder_.Init();
+    }
+
+    // Sends a packet of tapped samples once there are enough for one, or
+    // whatever is left while the audio callback is dropping samples, but
+    // only once the serial port can take the whole line without blocking
+    void DrainTap(void)
+    {
+        static constexpr uint32_t kMaxLineLength = std::max(
+            sizeof(tap_line_) + 2,
+            cobs::MaxEncodedSize(1 + sizeof(TapChunk) + 2) + 2);
+
+        auto& tap = tap::tap_;
+
+        if (!tap.selected() || system::SerialTxSpace() < kMaxLineLength)
+        {
+            return;
+        }
+
+        tap_dropped_ += tap.TakeDropped();
+
+        bool adpcm = (tap_codec_ == TransferReply::CODEC_ADPCM);
+        uint32_t chunk_samples = adpcm ? kTapChunkSize * 2 :
+            kTapChunkSize / sizeof(int16_t);
+        uint32_t available = tap.available();
+
+        if (available == 0 ||
+            (available < chunk_samples && !tap.dropping()))
+        {
+            return;
+        }
+
+        auto& chunk = tap_.payload;
+        chunk.position = tap.position();
+        chunk.dropped = std::min<uint32_t>(tap_dropped_, UINT16_MAX);
+        chunk.sample_rate = kAudioSampleRate / tap.decimation();
+        chunk.codec = tap_codec_;
+        chunk.predictor = tap_encoder_.predictor();
+        chunk.index = tap_encoder_.index();
+        tap_dropped_ = 0;
+
+        int16_t samples[kTapChunkSize * 2];
+        uint32_t length = tap.Pop(samples, chunk_samples);
+        chunk.length = length;
+
+        if (adpcm)
+        {
+            std::memset(chunk.data, 0, (length + 1) / 2);
+
+            for (uint32_t i = 0; i < length; i++)
             {
-                message_.payload.type = Message::TYPE_TEXT;
-                line_[length_ - 1] = '\0';
-                std::strncpy(message_.payload.text, line_,
-                    sizeof(message_.payload.text));
+                chunk.data[i / 2] |=
+                    tap_encoder_.Process(samples[i]) << (i % 2 * 4);
             }
 
-            length_ = 0;
+            length = (length + 1) / 2;
+        }
+        else
+        {
+            length *= sizeof(int16_t);
+            std::memcpy(chunk.data, samples, length);
         }
 
-        return message_.payload;
+        Send(kTapHeader, tap_, tap_line_,
+            offsetof(TapChunk, data) + length);
     }
 
-    void Report(const DeviceIO& io)
+    // Replies with the software profiler's statistics for one profile; the
+    // host walks them all by asking until `profile` reaches `num_profiles`.
+    void ReportProfile(uint8_t profile)
     {
-        PopulateState(io);
-        state_.Sign();
-        a85::Encode(line_, sizeof(line_), &state_, sizeof(state_));
+        auto& report = profile_.payload;
+        report.profile = profile;
+        report.num_profiles = NUM_PROFILES;
+        report.enabled = kEnableProfiler;
+        report.frequency = cycle_counter::kFrequency;
+        report.stats = (profile < NUM_PROFILES) ?
+            profiling::Profiler::stats(profile) :
+            profiling::Profiler::Stats{};
+        Send(kReplyHeader, profile_, profile_line_);
+    }
 
-        printf("\xff%s\n", line_);
+    // Replies with the first `length` bytes of a transfer reply, then
+    // `size` bytes of data. Lines only fit TransferReply::kLineDataSize bytes
+    // of data.
+    void ReportTransfer(const TransferReply& reply, uint32_t length,
+        const uint8_t* data, uint32_t size)
+    {
+        if (binary_)
+        {
+            SendFrame(kReplyHeader, &reply, length, data, size);
+        }
+        else
+        {
+            auto& bytes = transfer_.payload.data;
+            length = std::min<uint32_t>(length, sizeof(bytes));
+            size = std::min<uint32_t>(size, sizeof(bytes) - length);
+            std::memcpy(bytes, &reply, length);
+            std::memcpy(bytes + length, data, size);
+            Send(kReplyHeader, transfer_, transfer_line_, length + size);
+        }
     }
 
 protected:
+    static constexpr char kReplyHeader = '\xff';
+    static constexpr char kStreamHeader = '\xfe';
+    static constexpr char kLogHeader = '\xfd';
+    static constexpr char kTapHeader = '\xfc';
+
     char line_[sizeof(Message::text)];
     size_t length_;
     Packet<Message> message_;
+    uint32_t data_length_;
+    bool binary_;
+
+    // Channel, payload and CRC, encoded, and both delimiters
+    static constexpr size_t kMaxFrameSize =
+        cobs::MaxEncodedSize(1 + sizeof(Message) + 2) + 2;
+
+    uint8_t rx_frame_[kMaxFrameSize];
+    size_t frame_length_;
 
     struct __attribute__ ((packed)) State
     {
@@ -92,16 +324,250 @@ protected:
                 bool line_in_detect : 1;
             };
         };
+
+        // Audio callback load as fractions of its period, and the callbacks
+        // that ran too late for the DMA buffers
+        float load_avg;
+        float load_min;
+        float load_max;
+        uint32_t overruns;
+        uint32_t underruns;
+
+        // Switch edge to state transition, in microseconds
+        float latency_last;
+        float latency_avg;
+        float latency_max;
     };
 
     Packet<State> state_;
+    char state_line_[(sizeof(state_) + 3) / 4 * 5 + 1];
+
+    struct __attribute__ ((packed)) ProfileReport
+    {
+        uint8_t profile;
+        uint8_t num_profiles;
+        uint8_t enabled;
+        uint32_t frequency;
+        profiling::Profiler::Stats stats;
+    };
+
+    Packet<ProfileReport> profile_;
+    char profile_line_[(sizeof(profile_) + 3) / 4 * 5 + 1];
+
+    struct __attribute__ ((packed)) TransferLine
+    {
+        uint8_t data[offsetof(TransferReply, chunk) +
+            sizeof(TransferReply::chunk) + TransferReply::kLineDataSize];
+    };
+
+    Packet<TransferLine> transfer_;
+    char transfer_line_[(sizeof(transfer_) + 3) / 4 * 5 + 1];
+
+    static constexpr uint32_t kCaptureChunkSize = 96;
+    static constexpr uint32_t kCaptureFlushInterval = 50;
+
+    struct __attribute__ ((packed)) CaptureChunk
+    {
+        uint8_t data[kCaptureChunkSize];
+    };
+
+    static constexpr uint32_t kLogChunkSize = 96;
+    static constexpr uint32_t kMaxLogRecordSize =
+        sizeof(log::Record::format) + 1 + sizeof(log::Record::args);
+
+    struct __attribute__ ((packed)) LogChunk
+    {
+        uint8_t data[kLogChunkSize];
+    };
+
+    Packet<LogChunk> log_;
+    char log_line_[(sizeof(log_) + 3) / 4 * 5 + 1];
+
+    static constexpr uint32_t kTapChunkSize = 128;
+
+    struct __attribute__ ((packed)) TapChunk
+    {
+        uint32_t position;
+        uint16_t dropped;
+        uint16_t length;
+        uint16_t sample_rate;
+        uint8_t codec;
+        int16_t predictor;
+        uint8_t index;
+        uint8_t data[kTapChunkSize];
+    };
+
+    Packet<TapChunk> tap_;
+    char tap_line_[(sizeof(tap_) + 3) / 4 * 5 + 1];
+    uint8_t tap_codec_;
+    uint32_t tap_dropped_;
+    adpcm::Encoder tap_encoder_;
+
+    Packet<CaptureChunk> capture_;
+    capture::Encoder encoder_;
+    bool capturing_;
+    uint32_t capture_length_;
+    uint32_t capture_age_;
+    char capture_line_[(sizeof(capture_) + 3) / 4 * 5 + 1];
+
+    void FlushCapture(void)
+    {
+        if (capture_length_ == 0)
+        {
+            return;
+        }
+
+        Send(kStreamHeader, capture_, capture_line_, capture_length_);
+        capture_length_ = 0;
+        capture_age_ = 0;
+    }
 
     void Ack(void)
     {
-        printf("\xff" "ack\n");
+        if (binary_)
+        {
+            SendFrame(kReplyHeader, "ack", 3);
+        }
+        else
+        {
+            printf("\xff" "ack\n");
+        }
     }
 
-    void PopulateState(const DeviceIO& io)
+    // Returns true once a line holds text or a verified packet
+    bool ReceiveLineByte(uint8_t byte)
+    {
+        if (byte != '\r' && byte != '\n')
+        {
+            // Overlong lines are truncated, and won't verify
+            if (length_ < sizeof(line_) - 1)
+            {
+                line_[length_++] = byte;
+            }
+
+            return false;
+        }
+
+        if (length_ == 0)
+        {
+            return false;
+        }
+
+        line_[length_] = '\0';
+        length_ = 0;
+
+        if (line_[0] == kReplyHeader && line_[1] != '\0')
+        {
+            a85::Decode(&message_, sizeof(message_), line_ + 1);
+
+            if (message_.Verify() && message_.size > 0)
+            {
+                data_length_ = message_.size - 1;
+                return true;
+            }
+
+            message_.payload.type = Message::TYPE_NONE;
+        }
+        else
+        {
+            message_.payload.type = Message::TYPE_TEXT;
+            std::strncpy(message_.payload.text, line_,
+                sizeof(message_.payload.text));
+            return true;
+        }
+
+        return false;
+    }
+
+    // Returns true once a frame holds a verified packet. Frames that don't
+    // fit or fail their CRC are dropped, and the host retries.
+    bool ReceiveFrameByte(uint8_t byte)
+    {
+        if (byte)
+        {
+            if (frame_length_ < sizeof(rx_frame_))
+            {
+                rx_frame_[frame_length_] = byte;
+            }
+
+            frame_length_++;
+            return false;
+        }
+
+        size_t encoded_length = frame_length_;
+        frame_length_ = 0;
+
+        if (encoded_length == 0 || encoded_length > sizeof(rx_frame_))
+        {
+            return false;
+        }
+
+        size_t length = cobs::Decode(rx_frame_, rx_frame_, encoded_length);
+
+        // Channel, type and CRC at least
+        if (length < 4 || length - 3 > sizeof(Message) ||
+            rx_frame_[0] != uint8_t(kReplyHeader))
+        {
+            return false;
+        }
+
+        uint16_t crc;
+        std::memcpy(&crc, rx_frame_ + length - 2, sizeof(crc));
+
+        if (crc16::Update(crc16::kInit, rx_frame_, length - 2) != crc)
+        {
+            return false;
+        }
+
+        std::memcpy(&message_.payload, rx_frame_ + 1, length - 3);
+        data_length_ = length - 4;
+        return true;
+    }
+
+    // Sends the first `length` bytes of a packet's payload in the host's
+    // framing; `line` holds its ASCII85 encoding
+    template <typename T, size_t line_size>
+    void Send(char header, Packet<T>& packet, char (&line)[line_size],
+        uint32_t length = sizeof(T))
+    {
+        if (binary_)
+        {
+            SendFrame(header, &packet.payload, length);
+        }
+        else
+        {
+            packet.Sign(length);
+            a85::Encode(line, line_size, &packet, packet.length());
+            printf("%c%s\n", header, line);
+        }
+    }
+
+    // Encodes a frame straight into the serial FIFO, a block at a time. Its
+    // payload is `head` followed by `data`, from wherever each is kept.
+    void SendFrame(char channel, const void* head, uint32_t head_size,
+        const void* data = nullptr, uint32_t size = 0)
+    {
+        static constexpr uint8_t kDelimiter = 0;
+        uint16_t crc = crc16::Update(crc16::kInit, channel);
+        crc = crc16::Update(crc, head, head_size);
+        crc = crc16::Update(crc, data, size);
+
+        cobs::Encoder encoder{[](const uint8_t* block, size_t length)
+        {
+            system::SerialWrite(block, length);
+        }};
+
+        system::SerialWrite(&kDelimiter, 1);
+        encoder.Put(channel);
+        encoder.Put(head, head_size);
+        encoder.Put(data, size);
+        encoder.Put(&crc, sizeof(crc));
+        encoder.Finish();
+        system::SerialWrite(&kDelimiter, 1);
+    }
+
+    void PopulateState(const DeviceIO& io, Analog& analog,
+        const LatencyMeter& latency)
     {
         auto& state = state_.payload;
         auto& human = io.human.in;
@@ -116,6 +582,17 @@ protected:
         state.loop = human.sw[SWITCH_LOOP];
         state.reverse = human.sw[SWITCH_REVERSE];
         state.line_in_detect = human.detect[DETECT_LINE_IN];
+
+        auto& load = analog.load();
+        state.load_avg = load.avg();
+        state.load_min = load.min();
+        state.load_max = load.max();
+        state.overruns = analog.overruns();
+        state.underruns = analog.underruns();
+
+        state.latency_last = latency.last() * 1e6f;
+        state.latency_avg = latency.avg() * 1e6f;
+        state.latency_max = latency.max() * 1e6f;
     }
 };
 
@@ -28,7 +28,9 @@ struct __attribute__ ((packed)) Packet
         auto bytes = reinterpret_cast<uint8_t*>(&payload);
         uint8_t sum = 0;
 
-        for (uint32_t i = 0; i < sizeof(T); i++)
+        // Only the bytes that were actually sent count; the remainder of the
+        // payload may hold stale data from an earlier, longer message.
+        for (uint32_t i = 0; i < size; i++)
         {
             sum += bytes[i];
         }
@@ -38,15 +40,27 @@ struct __attribute__ ((packed)) Packet
 
     void Sign(void)
     {
-        size = sizeof(T);
+        Sign(sizeof(T));
+    }
+
+    // Signs a variable-length packet holding only the first `length` bytes
+    // of the payload. Transmit length() bytes of the packet.
+    void Sign(uint32_t length)
+    {
+        size = length;
         auto bytes = reinterpret_cast<uint8_t*>(&(payload));
         checksum = 0;
 
-        for (uint32_t i = 0; i < sizeof(T); i++)
+        for (uint32_t i = 0; i < length; i++)
         {
             checksum += bytes[i];
         }
     }
+
+    uint32_t length(void) const
+    {
+        return 2 + size;
+    }
 };
 
 }
@@ -0,0 +1,533 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+#include "drivers/sample_memory.h"
+#include "drivers/flash.h"
+#include "drivers/crc.h"
+#include "common/config.h"
+#include "util/adpcm.h"
+#include "app/monitor/message.h"
+
+namespace recorder
+{
+
+// Reply to TYPE_TRANSFER_INFO, TYPE_DOWNLOAD, TYPE_UPLOAD and
+// TYPE_UPLOAD_END. Download replies carry the chunk's data after its header;
+// upload replies echo the header once the chunk has been stored.
+struct __attribute__ ((packed)) TransferReply
+{
+    enum Region
+    {
+        REGION_SAMPLES,
+        REGION_FLASH,
+    };
+
+    enum Codec
+    {
+        CODEC_RAW,
+        CODEC_ADPCM,
+    };
+
+    enum Status
+    {
+        STATUS_OK,
+        STATUS_BUSY,
+        STATUS_BAD_REQUEST,
+        STATUS_BAD_CRC,
+        STATUS_FLASH_ERROR,
+    };
+
+    // Most data a chunk holds when sent in binary frames or in lines
+    static constexpr uint32_t kFrameDataSize = 4080;
+    static constexpr uint32_t kLineDataSize = 64;
+
+    uint8_t type;
+    uint8_t status;
+
+    union
+    {
+        struct __attribute__ ((packed))
+        {
+            uint32_t sample_rate;
+            uint32_t sample_length;
+            uint32_t sample_capacity;
+            uint32_t sample_crc32;
+            uint32_t upload_length;
+            uint32_t flash_size;
+            uint32_t erase_size;
+            uint16_t max_data;
+        } info;
+
+        struct __attribute__ ((packed))
+        {
+            uint8_t region;
+            uint8_t codec;
+            uint32_t offset;
+            uint16_t length;
+            uint32_t crc32;
+        } chunk;
+    };
+};
+
+static_assert(offsetof(TransferReply, chunk) + sizeof(TransferReply::chunk) +
+    TransferReply::kFrameDataSize <= sizeof(Message));
+
+// Chunked transfers of sample memory and flash over the monitor link. The
+// host asks for one chunk at a time by offset, so an interrupted transfer
+// resumes wherever it stopped, and every chunk carries the CRC-32 of its data
+// as sent. The device may return fewer samples or bytes than asked for.
+//
+// Sample memory chunks are either the samples as stored or IMA ADPCM: the
+// predictor (int16) and step index (uint8, then a pad byte) the chunk starts
+// from, followed by a code per sample, low nibble first. Uploaded samples
+// become the recording with TYPE_UPLOAD_END.
+//
+// A flash upload erases the sectors that start within it, then programs a
+// page per main-loop pass and reads the data back before replying, so the
+// audio callback never waits on it.
+template <typename T>
+class Transfer
+{
+public:
+    Transfer(SampleMemory<T>& memory) : memory_{memory} {}
+
+    void Init(void)
+    {
+        crc_.Init();
+        operation_ = OPERATION_NONE;
+        ready_ = false;
+        upload_length_ = 0;
+        adpcm_offset_ = UINT32_MAX;
+    }
+
+    // Handles a transfer message. `allowed` is false while the audio
+    // callback is using sample memory, when only TYPE_TRANSFER_INFO works.
+    void Request(const Message& message, uint32_t data_length, bool binary,
+        bool allowed)
+    {
+        uint32_t max_data = binary ?
+            TransferReply::kFrameDataSize : TransferReply::kLineDataSize;
+
+        reply_.type = message.type;
+        reply_length_ = 2;
+        data_size_ = 0;
+        ready_ = true;
+
+        if (operation_ != OPERATION_NONE)
+        {
+            reply_.status = TransferReply::STATUS_BUSY;
+        }
+        else if (message.type == Message::TYPE_TRANSFER_INFO)
+        {
+            Info(max_data);
+        }
+        else if (!allowed)
+        {
+            reply_.status = TransferReply::STATUS_BUSY;
+        }
+        else if (message.type == Message::TYPE_DOWNLOAD)
+        {
+            Download(message, max_data);
+        }
+        else if (message.type == Message::TYPE_UPLOAD)
+        {
+            Upload(message, data_length);
+        }
+        else if (message.type == Message::TYPE_UPLOAD_END)
+        {
+            EndUpload(message);
+        }
+        else
+        {
+            reply_.status = TransferReply::STATUS_BAD_REQUEST;
+        }
+    }
+
+    // Runs a slice of any flash upload, and returns true when a reply is
+    // ready to send
+    bool Process(void)
+    {
+        auto& flash = memory_.flash();
+        auto& chunk = reply_.chunk;
+
+        if (operation_ == OPERATION_ERASE)
+        {
+            if (flash.FinishErase())
+            {
+                BeginWrite();
+            }
+        }
+        else if (operation_ == OPERATION_WRITE)
+        {
+            if (flash.FinishWrite())
+            {
+                operation_ = OPERATION_VERIFY;
+            }
+        }
+        else if (operation_ == OPERATION_VERIFY)
+        {
+            bool read = flash.Read(data_, chunk.offset, chunk.length);
+            bool match = read && Crc32(data_, chunk.length) == chunk.crc32;
+            reply_.status = match ?
+                TransferReply::STATUS_OK : TransferReply::STATUS_FLASH_ERROR;
+            operation_ = OPERATION_NONE;
+            ready_ = true;
+        }
+
+        bool ready = ready_;
+        ready_ = false;
+        return ready;
+    }
+
+    // Whether a flash upload is waiting on the flash
+    bool busy(void) const
+    {
+        return operation_ != OPERATION_NONE;
+    }
+
+    const TransferReply& reply(void) const
+    {
+        return reply_;
+    }
+
+    uint32_t reply_length(void) const
+    {
+        return reply_length_;
+    }
+
+    // Data that follows the reply: a download's chunk
+    const uint8_t* data(void) const
+    {
+        return data_;
+    }
+
+    uint32_t data_size(void) const
+    {
+        return data_size_;
+    }
+
+protected:
+    // Reply type and status, then the chunk's header
+    static constexpr uint32_t kChunkReplySize = 2 + 12;
+    static constexpr uint32_t kUploadHeaderSize = 12;
+    static constexpr uint32_t kAdpcmHeaderSize = 4;
+
+    // Bounds the time a chunk takes to convert
+    static constexpr uint32_t kMaxChunkSamples = 4096;
+
+    enum Operation
+    {
+        OPERATION_NONE,
+        OPERATION_ERASE,
+        OPERATION_WRITE,
+        OPERATION_VERIFY,
+    };
+
+    SampleMemory<T>& memory_;
+    Crc crc_;
+    TransferReply reply_;
+    uint32_t reply_length_;
+    bool ready_;
+    Operation operation_;
+    // A download's chunk, or an upload's on its way to flash; downloads
+    // wait for uploads to finish, so they never overlap
+    uint8_t data_[TransferReply::kFrameDataSize];
+    uint32_t data_size_;
+    uint32_t upload_length_;
+    adpcm::Encoder encoder_;
+    adpcm::Decoder decoder_;
+    uint32_t adpcm_offset_;
+
+    uint32_t Crc32(const uint8_t* data, uint32_t size)
+    {
+        crc_.Seed(0);
+        return crc_.Process(data, size);
+    }
+
+    static int16_t ToInt16(T sample)
+    {
+        float value = std::clamp<float>(sample, -1.f, 1.f);
+        return std::lrint(value * INT16_MAX);
+    }
+
+    static T FromInt16(int16_t sample)
+    {
+        return T(float(sample) / INT16_MAX);
+    }
+
+    static uint32_t AdpcmSize(uint32_t length)
+    {
+        return kAdpcmHeaderSize + (length + 1) / 2;
+    }
+
+    void Info(uint32_t max_data)
+    {
+        auto& info = reply_.info;
+        info.sample_rate = kAudioSampleRate;
+        info.sample_length = memory_.length();
+        info.sample_capacity = memory_.capacity();
+        info.sample_crc32 = memory_.crc32();
+        info.upload_length = upload_length_;
+        info.flash_size = Flash::kSize;
+        info.erase_size = Flash::kEraseGranularity;
+        info.max_data = max_data;
+        reply_.status = TransferReply::STATUS_OK;
+        reply_length_ = 2 + sizeof(info);
+    }
+
+    void Download(const Message& message, uint32_t max_data)
+    {
+        auto& request = message.download;
+        auto& chunk = reply_.chunk;
+        uint32_t offset = request.offset;
+        uint32_t length = request.length;
+        uint32_t size = 0;
+
+        chunk.region = request.region;
+        chunk.codec = request.codec;
+        chunk.offset = offset;
+        reply_.status = TransferReply::STATUS_OK;
+
+        if (request.region == TransferReply::REGION_SAMPLES &&
+            offset <= memory_.capacity())
+        {
+            length = std::min({length, memory_.capacity() - offset,
+                kMaxChunkSamples});
+
+            if (request.codec == TransferReply::CODEC_RAW)
+            {
+                length = std::min<uint32_t>(length, max_data / sizeof(T));
+
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    T sample = memory_.Read(offset + i);
+                    std::memcpy(&data_[i * sizeof(T)], &sample, sizeof(T));
+                }
+
+                size = length * sizeof(T);
+            }
+            else if (request.codec == TransferReply::CODEC_ADPCM)
+            {
+                length = std::min<uint32_t>(length,
+                    (max_data - kAdpcmHeaderSize) * 2);
+                size = EncodeAdpcm(data_, offset, length);
+            }
+            else
+            {
+                reply_.status = TransferReply::STATUS_BAD_REQUEST;
+            }
+        }
+        else if (request.region == TransferReply::REGION_FLASH &&
+            request.codec == TransferReply::CODEC_RAW &&
+            offset <= Flash::kSize)
+        {
+            length = std::min({length, Flash::kSize - offset, max_data});
+            size = length;
+
+            if (!memory_.flash().Read(data_, offset, length))
+            {
+                reply_.status = TransferReply::STATUS_FLASH_ERROR;
+            }
+        }
+        else
+        {
+            reply_.status = TransferReply::STATUS_BAD_REQUEST;
+        }
+
+        if (reply_.status == TransferReply::STATUS_OK)
+        {
+            chunk.length = length;
+            chunk.crc32 = Crc32(data_, size);
+            reply_length_ = kChunkReplySize;
+            data_size_ = size;
+        }
+    }
+
+    // Consecutive chunks continue the encoder's state; any other chunk
+    // starts from its first sample
+    uint32_t EncodeAdpcm(uint8_t* data, uint32_t offset, uint32_t length)
+    {
+        if (offset != adpcm_offset_ && length)
+        {
+            int16_t first = ToInt16(memory_.Read(offset));
+            int16_t second = (length > 1) ?
+                ToInt16(memory_.Read(offset + 1)) : first;
+            encoder_.Init(first, adpcm::StepIndex(second - first));
+        }
+
+        int16_t predictor = encoder_.predictor();
+        std::memcpy(data, &predictor, sizeof(predictor));
+        data[2] = encoder_.index();
+        data[3] = 0;
+        uint8_t* codes = data + kAdpcmHeaderSize;
+
+        for (uint32_t i = 0; i < length; i++)
+        {
+            uint8_t code = encoder_.Process(ToInt16(memory_.Read(offset + i)));
+
+            if (i % 2)
+            {
+                codes[i / 2] |= code << 4;
+            }
+            else
+            {
+                codes[i / 2] = code;
+            }
+        }
+
+        adpcm_offset_ = offset + length;
+        return AdpcmSize(length);
+    }
+
+    void Upload(const Message& message, uint32_t data_length)
+    {
+        auto& request = message.upload;
+        auto& chunk = reply_.chunk;
+        uint32_t offset = request.offset;
+        uint32_t length = request.length;
+        uint32_t size = data_length - std::min(data_length, kUploadHeaderSize);
+
+        chunk.region = request.region;
+        chunk.codec = request.codec;
+        chunk.offset = offset;
+        chunk.length = length;
+        chunk.crc32 = request.crc32;
+        reply_length_ = kChunkReplySize;
+        reply_.status = TransferReply::STATUS_OK;
+
+        if (data_length < kUploadHeaderSize ||
+            Crc32(request.data, size) != request.crc32)
+        {
+            reply_.status = TransferReply::STATUS_BAD_CRC;
+        }
+        else if (request.region == TransferReply::REGION_SAMPLES &&
+            offset <= memory_.capacity() &&
+            length <= memory_.capacity() - offset &&
+            ((request.codec == TransferReply::CODEC_RAW &&
+                size == length * sizeof(T)) ||
+            (request.codec == TransferReply::CODEC_ADPCM &&
+                size == AdpcmSize(length))))
+        {
+            if (request.codec == TransferReply::CODEC_RAW)
+            {
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    T sample;
+                    std::memcpy(&sample, &request.data[i * sizeof(T)],
+                        sizeof(T));
+                    memory_.Overwrite(sample, offset + i);
+                }
+            }
+            else
+            {
+                DecodeAdpcm(request.data, offset, length);
+            }
+
+            // Uploads start over from zero, and only grow while contiguous
+            if (offset == 0)
+            {
+                upload_length_ = length;
+            }
+            else if (offset <= upload_length_)
+            {
+                upload_length_ = std::max(upload_length_, offset + length);
+            }
+        }
+        else if (request.region == TransferReply::REGION_FLASH &&
+            request.codec == TransferReply::CODEC_RAW &&
+            offset <= Flash::kSize && length <= Flash::kSize - offset &&
+            size == length && length <= sizeof(data_))
+        {
+            std::memcpy(data_, request.data, length);
+            BeginUpload();
+        }
+        else
+        {
+            reply_.status = TransferReply::STATUS_BAD_REQUEST;
+        }
+    }
+
+    void DecodeAdpcm(const uint8_t* data, uint32_t offset, uint32_t length)
+    {
+        int16_t predictor;
+        std::memcpy(&predictor, data, sizeof(predictor));
+        decoder_.Init(predictor, data[2]);
+        const uint8_t* codes = data + kAdpcmHeaderSize;
+
+        for (uint32_t i = 0; i < length; i++)
+        {
+            uint8_t code = codes[i / 2] >> ((i % 2) * 4);
+            memory_.Overwrite(FromInt16(decoder_.Process(code)), offset + i);
+        }
+    }
+
+    void BeginUpload(void)
+    {
+        auto& chunk = reply_.chunk;
+        uint32_t granularity = Flash::kEraseGranularity;
+        uint32_t erase_start =
+            (chunk.offset + granularity - 1) / granularity * granularity;
+        uint32_t erase_end =
+            (chunk.offset + chunk.length + granularity - 1) /
+            granularity * granularity;
+
+        ready_ = false;
+
+        if (erase_start < erase_end)
+        {
+            if (memory_.flash().BeginErase(erase_start,
+                erase_end - erase_start))
+            {
+                operation_ = OPERATION_ERASE;
+            }
+            else
+            {
+                reply_.status = TransferReply::STATUS_FLASH_ERROR;
+                ready_ = true;
+            }
+        }
+        else
+        {
+            BeginWrite();
+        }
+    }
+
+    void BeginWrite(void)
+    {
+        auto& chunk = reply_.chunk;
+
+        if (memory_.flash().BeginWrite(chunk.offset, data_,
+            chunk.length))
+        {
+            operation_ = OPERATION_WRITE;
+        }
+        else
+        {
+            reply_.status = TransferReply::STATUS_FLASH_ERROR;
+            operation_ = OPERATION_NONE;
+            ready_ = true;
+        }
+    }
+
+    void EndUpload(const Message& message)
+    {
+        uint32_t length = message.upload_end.length;
+
+        if (length <= upload_length_)
+        {
+            memory_.SetRecording(length);
+            reply_.status = TransferReply::STATUS_OK;
+        }
+        else
+        {
+            reply_.status = TransferReply::STATUS_BAD_REQUEST;
+        }
+    }
+};
+
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <array>
+
+#include "common/io.h"
+
+namespace recorder::capture
+{
+
+// Input capture stream format
+//
+// A capture is a header followed by a sequence of records. Each record holds
+// the inputs seen by one main-loop iteration, delta-encoded against the
+// previous record, and is only emitted when something changed:
+//
+//   uint8   flags          FLAG_* bits below
+//   varint  loop delta     main-loop iterations since the previous record
+//   varint  callback delta audio callbacks since the previous record
+//   [varint switches]      one bit per SwitchID        (FLAG_SWITCHES)
+//   [uint8  detects]       one bit per DetectID        (FLAG_SWITCHES)
+//   [uint8  pot mask]      one bit per PotID           (FLAG_POTS)
+//   [varint pot deltas]    zigzag, 16-bit quantized, one per mask bit
+//
+// Timestamps are in audio callback ticks (1 / kAudioSampleRate) plus the
+// main-loop iteration count, so a replay can interleave the state machine and
+// the audio callback exactly as they ran on the device.
+
+constexpr uint8_t kMagic[4] = {'R', 'C', 'A', 'P'};
+constexpr uint8_t kVersion = 1;
+constexpr uint32_t kHeaderSize = 8;
+constexpr uint32_t kMaxRecordSize = 1 + 5 + 5 + 3 + 1 + 1 + NUM_POTS * 3;
+
+enum Flag
+{
+    FLAG_SWITCHES = 1 << 0,
+    FLAG_POTS     = 1 << 1,
+};
+
+struct Frame
+{
+    uint32_t loop;
+    uint32_t callback;
+    PotInput pot;
+    uint16_t sw;
+    uint8_t detect;
+
+    void Read(const HumanInput& in)
+    {
+        pot = in.pot;
+        sw = 0;
+        detect = 0;
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            sw |= in.sw[i] << i;
+        }
+
+        for (uint32_t i = 0; i < NUM_DETECTS; i++)
+        {
+            detect |= in.detect[i] << i;
+        }
+    }
+
+    void Write(HumanInput& in) const
+    {
+        in.pot = pot;
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            in.sw[i] = (sw >> i) & 1;
+        }
+
+        for (uint32_t i = 0; i < NUM_DETECTS; i++)
+        {
+            in.detect[i] = (detect >> i) & 1;
+        }
+    }
+};
+
+inline uint16_t QuantizePot(float pot)
+{
+    return std::clamp(pot, 0.f, 1.f) * 0xFFFF + 0.5f;
+}
+
+inline float UnquantizePot(uint16_t code)
+{
+    return code / float(0xFFFF);
+}
+
+inline uint8_t* PutVarint(uint8_t* p, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = value | 0x80;
+        value >>= 7;
+    }
+
+    *p++ = value;
+    return p;
+}
+
+inline const uint8_t* GetVarint(const uint8_t* p, const uint8_t* end,
+    uint32_t& value)
+{
+    value = 0;
+
+    for (uint32_t shift = 0; p < end && shift < 35; shift += 7)
+    {
+        uint8_t byte = *p++;
+        value |= uint32_t(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return p;
+        }
+    }
+
+    return nullptr;
+}
+
+inline uint32_t ZigZag(int32_t value)
+{
+    return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+inline int32_t UnZigZag(uint32_t value)
+{
+    return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+class Encoder
+{
+public:
+    void Init(void)
+    {
+        first_ = true;
+    }
+
+    static uint32_t Header(uint8_t* buffer)
+    {
+        std::copy(kMagic, kMagic + 4, buffer);
+        buffer[4] = kVersion;
+        buffer[5] = NUM_POTS;
+        buffer[6] = NUM_SWITCHES;
+        buffer[7] = NUM_DETECTS;
+        return kHeaderSize;
+    }
+
+    // Writes at most kMaxRecordSize bytes. Returns the record length, or 0 if
+    // nothing changed since the last record.
+    uint32_t Encode(const Frame& frame, uint8_t* buffer)
+    {
+        uint16_t pot[NUM_POTS];
+        uint8_t pot_mask = 0;
+        uint8_t flags = 0;
+
+        for (uint32_t i = 0; i < NUM_POTS; i++)
+        {
+            pot[i] = QuantizePot(frame.pot[i]);
+
+            if (first_ || pot[i] != pot_[i])
+            {
+                pot_mask |= 1 << i;
+            }
+        }
+
+        if (first_ || frame.sw != sw_ || frame.detect != detect_)
+        {
+            flags |= FLAG_SWITCHES;
+        }
+
+        if (pot_mask)
+        {
+            flags |= FLAG_POTS;
+        }
+
+        if (flags == 0)
+        {
+            return 0;
+        }
+
+        uint8_t* p = buffer;
+        *p++ = flags;
+        p = PutVarint(p, first_ ? frame.loop : frame.loop - loop_);
+        p = PutVarint(p, first_ ? frame.callback : frame.callback - callback_);
+
+        if (flags & FLAG_SWITCHES)
+        {
+            p = PutVarint(p, frame.sw);
+            *p++ = frame.detect;
+        }
+
+        if (flags & FLAG_POTS)
+        {
+            *p++ = pot_mask;
+
+            for (uint32_t i = 0; i < NUM_POTS; i++)
+            {
+                if (pot_mask & (1 << i))
+                {
+                    p = PutVarint(p, ZigZag(pot[i] - (first_ ? 0 : pot_[i])));
+                    pot_[i] = pot[i];
+                }
+            }
+        }
+
+        loop_ = frame.loop;
+        callback_ = frame.callback;
+        sw_ = frame.sw;
+        detect_ = frame.detect;
+        first_ = false;
+        return p - buffer;
+    }
+
+protected:
+    bool first_;
+    uint32_t loop_;
+    uint32_t callback_;
+    uint16_t sw_;
+    uint8_t detect_;
+    uint16_t pot_[NUM_POTS];
+};
+
+class Decoder
+{
+public:
+    void Init(void)
+    {
+        frame_ = {};
+        pot_code_.fill(0);
+    }
+
+    // Returns a pointer past the header, or nullptr if it doesn't match this
+    // build's input layout.
+    static const uint8_t* Header(const uint8_t* p, const uint8_t* end)
+    {
+        if (end - p < int32_t(kHeaderSize) ||
+            !std::equal(kMagic, kMagic + 4, p) ||
+            p[4] != kVersion ||
+            p[5] != NUM_POTS || p[6] != NUM_SWITCHES || p[7] != NUM_DETECTS)
+        {
+            return nullptr;
+        }
+
+        return p + kHeaderSize;
+    }
+
+    // Decodes one record. Returns a pointer past it, or nullptr if the stream
+    // is truncated or corrupt.
+    const uint8_t* Decode(const uint8_t* p, const uint8_t* end, Frame& frame)
+    {
+        uint32_t value;
+
+        if (p >= end)
+        {
+            return nullptr;
+        }
+
+        uint8_t flags = *p++;
+
+        if (!(p = GetVarint(p, end, value)))
+        {
+            return nullptr;
+        }
+
+        frame_.loop += value;
+
+        if (!(p = GetVarint(p, end, value)))
+        {
+            return nullptr;
+        }
+
+        frame_.callback += value;
+
+        if (flags & FLAG_SWITCHES)
+        {
+            if (!(p = GetVarint(p, end, value)) || p >= end)
+            {
+                return nullptr;
+            }
+
+            frame_.sw = value;
+            frame_.detect = *p++;
+        }
+
+        if (flags & FLAG_POTS)
+        {
+            if (p >= end)
+            {
+                return nullptr;
+            }
+
+            uint8_t pot_mask = *p++;
+
+            for (uint32_t i = 0; i < NUM_POTS; i++)
+            {
+                if (pot_mask & (1 << i))
+                {
+                    if (!(p = GetVarint(p, end, value)))
+                    {
+                        return nullptr;
+                    }
+
+                    pot_code_[i] += UnZigZag(value);
+                    frame_.pot[i] = UnquantizePot(pot_code_[i]);
+                }
+            }
+        }
+
+        frame = frame_;
+        return p;
+    }
+
+protected:
+    Frame frame_;
+    std::array<uint16_t, NUM_POTS> pot_code_;
+};
+
+}
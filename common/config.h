@@ -13,6 +13,9 @@ constexpr float kAudioOSRate = kAudioSampleRate * kAudioOSFactor;
 constexpr float kAudioOutputLevel = .95;
 constexpr float kAudioFadeTime = 20e-3;
 constexpr uint32_t kButtonDebounceDuration_ms = 10;
+// From an input changing to the synth hearing it; covers the main loop's
+// reaction time, so keys and strums land with a constant latency
+constexpr float kControlDelay = 1e-3;
 constexpr float kIdleStandbyTime = 30;
 constexpr float kPlaybackExpireTime = 60 * 5;
 constexpr float kButtonTapLength_ms = 500; //what is considered a tap vs hold
@@ -42,4 +45,10 @@ constexpr bool kADCAlwaysOn = true;
 constexpr bool kADCAlwaysOn = false;
 #endif
 
+#if !defined(NDEBUG) && defined(ENABLE_PROFILER)
+constexpr bool kEnableProfiler = true;
+#else
+constexpr bool kEnableProfiler = false;
+#endif
+
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "util/event_flags.h"
+
+// Events that wake the main loop.
+//
+// The main loop sleeps in system::WaitForEvents() until an interrupt posts
+// one of these, then runs a whole pass: messages, transfers, the state
+// machine, logs and the tap. Timeouts and debouncing count EVENT_TICK, the
+// 1 ms housekeeping tick, so they keep time however often the loop wakes.
+namespace recorder::events
+{
+
+enum Event : uint32_t
+{
+    // 1 ms housekeeping tick
+    EVENT_TICK   = 1 << 0,
+    // A switch or detect pin changed
+    EVENT_SWITCH = 1 << 1,
+    // The strum or chord pot moved to another position
+    EVENT_POTS   = 1 << 2,
+    // Bytes arrived on the serial port
+    EVENT_SERIAL = 1 << 3,
+    // A poll requested with system::RequestPoll() is due
+    EVENT_POLL   = 1 << 4,
+    // The audio callbacks changed state (a fade-out ended)
+    EVENT_AUDIO  = 1 << 5,
+};
+
+inline EventFlags flags_;
+
+inline void Post(uint32_t events)
+{
+    flags_.Post(events);
+}
+
+}
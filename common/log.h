@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+// Deferred binary logging.
+//
+// LOG("Erased %u sectors in %u ms", sectors, ms) costs a queue push: the
+// record holds the format string's ID and the raw arguments, and nothing is
+// formatted or transmitted until the main loop drains the queue (see
+// Monitor::DrainLog()). The format strings go in log_strings sections,
+// which the device doesn't load, so factory/log_decoder.py recovers the text
+// from the ELF file. Logging never blocks, and works from interrupts; when
+// the queue is full the record is dropped and counted.
+//
+// Arguments are integers of up to 32 bits, floats and doubles (sent as
+// float), and pointers to constant strings, which must live in the firmware
+// image (%s of a string literal or a const table, never a buffer).
+//
+// Each string gets a section of its own (log_strings.<n>), as the strings
+// of inline functions live in COMDAT groups and can't share a section with
+// the others.
+#define LOG(format, ...) \
+    LOG_IMPL(__COUNTER__, format __VA_OPT__(,) __VA_ARGS__)
+#define LOG_IMPL(n, format, ...) \
+    do \
+    { \
+        [[gnu::section("log_strings." LOG_STRINGIFY(n)), gnu::used]] \
+        static const char log_format_[] = format; \
+        ::recorder::log::Write(log_format_ __VA_OPT__(,) __VA_ARGS__); \
+    } while (0)
+#define LOG_STRINGIFY(x) LOG_STRINGIFY_(x)
+#define LOG_STRINGIFY_(x) #x
+
+// Strings are identified by their offset from this symbol, which the decoder
+// looks up, so the IDs don't depend on where the image is loaded.
+extern "C" [[gnu::used]] inline const char recorder_log_anchor[1] = "";
+
+namespace recorder::log
+{
+
+constexpr uint32_t kMaxArgs = 4;
+
+struct Record
+{
+    int32_t format;
+    uint8_t num_args;
+    uint32_t args[kMaxArgs];
+};
+
+// Bounded multi-producer queue after Dmitry Vyukov's: each slot's sequence
+// number says whether it is free for the producer that claimed its position
+// or holds a record for the consumer, so producers that interrupt each other
+// never wait on one another. Sequence numbers are stored relative to the
+// slot index, so the all-zero state of a static Queue is the empty queue and
+// LOG works before anything is initialized.
+class Queue
+{
+public:
+    static constexpr uint32_t kSize = 64;
+
+    bool Push(const Record& record)
+    {
+        uint32_t position = push_position_.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Slot& slot = slots_[position % kSize];
+            uint32_t sequence = position % kSize +
+                slot.sequence.load(std::memory_order_acquire);
+            int32_t difference = sequence - position;
+
+            if (difference == 0)
+            {
+                if (push_position_.compare_exchange_weak(position,
+                    position + 1, std::memory_order_relaxed))
+                {
+                    slot.record = record;
+                    slot.sequence.store(position + 1 - position % kSize,
+                        std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = push_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer
+    bool Pop(Record& record)
+    {
+        uint32_t index = pop_position_ % kSize;
+        Slot& slot = slots_[index];
+        uint32_t sequence =
+            index + slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence != pop_position_ + 1)
+        {
+            return false;
+        }
+
+        record = slot.record;
+        slot.sequence.store(pop_position_ + kSize - index,
+            std::memory_order_release);
+        pop_position_++;
+        return true;
+    }
+
+    // Records dropped since the last call
+    uint32_t TakeDropped(void)
+    {
+        return dropped_.exchange(0, std::memory_order_relaxed);
+    }
+
+protected:
+    static_assert((kSize & (kSize - 1)) == 0, "size must be a power of 2");
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        Record record;
+    };
+
+    Slot slots_[kSize];
+    std::atomic<uint32_t> push_position_;
+    uint32_t pop_position_;
+    std::atomic<uint32_t> dropped_;
+};
+
+inline Queue queue_;
+
+inline int32_t Offset(const char* string)
+{
+    return string - recorder_log_anchor;
+}
+
+template <typename T>
+inline uint32_t Word(T arg)
+{
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        float value = arg;
+        uint32_t word;
+        std::memcpy(&word, &value, sizeof(word));
+        return word;
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        static_assert(std::is_same_v<std::remove_cv_t<
+            std::remove_pointer_t<T>>, char>, "only strings can be logged");
+        return Offset(arg);
+    }
+    else
+    {
+        static_assert(sizeof(T) <= sizeof(uint32_t),
+            "arguments are at most 32 bits");
+        return static_cast<uint32_t>(arg);
+    }
+}
+
+template <typename... Args>
+inline void Write(const char* format, Args... args)
+{
+    static_assert(sizeof...(args) <= kMaxArgs, "too many log arguments");
+    Record record = {Offset(format), sizeof...(args), {Word(args)...}};
+    queue_.Push(record);
+}
+
+}
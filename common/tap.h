@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+
+#include "util/fifo.h"
+
+// Live audio tap.
+//
+// tap::tap_.Write(tap::POINT_DELAY, sample) offers a signal to the tap from
+// anywhere in the audio path. The point the host selected is averaged down
+// by its decimation factor and queued as 16-bit samples for the main loop,
+// which compresses them and streams them over the monitor link (see
+// Monitor::DrainTap()); the other points cost a compare.
+//
+// The audio callback never waits for the link. When the queue fills up it
+// drops samples, and keeps dropping until the main loop has emptied the
+// queue and counted them, so each gap sits at a known place in the stream.
+namespace recorder::tap
+{
+
+enum Point : uint8_t
+{
+    POINT_OFF,
+    POINT_OUTPUT,
+    POINT_MIC,
+    POINT_LINE_IN,
+    POINT_SYNTH_VOICES,
+    POINT_SYNTH_COMPRESSOR,
+    POINT_DELAY,
+    NUM_POINTS,
+};
+
+constexpr uint32_t kMaxDecimation = 16;
+
+class Tap
+{
+public:
+    // 128 ms at 8 kHz, the fastest ADPCM a 115200 baud link carries in
+    // lines: four packets
+    static constexpr uint32_t kSize = 1024;
+
+    // Main loop: selects a point and decimation factor, discarding what was
+    // queued from the last one
+    void Select(uint8_t point, uint32_t decimation)
+    {
+        if (point >= NUM_POINTS)
+        {
+            point = POINT_OFF;
+        }
+
+        decimation = std::clamp<uint32_t>(decimation, 1, kMaxDecimation);
+        config_.store(point | decimation << 8, std::memory_order_relaxed);
+        fifo_.Flush();
+        dropped_.store(0, std::memory_order_relaxed);
+        position_ = 0;
+    }
+
+    bool selected(void) const
+    {
+        return (config_.load(std::memory_order_relaxed) & 0xFF) != POINT_OFF;
+    }
+
+    uint32_t decimation(void) const
+    {
+        return config_.load(std::memory_order_relaxed) >> 8;
+    }
+
+    // Audio callback
+    void Write(Point point, float sample)
+    {
+        uint32_t config = config_.load(std::memory_order_relaxed);
+
+        if (point != (config & 0xFF))
+        {
+            return;
+        }
+
+        if (config != config_seen_)
+        {
+            config_seen_ = config;
+            sum_ = 0;
+            count_ = 0;
+        }
+
+        sum_ += sample;
+
+        if (++count_ < (config >> 8))
+        {
+            return;
+        }
+
+        float average = std::clamp<float>(sum_ / count_, -1, 1);
+        sum_ = 0;
+        count_ = 0;
+
+        if (dropped_.load(std::memory_order_acquire) == 0 &&
+            fifo_.Push(int16_t(average * INT16_MAX)))
+        {
+            return;
+        }
+
+        dropped_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Audio callback: taps an oversampled block at the base rate
+    template <uint32_t size>
+    void Write(Point point, const float (&block)[size])
+    {
+        if (point != (config_.load(std::memory_order_relaxed) & 0xFF))
+        {
+            return;
+        }
+
+        float sum = 0;
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            sum += block[i];
+        }
+
+        Write(point, sum / size);
+    }
+
+    uint32_t available(void)
+    {
+        return fifo_.available();
+    }
+
+    // Whether the callback is dropping samples until the queue is emptied
+    bool dropping(void) const
+    {
+        return dropped_.load(std::memory_order_relaxed) != 0;
+    }
+
+    // Stream index of the next sample popped
+    uint32_t position(void) const
+    {
+        return position_;
+    }
+
+    // Main loop: pops up to `size` samples, returning how many
+    uint32_t Pop(int16_t* samples, uint32_t size)
+    {
+        uint32_t length = fifo_.PopSpan(samples, size);
+        position_ += length;
+        return length;
+    }
+
+    // Main loop: once the queue is empty, returns the samples dropped after
+    // the last one popped, and lets the callback queue samples again
+    uint32_t TakeDropped(void)
+    {
+        if (!fifo_.empty())
+        {
+            return 0;
+        }
+
+        uint32_t dropped = dropped_.exchange(0, std::memory_order_acq_rel);
+        position_ += dropped;
+        return dropped;
+    }
+
+protected:
+    // Point in the low byte, decimation above it
+    std::atomic<uint32_t> config_;
+    std::atomic<uint32_t> dropped_;
+    Fifo<int16_t, kSize> fifo_;
+    uint32_t position_;
+
+    // Owned by the audio callback
+    uint32_t config_seen_;
+    float sum_;
+    uint32_t count_;
+};
+
+inline Tap tap_;
+
+}
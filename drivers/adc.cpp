@@ -114,6 +114,11 @@ void Adc::InitDMA(void)
     LL_DMA_DisableIT_HT(DMA1, LL_DMA_STREAM_1);
 }
 
+// Index of the next word the DMA will write
+uint32_t Adc::DMAPosition(void)
+{
+    return kDMABufferSize - LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_1);
+}
 
 void Adc::DMAService(void)
 {
@@ -264,6 +269,7 @@ void Adc::Init(Callback callback)
     instance_ = this;
     callback_ = callback;
     started_ = false;
+    overruns_ = 0;
 
     for (uint32_t i = 0; i < NUM_POTS; i++)
     {
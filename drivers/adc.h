@@ -21,10 +21,17 @@ public:
     void Start(void);
     void Stop(void);
 
+    // Callbacks that found the DMA still writing the half they read
+    uint32_t overruns(void) const
+    {
+        return overruns_;
+    }
+
 protected:
     static inline Adc* instance_;
     Callback callback_;
     bool started_;
+    uint32_t overruns_;
 
     struct PotFilter
     {
@@ -122,6 +129,7 @@ protected:
     void InitGPIO(void);
 
     void InitDMA(void);
+    uint32_t DMAPosition(void);
     void DMAService(void);
     static void DMAHandler(void);
 
@@ -137,6 +145,16 @@ protected:
         PotInput pot;
         AudioInput audio;
 
+        // The half about to be read must be the one the DMA just finished,
+        // not the one it is filling; otherwise the callback came too late.
+        uint32_t behind = (DMAPosition() + kDMABufferSize - read_index_) %
+            kDMABufferSize;
+
+        if (behind < kDMABufferSize / 2)
+        {
+            overruns_++;
+        }
+
         for (uint32_t i = 0; i < NUM_POTS; i++)
         {
             pot[i] = pot_filter_[i].Next();
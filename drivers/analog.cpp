@@ -26,6 +26,9 @@ void Analog::Init(Callback callback)
     fade_position_ = 0;
     state_ = STATE_STOPPED;
     cue_stop_ = false;
+    callbacks_.store(0, std::memory_order_relaxed);
+    cycle_counter::Init();
+    load_meter_.Init(kAudioSampleRate, cycle_counter::kFrequency);
     Stop();
 }
 
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
 #include "drivers/gpio.h"
 #include "drivers/adc.h"
 #include "drivers/dac.h"
+#include "drivers/cycle_counter.h"
+#include "util/cpu_load_meter.h"
+#include "util/lut.h"
 
 #include "common/io.h"
 #include "common/config.h"
+#include "common/events.h"
 
 namespace recorder
 {
@@ -45,6 +53,35 @@ namespace recorder
             return state_ == STATE_STOPPED;
         }
 
+        // Number of audio callback periods serviced since Init(), counting
+        // fades as well as live processing.
+        uint32_t callbacks(void)
+        {
+            return callbacks_.load(std::memory_order_relaxed);
+        }
+
+        // Share of the callback period spent servicing it
+        const CpuLoadMeter& load(void)
+        {
+            return load_meter_;
+        }
+
+        void ResetLoad(void)
+        {
+            load_meter_.Reset();
+        }
+
+        // Callbacks that ran too late for the input or output DMA buffers
+        uint32_t overruns(void)
+        {
+            return adc_.overruns();
+        }
+
+        uint32_t underruns(void)
+        {
+            return dac_.underruns();
+        }
+
         void Start(bool enable_amplifier)
         {
             if (state_ == STATE_STOPPED)
@@ -93,11 +130,12 @@ namespace recorder
             STATE_STOPPING,
         };
 
-        static constexpr float kPi = 3.141592653589793;
         static constexpr float kFadeDuration = kAudioOSRate * 50e-3;
         float fade_position_;
         State state_;
         bool cue_stop_;
+        std::atomic<uint32_t> callbacks_;
+        CpuLoadMeter load_meter_;
 
         void InitTimer(void);
         void StartTimer(void);
@@ -111,13 +149,15 @@ namespace recorder
 
         float FadeCurve(float tau)
         {
-            tau = std::clamp<float>(tau, 0, 1);
-            return 0.5 * (1 - std::cos(kPi * tau)) - 1;
+            return lut::RaisedCosine(tau) - 1;
         }
 
         void Service(const AudioInput &in, const PotInput &pot)
         {
             AudioOutput out;
+            load_meter_.OnBlockStart(cycle_counter::Read());
+            callbacks_.store(callbacks_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
 
             if (state_ == STATE_STARTING)
             {
@@ -170,10 +210,12 @@ namespace recorder
                     dac_.Stop();
                     amp_enable_.Clear();
                     boost_enable_.Clear();
+                    events::Post(events::EVENT_AUDIO);
                 }
             }
 
             dac_.Process(out);
+            load_meter_.OnBlockEnd(cycle_counter::Read());
         }
     };
 
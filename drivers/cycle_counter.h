@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include "libDaisy/Drivers/CMSIS/Device/ST/STM32H7xx/Include/stm32h7xx.h"
+#include "drivers/system.h"
+
+namespace recorder::cycle_counter
+{
+
+// Free-running count of core clock cycles from the DWT unit. It wraps every
+// 67 s at 64 MHz, so only differences of up to that long are meaningful.
+// Init() leaves the count running, so it is safe to call from every user.
+constexpr uint32_t kFrequency = system::kSystemClock;
+
+inline void Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t Read(void)
+{
+    return DWT->CYCCNT;
+}
+
+}
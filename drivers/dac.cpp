@@ -12,6 +12,7 @@ namespace recorder
 void Dac::Init(void)
 {
     started_ = false;
+    underruns_ = 0;
     Reset();
     InitGPIO();
     InitDAC();
@@ -132,6 +133,12 @@ void Dac::InitDMA(void)
     irq::Enable(DMA1_Stream0_IRQn);
 }
 
+// Index of the next word the DMA will read
+uint32_t Dac::DMAPosition(void)
+{
+    return kDMABufferSize - LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
+}
+
 void Dac::DMAHandler(void)
 {
     ScopedProfilingPin<PROFILE_DAC_DMA_SERVICE> profile;
@@ -15,6 +15,16 @@ public:
 
     void Process(const AudioOutput& audio)
     {
+        // The DMA should be playing the other half; if it has already reached
+        // this one, the callback came too late and the output glitched.
+        uint32_t ahead = (DMAPosition() + kDMABufferSize - write_index_) %
+            kDMABufferSize;
+
+        if (started_ && ahead < kDMABufferSize / 2)
+        {
+            underruns_++;
+        }
+
         for (uint32_t i = 0; i < kAudioOSFactor; i++)
         {
             float sample = audio[AUDIO_OUT_LINE][i];
@@ -28,16 +38,24 @@ public:
     void Start(void);
     void Stop(void);
 
+    // Callbacks that wrote a half the DMA had already started playing
+    uint32_t underruns(void) const
+    {
+        return underruns_;
+    }
+
 protected:
     void InitGPIO(void);
     void InitDAC(void);
     void InitDMA(void);
+    uint32_t DMAPosition(void);
     void Reset(void);
 
     static constexpr uint32_t kDMABufferSize = kAudioOSFactor * 2;
     __attribute__ ((section (".dma")))
     static inline uint32_t dma_buffer_[kDMABufferSize];
     uint32_t write_index_;
+    uint32_t underruns_;
     bool started_;
 
     static void DMAHandler(void);
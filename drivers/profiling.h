@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <algorithm>
+
+#include "common/config.h"
 #include "drivers/gpio.h"
+#include "drivers/cycle_counter.h"
 
 namespace recorder
 {
@@ -32,12 +37,18 @@ enum Profile
     PROFILE_SYSTEM_INIT,
 
     PROFILE_PROCESS,
+    PROFILE_SYNTH,
+    PROFILE_JINGLE,
+    PROFILE_PLAYBACK,
+    PROFILE_RECORDING,
 
     DUMMY0,
     DUMMY1,
     DUMMY2,
     DUMMY3,
     DUMMY4,
+
+    NUM_PROFILES
 };
 
 namespace profiling
@@ -48,9 +59,91 @@ namespace impl
 #include "profiling_impl.inc.h"
 }
 
+// Software profiler behind the same pins. With kEnableProfiler, every
+// Set()/Clear() pair of every profile is timed with the cycle counter into a
+// fixed table of statistics, which the monitor can report.
+class Profiler
+{
+public:
+    // Bin n counts durations of [2^n, 2^(n+1)) cycles; the last bin also
+    // takes everything longer.
+    static constexpr uint32_t kHistogramBins = 24;
+
+    struct __attribute__ ((packed)) Stats
+    {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t total;
+        uint32_t histogram[kHistogramBins];
+    };
+
+    static void Init(void)
+    {
+        cycle_counter::Init();
+        Reset();
+    }
+
+    static void Reset(void)
+    {
+        for (auto& stats : stats_)
+        {
+            stats = {};
+            stats.min = UINT32_MAX;
+        }
+    }
+
+    // Pins are level-triggered: setting a pin that is already set (as the
+    // flash driver does while it polls) doesn't restart its scope, and
+    // clearing one that isn't set records nothing.
+    static void Begin(Profile profile)
+    {
+        if (!running_[profile])
+        {
+            running_[profile] = true;
+            start_[profile] = cycle_counter::Read();
+        }
+    }
+
+    static void End(Profile profile)
+    {
+        if (!running_[profile])
+        {
+            return;
+        }
+
+        running_[profile] = false;
+        uint32_t cycles = cycle_counter::Read() - start_[profile];
+        auto& stats = stats_[profile];
+        stats.count++;
+        stats.min = std::min(stats.min, cycles);
+        stats.max = std::max(stats.max, cycles);
+        stats.total += cycles;
+        uint32_t bin = 31 - __builtin_clz(cycles | 1);
+        stats.histogram[std::min(bin, kHistogramBins - 1)]++;
+    }
+
+    // Not synchronized with the code being profiled, so a scope that ends
+    // during the copy may be half counted.
+    static const Stats& stats(uint32_t profile)
+    {
+        return stats_[profile];
+    }
+
+protected:
+    static inline bool running_[NUM_PROFILES];
+    static inline uint32_t start_[NUM_PROFILES];
+    static inline Stats stats_[NUM_PROFILES];
+};
+
 inline void Init(void)
 {
     impl::Init();
+
+    if constexpr (kEnableProfiler)
+    {
+        Profiler::Init();
+    }
 }
 
 }
@@ -62,16 +155,26 @@ public:
     static void Set(void)
     {
         profiling::impl::ProfilingPin<profile>::Set();
+
+        if constexpr (kEnableProfiler)
+        {
+            profiling::Profiler::Begin(profile);
+        }
     }
 
     static void Clear(void)
     {
+        if constexpr (kEnableProfiler)
+        {
+            profiling::Profiler::End(profile);
+        }
+
         profiling::impl::ProfilingPin<profile>::Clear();
     }
 
     static void Write(bool state)
     {
-        profiling::impl::ProfilingPin<profile>::Write(state);
+        state ? Set() : Clear();
     }
 
     static void Toggle(void)
@@ -115,11 +115,31 @@ public:
         return buffer_chain_[index];
     }
 
+    uint32_t Read(size_t index, float* items, uint32_t length)
+    {
+        return buffer_chain_.Read(index, items, length);
+    }
+
     uint32_t length(void)
     {
         return audio_info_.size / sizeof(T);
     }
 
+    uint32_t capacity(void)
+    {
+        return buffer_chain_.length();
+    }
+
+    uint32_t crc32(void)
+    {
+        return audio_info_.crc32;
+    }
+
+    Flash& flash(void)
+    {
+        return flash_;
+    }
+
     void Append(T item)
     {
         if (buffer_index_ < buffer_chain_.length())
@@ -128,6 +148,11 @@ public:
         }
     }
 
+    void Append(const float* items, uint32_t length)
+    {
+        buffer_index_ += buffer_chain_.Write(buffer_index_, items, length);
+    }
+
     void StopRecording(void)
     {
         uint32_t min_length =
@@ -138,45 +163,52 @@ public:
             // Trim the end of the recording to remove the sound of the
             // button being released.
             buffer_index_ -= min_length;
+            SetRecording(buffer_index_);
+        }
+    }
 
-            uint32_t address = audio_info_.address + audio_info_.size;
-            uint32_t size = buffer_index_ * sizeof(T);
+    // Makes the first `length` samples the recording, to be saved like a
+    // new one
+    void SetRecording(uint32_t length)
+    {
+        uint32_t address = audio_info_.address + audio_info_.size;
+        uint32_t size = std::min(length, buffer_chain_.length()) * sizeof(T);
 
-            uint32_t granularity = Flash::kEraseGranularity;
-            address += granularity - 1;
-            address -= (address % granularity);
+        uint32_t granularity = Flash::kEraseGranularity;
+        address += granularity - 1;
+        address -= (address % granularity);
 
-            if (address + size > Flash::kSize)
-            {
-                address = kAudioBufferAddress;
-            }
+        if (address + size > Flash::kSize)
+        {
+            address = kAudioBufferAddress;
+        }
 
-            crc_.Seed(0);
-            uint32_t total_size = size;
+        crc_.Seed(0);
+        uint32_t total_size = size;
 
-            for (auto link : buffer_chain_)
-            {
-                system::ReloadWatchdog();
-                uint32_t chunk_size = std::min(link.size(), total_size);
-                crc_.Process(link.buffer, chunk_size);
-                total_size -= chunk_size;
+        for (auto link : buffer_chain_)
+        {
+            system::ReloadWatchdog();
+            uint32_t chunk_size = std::min(link.size(), total_size);
+            crc_.Process(link.buffer, chunk_size);
+            total_size -= chunk_size;
 
-                if (total_size == 0)
-                {
-                    break;
-                }
+            if (total_size == 0)
+            {
+                break;
             }
+        }
 
-            audio_info_ =
-            {
-                .address = address,
-                .size    = size,
-                .crc32   = crc_.value(),
-            };
+        audio_info_ =
+        {
+            .address = address,
+            .size    = size,
+            .crc32   = crc_.value(),
+        };
 
-            dirty_ = true;
-        }
+        dirty_ = true;
     }
+
     T Read(size_t index)
     {
         return buffer_chain_[index];
@@ -9,6 +9,7 @@
 #include "drivers/profiling.h"
 
 #include "common/config.h"
+#include "common/events.h"
 
 namespace recorder
 {
@@ -97,14 +98,15 @@ uint32_t Serial::Write(const uint8_t* buffer, uint32_t length, bool blocking)
 {
     uint32_t i = 0;
 
-    while (i < length && (!tx_fifo_.full() || blocking))
+    // Blocking writes longer than the FIFO wait for the interrupt to drain
+    // it, so it is enabled after every push
+    do
     {
         ScopedProfilingPin<PROFILE_SERIAL_TX_FIFO_PUSH> profile;
-        while (!tx_fifo_.Push(buffer[i]));
-        i++;
+        i += tx_fifo_.PushSpan(buffer + i, length - i);
+        LL_USART_EnableIT_TXE(USART1);
     }
-
-    LL_USART_EnableIT_TXE(USART1);
+    while (blocking && i < length);
 
     return i;
 }
@@ -142,6 +144,7 @@ void Serial::InterruptService(void)
         }
 
         rx_fifo_.Push(byte);
+        events::Post(events::EVENT_SERIAL);
     }
 
     if (LL_USART_IsEnabledIT_TXE(USART1) && LL_USART_IsActiveFlag_TXE(USART1))
@@ -18,6 +18,13 @@ public:
     uint32_t Write(const uint8_t* buffer, uint32_t length,
         bool blocking = false);
     void FlushTx(bool discard = false);
+
+    // Bytes that can be written now without blocking
+    uint32_t TxSpace(void)
+    {
+        return kTxFifoSize - tx_fifo_.available();
+    }
+
     void FlushRx(void);
 
     template <size_t length>
@@ -27,7 +34,7 @@ public:
     }
 
 protected:
-    static constexpr uint32_t kRxFifoSize = 64;
+    static constexpr uint32_t kRxFifoSize = 1024;
     static constexpr uint32_t kTxFifoSize = 256;
 
     static inline Serial* instance_;
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <atomic>
 
 #include "drivers/gpio.h"
 #include "drivers/system.h"
+#include "drivers/cycle_counter.h"
 #include "common/config.h"
+#include "common/events.h"
 #include "common/io.h"
 #include "util/debouncer.h"
 
@@ -35,10 +38,16 @@ public:
 
 
         
-        db_[SWITCH_KEY_1].Init(kButtonDebounceDuration_ms);
-        db_[SWITCH_KEY_2].Init(kButtonDebounceDuration_ms);
-        db_[SWITCH_KEY_3].Init(kButtonDebounceDuration_ms);
-        db_[SWITCH_KEY_4].Init(kButtonDebounceDuration_ms);
+        // The keys play notes, so they take a press at once; the rest wait
+        // for it to settle
+        db_[SWITCH_KEY_1].Init(kButtonDebounceDuration_ms, false,
+            Debouncer<bool>::MODE_LEADING);
+        db_[SWITCH_KEY_2].Init(kButtonDebounceDuration_ms, false,
+            Debouncer<bool>::MODE_LEADING);
+        db_[SWITCH_KEY_3].Init(kButtonDebounceDuration_ms, false,
+            Debouncer<bool>::MODE_LEADING);
+        db_[SWITCH_KEY_4].Init(kButtonDebounceDuration_ms, false,
+            Debouncer<bool>::MODE_LEADING);
 
 
         db_[SWITCH_RECORD].Init(kButtonDebounceDuration_ms);
@@ -48,33 +57,82 @@ public:
         //db_[SWITCH_EFFECT].Init(kButtonDebounceDuration_ms);
         //db_[SWITCH_REVERSE].Init(kButtonDebounceDuration_ms);
         db_[NUM_SWITCHES + DETECT_LINE_IN].Init(kButtonDebounceDuration_ms);
+
+        scanned_ = ReadPins();
+        edge_time_.store(0, std::memory_order_relaxed);
     }
 
-    void Process(HumanInput& in)
+    // Tick interrupt: posts EVENT_SWITCH, notes the cycle count and returns
+    // true when any pin changed since the last scan
+    bool Scan(void)
     {
+        uint32_t pins = ReadPins();
+
+        if (pins == scanned_)
+        {
+            return false;
+        }
+
+        scanned_ = pins;
+        edge_time_.store(cycle_counter::Read(), std::memory_order_relaxed);
+        events::Post(events::EVENT_SWITCH);
+        return true;
+    }
+
+    // Main loop: debounces the pins, counting down lockouts on `tick`
+    void Process(HumanInput& in, bool tick)
+    {
+        uint32_t pins = ReadPins();
+
         for (uint32_t i = 0; i < NUM_SWITCHES; i++)
         {
-            if (kEnableReverse || i != SWITCH_REVERSE)
-            {
-                in.sw[i] = db_[i].Process(sw_[i].Read());
-            }
-            else
-            {
-                in.sw[i] = false;
-            }
+            in.sw[i] = db_[i].Process(pins >> i & 1, tick);
         }
 
         for (uint32_t i = 0; i < NUM_DETECTS; i++)
         {
             in.detect[i] = kEnableLineIn &&
-                db_[NUM_SWITCHES + i].Process(detect_[i].Read());
+                db_[NUM_SWITCHES + i].Process(pins >> (NUM_SWITCHES + i) & 1,
+                    tick);
         }
     }
 
+    // Cycle count of the last change seen by Scan()
+    uint32_t edge_time(void) const
+    {
+        return edge_time_.load(std::memory_order_relaxed);
+    }
+
 protected:
     GenericInputPin sw_[NUM_SWITCHES];
     GenericInputPin detect_[NUM_DETECTS];
     Debouncer<bool> db_[NUM_SWITCHES + NUM_DETECTS];
+    uint32_t scanned_;
+    std::atomic<uint32_t> edge_time_;
+
+    // Switches in the low bits, detects above them
+    uint32_t ReadPins(void)
+    {
+        uint32_t pins = 0;
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            if (kEnableReverse || i != SWITCH_REVERSE)
+            {
+                pins |= sw_[i].Read() << i;
+            }
+        }
+
+        for (uint32_t i = 0; i < NUM_DETECTS; i++)
+        {
+            if (kEnableLineIn)
+            {
+                pins |= detect_[i].Read() << (NUM_SWITCHES + i);
+            }
+        }
+
+        return pins;
+    }
 };
 
 }
@@ -16,6 +16,7 @@
 #include "drivers/serial.h"
 
 #include "common/config.h"
+#include "common/events.h"
 
 namespace recorder::system
 {
@@ -23,6 +24,8 @@ namespace recorder::system
 static Serial serial_;
 static std::atomic_uint32_t ticks_;
 static uint32_t wakeup_flags_;
+static void (*tick_callback_)(void);
+static std::atomic_bool poll_requested_;
 
 static void InitFPU(void)
 {
@@ -124,8 +127,30 @@ void TickHandler(void)
     ScopedProfilingPin<PROFILE_TICK> profile;
     LL_TIM_ClearFlag_UPDATE(TIM7);
     LL_TIM_IsActiveFlag_UPDATE(TIM7);
-    uint32_t ticks = ticks_.load(std::memory_order_relaxed);
-    ticks_.store(ticks + 1, std::memory_order_relaxed);
+    uint32_t ticks = ticks_.load(std::memory_order_relaxed) + 1;
+    ticks_.store(ticks, std::memory_order_relaxed);
+
+    if (tick_callback_)
+    {
+        tick_callback_();
+    }
+
+    uint32_t events = 0;
+
+    if (ticks % 10 == 0)
+    {
+        events |= events::EVENT_TICK;
+    }
+
+    if (poll_requested_.exchange(false, std::memory_order_relaxed))
+    {
+        events |= events::EVENT_POLL;
+    }
+
+    if (events)
+    {
+        events::Post(events);
+    }
 }
 
 extern "C"
@@ -209,6 +234,7 @@ void Init(void)
 
     // 100us tick period
     ticks_.store(0, std::memory_order_relaxed);
+    events::flags_.Init();
     InitTimer(kSystemClock / 10000);
 
     InitWatchdog(100);
@@ -263,6 +289,41 @@ void Delay_ms(uint32_t ms)
     }
 }
 
+uint32_t WaitForEvents(void)
+{
+    for (;;)
+    {
+        // Check and sleep with interrupts masked, so that an event posted in
+        // between still ends the sleep: WFI wakes on a pending interrupt
+        // either way, which then runs once they are unmasked
+        __disable_irq();
+        uint32_t events = events::flags_.Take();
+
+        if (events == 0)
+        {
+            ScopedProfilingPin<PROFILE_SLEEP> profile;
+            Sleep();
+        }
+
+        __enable_irq();
+
+        if (events)
+        {
+            return events;
+        }
+    }
+}
+
+void SetTickCallback(void (*callback)(void))
+{
+    tick_callback_ = callback;
+}
+
+void RequestPoll(void)
+{
+    poll_requested_.store(true, std::memory_order_relaxed);
+}
+
 uint32_t SerialBytesAvailable(void)
 {
     return serial_.BytesAvailable();
@@ -273,11 +334,22 @@ uint8_t SerialGetByteBlocking(void)
     return serial_.GetByteBlocking();
 }
 
+void SerialWrite(const void* data, uint32_t size)
+{
+    std::fflush(stdout);
+    serial_.Write(static_cast<const uint8_t*>(data), size, true);
+}
+
 void SerialFlushTx(bool discard)
 {
     serial_.FlushTx(discard);
 }
 
+uint32_t SerialTxSpace(void)
+{
+    return serial_.TxSpace();
+}
+
 void Standby(void)
 {
     ScopedProfilingPin<PROFILE_STANDBY> profile;
@@ -332,47 +404,6 @@ void Reset(void)
     NVIC_SystemReset();
 }
 
-extern "C"
-char* fgets(char* str, int count, std::FILE* stream)
-{
-    if (count < 2)
-    {
-        return nullptr;
-    }
-
-    int i;
-
-    for (i = 0; i < count - 1; i++)
-    {
-        char byte = std::getc(stream);
-        bool error = std::ferror(stream);
-        bool eof = std::feof(stream);
-        std::clearerr(stream);
-
-        if (error || (eof && i == 0))
-        {
-            return nullptr;
-        }
-        else if (eof)
-        {
-            str[i] = '\0';
-            return str;
-        }
-        else
-        {
-            str[i] = byte;
-
-            if (byte == '\n')
-            {
-                break;
-            }
-        }
-    }
-
-    str[i + 1] = '\0';
-    return str;
-}
-
 extern "C"
 int _read(int file, char* ptr, int len)
 {
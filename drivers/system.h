@@ -10,9 +10,22 @@ static constexpr uint32_t kSystemClock = 64000000;
 void Init(void);
 void Delay_ms(uint32_t ms);
 
+// Sleeps until an event (common/events.h) is posted, then takes and returns
+// all pending events. EVENT_TICK is posted every millisecond.
+uint32_t WaitForEvents(void);
+// Called from the 100 us tick interrupt, for inputs that have no interrupt
+// of their own
+void SetTickCallback(void (*callback)(void));
+// Posts EVENT_POLL on the next 100 us tick, for jobs waiting on hardware
+// that can't interrupt, such as the flash's write-in-progress bit
+void RequestPoll(void);
+
 uint32_t SerialBytesAvailable(void);
 uint8_t SerialGetByteBlocking(void);
+// Writes bytes as they are, unlike stdout, which expands '\n' to CR LF
+void SerialWrite(const void* data, uint32_t size);
 void SerialFlushTx(bool discard = false);
+uint32_t SerialTxSpace(void);
 
 void Standby(void);
 bool WakeupWasPlayButton(void);
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Records an input capture from the device, or dumps one as text.
+
+A capture holds every change to the pots, switches and detects along with
+the main-loop iteration and audio callback count it happened at (see
+common/capture.h). Replay it on the host with:
+
+    build/<variant>/artifact/vdevice -r <capture> [-o out.wav]
+
+For an exact replay, start capturing right after a reset (--reset) so the
+device and the virtual device begin from the same state.
+"""
+import argparse
+import sys
+import time
+import struct
+import interface
+import port
+
+MIN_PYTHON = (3, 6)
+if sys.version_info < (MIN_PYTHON):
+    sys.exit("Python %s.%s or later is required.\n" % MIN_PYTHON)
+
+MAGIC = b'RCAP'
+HEADER_SIZE = 8
+FLAG_SWITCHES = 1 << 0
+FLAG_POTS = 1 << 1
+
+def record(args):
+    serial_port = port.get_device(args.port)
+    if serial_port is None:
+        sys.exit('Serial port not found: ' + args.port)
+
+    with open(args.file, 'wb') as file:
+        def on_stream(data):
+            file.write(data)
+            on_stream.size += len(data)
+        on_stream.size = 0
+
+        dut = interface.Monitor(
+            baudrate=115200, timeout=0.05, port=serial_port,
+            plaintext_callback=lambda line: print(line),
+            stream_callback=on_stream)
+
+        if args.reset:
+            dut.reset()
+            time.sleep(0.5)
+        dut.capture(True)
+        print('Capturing to %s, press Ctrl-C to stop' % args.file)
+
+        start = time.time()
+        try:
+            while args.duration is None or time.time() - start < args.duration:
+                dut.poll()
+        except KeyboardInterrupt:
+            pass
+
+        dut.capture(False)
+        dut.poll()
+        print('Captured %u bytes in %.1f s' % (on_stream.size,
+                                              time.time() - start))
+
+def get_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+def dump(args):
+    with open(args.file, 'rb') as file:
+        data = file.read()
+
+    if data[:4] != MAGIC:
+        sys.exit('Not a capture: ' + args.file)
+    version, num_pots, num_switches, num_detects = struct.unpack_from(
+        'BBBB', data, 4)
+    print('version %u, %u pots, %u switches, %u detects' %
+          (version, num_pots, num_switches, num_detects))
+
+    pos = HEADER_SIZE
+    loop = callback = switches = detects = 0
+    pots = [0] * num_pots
+    try:
+        while pos < len(data):
+            flags = data[pos]
+            pos += 1
+            delta, pos = get_varint(data, pos)
+            loop += delta
+            delta, pos = get_varint(data, pos)
+            callback += delta
+            if flags & FLAG_SWITCHES:
+                switches, pos = get_varint(data, pos)
+                detects = data[pos]
+                pos += 1
+            if flags & FLAG_POTS:
+                mask = data[pos]
+                pos += 1
+                for i in range(num_pots):
+                    if mask & (1 << i):
+                        delta, pos = get_varint(data, pos)
+                        pots[i] += (delta >> 1) ^ -(delta & 1)
+            print('%8u %9u  sw %s  det %s  pots %s' % (
+                loop, callback,
+                format(switches, '0%ub' % num_switches)[::-1],
+                format(detects, '0%ub' % num_detects)[::-1],
+                ' '.join('%.3f' % (p / 0xFFFF) for p in pots)))
+    except IndexError:
+        print('(truncated)')
+
+parser = argparse.ArgumentParser(description=__doc__,
+    formatter_class=argparse.RawDescriptionHelpFormatter)
+subparsers = parser.add_subparsers(dest='command', required=True)
+
+record_parser = subparsers.add_parser('record', help='Record a capture')
+record_parser.add_argument('port', help='Serial port')
+record_parser.add_argument('file', help='Output capture file')
+record_parser.add_argument('--reset', action='store_true',
+    help='Reset the device before capturing')
+record_parser.add_argument('--duration', type=float,
+    help='Stop after this many seconds')
+record_parser.set_defaults(func=record)
+
+dump_parser = subparsers.add_parser('dump', help='Print a capture')
+dump_parser.add_argument('file', help='Capture file')
+dump_parser.set_defaults(func=dump)
+
+args = parser.parse_args()
+args.func(args)
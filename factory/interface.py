@@ -1,6 +1,7 @@
 import serial
 import struct
 import base64
+import binascii
 import os
 import oyaml as yaml
 import time
@@ -12,15 +13,85 @@ class ExhaustedRetriesError(InterfaceError): pass
 class InterfaceTimeoutError(InterfaceError): pass
 class AckTimeoutError(InterfaceTimeoutError): pass
 class DataTimeoutError(InterfaceTimeoutError): pass
+class TransferStatusError(InterfaceError): pass
+
+def cobs_encode(data):
+    """Consistent Overhead Byte Stuffing, without the delimiter."""
+    encoded = bytearray()
+    for block in data.split(b'\x00'):
+        while len(block) >= 254:
+            encoded += b'\xff' + block[:254]
+            block = block[254:]
+        encoded += bytes([len(block) + 1]) + block
+    return bytes(encoded)
+
+def cobs_decode(encoded):
+    data = bytearray()
+    position = 0
+    while position < len(encoded):
+        code = encoded[position]
+        block = encoded[position + 1:position + code]
+        if code == 0 or len(block) != code - 1 or 0 in block:
+            raise BadDataError(encoded)
+        data += block
+        position += code
+        if code != 0xFF and position < len(encoded):
+            data += b'\x00'
+    return bytes(data)
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as app/monitor/crc16.h."""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+def _crc32_table():
+    table = []
+    for i in range(256):
+        crc = i << 24
+        for bit in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7 if crc & 0x80000000
+                   else crc << 1) & 0xFFFFFFFF
+        table.append(crc)
+    return table
+
+CRC32_TABLE = _crc32_table()
+
+def crc32(data):
+    """CRC-32 as the STM32 CRC unit computes it in drivers/crc.h: MSB first,
+    fed little-endian 32-bit words, then any remaining bytes."""
+    crc = 0xFFFFFFFF
+    tail = len(data) % 4
+    words = len(data) - tail
+    for i in range(0, words, 4):
+        for byte in (data[i + 3], data[i + 2], data[i + 1], data[i]):
+            crc = ((crc << 8) & 0xFFFFFFFF) ^ CRC32_TABLE[(crc >> 24) ^ byte]
+    for byte in data[words:]:
+        crc = ((crc << 8) & 0xFFFFFFFF) ^ CRC32_TABLE[(crc >> 24) ^ byte]
+    return crc ^ 0xFFFFFFFF
 
 class Interface(serial.Serial):
-    def __init__(self, tries=3, plaintext_callback=None, **kwds):
+    STREAM_HEADER = None
+    LOG_HEADER = None
+    TAP_HEADER = None
+
+    # Binary frames are COBS-encoded between zero bytes, and hold a header
+    # byte, the payload and a CRC-16. Lines and frames are told apart by a
+    # zero at the start of a line.
+    def __init__(self, tries=3, plaintext_callback=None, stream_callback=None,
+                 log_callback=None, tap_callback=None, **kwds):
         self._tries = tries
         self._plaintext_callback = plaintext_callback
+        self._stream_callback = stream_callback
+        self._log_callback = log_callback
+        self._tap_callback = tap_callback
+        self._line = b''
+        self._frame = None
+        self._framed = False
+        self._binary = False
         super().__init__(**kwds)
 
     def reset_interface(self):
-        self.write(self.RESET_SEQUENCE)
+        self.write(self.BINARY_RESET_SEQUENCE if self._binary
+                   else self.RESET_SEQUENCE)
         try:
             self._get_ack()
         except InterfaceError:
@@ -39,16 +110,56 @@ class Interface(serial.Serial):
         else:
             raise BadAckError()
 
-    def _get_message(self):
+    def _read_line_or_frame(self):
+        # Keep partial lines and frames across timeouts so poll() can't split
+        # one in two.
+        while True:
+            byte = self.read(1)[0]
+            if self._frame is not None:
+                if byte != 0:
+                    self._frame.append(byte)
+                elif self._frame:
+                    frame = cobs_decode(bytes(self._frame))
+                    self._frame = None
+                    self._framed = True
+                    if (len(frame) < 3 or crc16(frame[:-2]) !=
+                            struct.unpack('<H', frame[-2:])[0]):
+                        raise BadDataError(frame)
+                    return frame[:-2]
+            elif byte == 0 and not self._line:
+                self._frame = bytearray()
+            else:
+                self._line += bytes([byte])
+                if byte == ord('\n'):
+                    line = self._line.rstrip()
+                    self._line = b''
+                    self._framed = False
+                    return line
+
+    def _get_message(self, deadline=None):
         try:
             while True:
-                line = b''
-                while not line.endswith(b'\n'):
-                    line += bytes([self.read(1)[0]])
-                line = line.rstrip()
+                if deadline is not None and time.time() >= deadline:
+                    raise DataTimeoutError()
+                line = self._read_line_or_frame()
                 if line.startswith(self.HEADER):
                     break
-                if self._plaintext_callback is not None:
+                if (self.STREAM_HEADER is not None and
+                        line.startswith(self.STREAM_HEADER)):
+                    data = self._decode_packet(line[1:])
+                    if self._stream_callback is not None:
+                        self._stream_callback(data)
+                elif (self.LOG_HEADER is not None and
+                        line.startswith(self.LOG_HEADER)):
+                    data = self._decode_packet(line[1:])
+                    if self._log_callback is not None:
+                        self._log_callback(data)
+                elif (self.TAP_HEADER is not None and
+                        line.startswith(self.TAP_HEADER)):
+                    data = self._decode_packet(line[1:])
+                    if self._tap_callback is not None:
+                        self._tap_callback(data)
+                elif self._plaintext_callback is not None:
                     self._plaintext_callback(line.decode('ascii'))
             return line[1:]
         except IndexError:
@@ -56,8 +167,30 @@ class Interface(serial.Serial):
         except UnicodeDecodeError:
             raise BadDataError(line)
 
-    def _get_packet(self):
-        message = self._get_message()
+    def poll(self, duration=None):
+        """Handles text and stream lines until the port goes quiet, or for
+        at most `duration` seconds, for streams that never let it."""
+        deadline = None if duration is None else time.time() + duration
+        try:
+            while True:
+                self._get_message(deadline)
+        except DataTimeoutError:
+            pass
+
+    def _get_packet(self, timeout=0):
+        """Waits up to `timeout` seconds longer than the port's timeout for
+        a reply, for commands that take a while."""
+        deadline = time.time() + timeout
+        while True:
+            try:
+                return self._decode_packet(self._get_message())
+            except DataTimeoutError:
+                if time.time() >= deadline:
+                    raise
+
+    def _decode_packet(self, message):
+        if self._framed:
+            return message
         try:
             assert len(message) > 0, message
             message = base64.a85decode(message)
@@ -83,9 +216,14 @@ class Interface(serial.Serial):
         raise ExhaustedRetriesError()
 
     def _send_packet(self, data):
-        data = struct.pack('BB', len(data), sum(data) & 0xFF) + data
-        data = base64.a85encode(data, pad=False)
-        data = b'\xff' + data + b'\n'
+        if self._binary:
+            data = self.HEADER + data
+            data += struct.pack('<H', crc16(data))
+            data = b'\x00' + cobs_encode(data) + b'\x00'
+        else:
+            data = struct.pack('BB', len(data), sum(data) & 0xFF) + data
+            data = base64.a85encode(data, pad=False)
+            data = self.HEADER + data + b'\n'
         return self._send_raw(data)
 
 class PacketStructure(dict):
@@ -93,8 +231,16 @@ class PacketStructure(dict):
         super().__init__(*args, **kwds)
         self._format = '<'
         self._bitfields = dict()
+        self._arrays = dict()
+        self._fields = tuple(self.keys())
         for (field, fmt) in self.items():
-            if isinstance(fmt, dict):
+            if isinstance(fmt, list):
+                # A [length, format] pair specifies an array.
+                (length, fmt) = fmt
+                assert fmt in 'bB?hHiIlLqQefd', fmt
+                self._format += '%u%s' % (length, fmt)
+                self._arrays[field] = length
+            elif isinstance(fmt, dict):
                 # A subobject specifies packed booleans, but the packed
                 # format may vary.
                 assert field not in self._bitfields, field
@@ -113,16 +259,26 @@ class PacketStructure(dict):
         except struct.error:
             raise BadDataError()
         else:
-            self.update(zip(self.keys(), values))
+            values = iter(values)
+            for field in self._fields:
+                if field in self._arrays:
+                    self[field] = [next(values)
+                                   for i in range(self._arrays[field])]
+                else:
+                    self[field] = next(values)
             for (name, keys) in self._bitfields.items():
                 values = ((self[name] & (1 << bit)) != 0 for bit in range(len(keys)))
                 self.update(zip(keys, values))
 
 class Monitor(Interface):
     HEADER = b'\xff'
+    STREAM_HEADER = b'\xfe'
+    LOG_HEADER = b'\xfd'
+    TAP_HEADER = b'\xfc'
     ACK = b'ack'
     NAK = b'nak'
     RESET_SEQUENCE = b'\n'
+    BINARY_RESET_SEQUENCE = b'\x00'
 
     COMMAND_PING = b'p'
     COMMAND_RESET = b'r'
@@ -130,16 +286,42 @@ class Monitor(Interface):
     COMMAND_STANDBY = b's'
     COMMAND_ERASE = b'e'
     COMMAND_WATCHDOG = b'w'
+    COMMAND_CAPTURE = b'c'
+    COMMAND_PROFILE = b'f'
+    COMMAND_RESET_LOAD = b'l'
+    COMMAND_BINARY = b'b'
+    COMMAND_TRANSFER_INFO = b'i'
+    COMMAND_DOWNLOAD = b'd'
+    COMMAND_UPLOAD = b'u'
+    COMMAND_UPLOAD_END = b'n'
+    COMMAND_TAP = b't'
 
-    def __init__(self, *args, **kwds):
+    REGION_SAMPLES = 0
+    REGION_FLASH = 1
+    TAP_POINTS = ('off', 'output', 'mic', 'line-in', 'synth-voices',
+                  'synth-compressor', 'delay')
+    CODEC_RAW = 0
+    CODEC_ADPCM = 1
+    TRANSFER_STATUS = ('ok', 'busy', 'bad request', 'bad CRC', 'flash error')
+    # Flash uploads erase and program before replying
+    UPLOAD_TIMEOUT = 2
+
+    def __init__(self, *args, binary=False, **kwds):
         super().__init__(*args, **kwds)
         self._load_structures()
+        if binary:
+            self.set_binary(True)
 
     def _load_structures(self):
         dirname = os.path.dirname(os.path.realpath(__file__))
         with open(os.path.join(dirname, 'packet.yaml')) as file:
             structure = yaml.load(file, Loader=yaml.FullLoader)
             self._device_state = PacketStructure(structure['device_state'])
+            self._profile_report = PacketStructure(structure['profile_report'])
+            self._transfer_info = PacketStructure(structure['transfer_info'])
+            self._transfer_chunk = PacketStructure(
+                structure['transfer_chunk'])
+            self._tap_chunk = PacketStructure(structure['tap_chunk'])
 
     def _send_command(self, data):
         self._send_packet(data)
@@ -155,6 +337,28 @@ class Monitor(Interface):
 
     def reset(self):
         self._send_command(self.COMMAND_RESET)
+        self._binary = False
+
+    def set_binary(self, enable=True):
+        """Switches both ends to binary frames, which carry larger payloads
+        faster. The device acknowledges in the framing it was using."""
+        try:
+            self._send_command(self.COMMAND_BINARY + bytes([enable]))
+        except ExhaustedRetriesError:
+            # An earlier session may have left the device in the other
+            # framing
+            self._binary = not self._binary
+            self._send_command(self.COMMAND_BINARY + bytes([enable]))
+        self._binary = enable
+
+    def close(self):
+        # Leave the device talking in lines, for tools that only know those
+        if self._binary and self.is_open:
+            try:
+                self.set_binary(False)
+            except InterfaceError:
+                pass
+        super().close()
 
     def standby(self):
         self._send_command(self.COMMAND_STANDBY)
@@ -164,3 +368,62 @@ class Monitor(Interface):
 
     def watchdog(self):
         self._send_command(self.COMMAND_WATCHDOG)
+
+    def reset_load(self):
+        self._send_command(self.COMMAND_RESET_LOAD)
+
+    def capture(self, enable=True):
+        self._send_command(self.COMMAND_CAPTURE + bytes([enable]))
+
+    def profile(self, index, reset=False):
+        self._send_command(self.COMMAND_PROFILE + bytes([index, reset]))
+        data = self._get_packet()
+        self._profile_report.parse(data)
+        return dict(self._profile_report)
+
+    def tap(self, point, decimation=1, codec=CODEC_ADPCM):
+        """Streams a tap point's signal to the tap callback; point 0 stops
+        it."""
+        self._send_command(self.COMMAND_TAP +
+            bytes([point, decimation, codec]))
+
+    def parse_tap(self, data):
+        """Returns a tap packet's header and data."""
+        self._tap_chunk.parse(data)
+        return (dict(self._tap_chunk),
+                data[struct.calcsize(self._tap_chunk._format):])
+
+    def _get_transfer_reply(self, structure, timeout=0):
+        data = self._get_packet(timeout)
+        structure.parse(data)
+        status = structure['status']
+        if status != 0:
+            raise TransferStatusError(self.TRANSFER_STATUS[status]
+                if status < len(self.TRANSFER_STATUS) else status)
+        return (dict(structure), data[struct.calcsize(structure._format):])
+
+    def transfer_info(self):
+        self._send_command(self.COMMAND_TRANSFER_INFO)
+        return self._get_transfer_reply(self._transfer_info)[0]
+
+    def download(self, region, codec, offset, length):
+        """Returns a chunk's header and data, checking its CRC-32. The
+        device may return less than asked for."""
+        self._send_command(self.COMMAND_DOWNLOAD +
+            struct.pack('<BBIH', region, codec, offset, length))
+        (chunk, data) = self._get_transfer_reply(self._transfer_chunk)
+        if crc32(data) != chunk['crc32']:
+            raise BadDataError(chunk)
+        return (chunk, data)
+
+    def upload(self, region, codec, offset, length, data):
+        self._send_command(self.COMMAND_UPLOAD +
+            struct.pack('<BBIHI', region, codec, offset, length,
+                        crc32(data)) + data)
+        return self._get_transfer_reply(self._transfer_chunk,
+            self.UPLOAD_TIMEOUT)[0]
+
+    def upload_end(self, length):
+        """Makes the first `length` uploaded samples the recording."""
+        self._send_command(self.COMMAND_UPLOAD_END + struct.pack('<I', length))
+        self._get_transfer_reply(self._transfer_chunk)
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Decodes the firmware's binary LOG() records (see common/log.h).
+
+The device sends only format string IDs and raw arguments; the strings are
+read back from the firmware's ELF file, which must be the exact image the
+device runs. Run on its own, prints the device's text output and decoded log
+until interrupted.
+"""
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+from elftools.elf.constants import SH_FLAGS
+
+MIN_PYTHON = (3, 6)
+if sys.version_info < (MIN_PYTHON):
+    sys.exit("Python %s.%s or later is required.\n" % MIN_PYTHON)
+
+ANCHOR = 'recorder_log_anchor'
+STRINGS_SECTION = 'log_strings'
+
+CONVERSION = re.compile(
+    r'%([-+ #0]*(?:\*|\d+)?(?:\.(?:\*|\d+))?)(?:hh|h|ll|l|j|z|t|L)?'
+    r'([diouxXcsfFeEgGp%])')
+
+class LogDecoder:
+    def __init__(self, elf_path):
+        with open(elf_path, 'rb') as file:
+            elf = ELFFile(file)
+            symtab = elf.get_section_by_name('.symtab')
+            if symtab is None:
+                raise ValueError(elf_path + ' has no symbol table')
+            anchor = symtab.get_symbol_by_name(ANCHOR)
+            if not anchor:
+                raise ValueError(elf_path + ' was built without LOG()')
+            self._anchor = anchor[0]['st_value']
+            self._strings = []
+            self._memory = []
+            for section in elf.iter_sections():
+                name = section.name
+                region = (section['sh_addr'], section.data())
+                if (name == STRINGS_SECTION or
+                        name.startswith(STRINGS_SECTION + '.')):
+                    self._strings.append(region)
+                elif (section['sh_flags'] & SH_FLAGS.SHF_ALLOC and
+                        section['sh_type'] == 'SHT_PROGBITS'):
+                    self._memory.append(region)
+
+    def _read_string(self, regions, offset):
+        address = self._anchor + offset
+        for (start, data) in regions:
+            if start <= address < start + len(data):
+                end = data.find(b'\0', address - start)
+                if end < 0:
+                    end = len(data)
+                return data[address - start:end].decode('utf-8', 'replace')
+        return None
+
+    def _format(self, fmt, args):
+        args = iter(args)
+        def convert(match):
+            (flags, conversion) = match.groups()
+            if conversion == '%':
+                return '%'
+            try:
+                word = next(args)
+            except StopIteration:
+                return match.group(0)
+            if conversion in 'di':
+                value = struct.unpack('<i', struct.pack('<I', word))[0]
+            elif conversion in 'fFeEgG':
+                value = struct.unpack('<f', struct.pack('<I', word))[0]
+            elif conversion == 's':
+                offset = struct.unpack('<i', struct.pack('<I', word))[0]
+                value = self._read_string(self._memory, offset)
+                if value is None:
+                    value = '<string %+d?>' % offset
+            elif conversion == 'p':
+                (flags, conversion, value) = ('#', 'x', word)
+            else:
+                value = word
+            return ('%' + flags + conversion) % value
+        return CONVERSION.sub(convert, fmt)
+
+    def decode(self, data):
+        """Returns the text of the records in one log packet."""
+        lines = []
+        (dropped,) = struct.unpack_from('<H', data)
+        if dropped:
+            lines.append('(%u log records dropped)' % dropped)
+        position = 2
+        while position + 5 <= len(data):
+            (offset, num_args) = struct.unpack_from('<iB', data, position)
+            position += 5
+            args = struct.unpack_from('<%uI' % num_args, data, position)
+            position += 4 * num_args
+            fmt = self._read_string(self._strings, offset)
+            if fmt is None:
+                lines.append('<unknown log record %+d %s>' % (offset,
+                    ' '.join('0x%08X' % arg for arg in args)))
+            else:
+                lines.append(self._format(fmt, args).rstrip('\n'))
+        return lines
+
+def main():
+    import interface
+    import port
+
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='Firmware ELF file')
+    parser.add_argument('port', help='Serial port')
+    args = parser.parse_args()
+
+    decoder = LogDecoder(args.elf)
+    serial_port = port.get_device(args.port)
+    if serial_port is None:
+        sys.exit('Serial port not found: ' + args.port)
+
+    def on_log(data):
+        for line in decoder.decode(data):
+            print(line)
+
+    dut = interface.Monitor(baudrate=115200, timeout=0.1, port=serial_port,
+        plaintext_callback=print, log_callback=on_log)
+    try:
+        while True:
+            dut.poll()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dut.close()
+
+if __name__ == '__main__':
+    main()
@@ -15,8 +15,21 @@ if sys.version_info < (MIN_PYTHON):
 
 parser = argparse.ArgumentParser()
 parser.add_argument('port', help='Serial port')
+parser.add_argument('--elf', help='Firmware ELF file, to decode its log')
+parser.add_argument('--binary', action='store_true',
+                    help='Talk to the device in binary frames')
 args = parser.parse_args()
 
+if args.elf:
+    import log_decoder
+    decoder = log_decoder.LogDecoder(args.elf)
+    def on_log(data):
+        for line in decoder.decode(data):
+            line_history.insert(0, line)
+else:
+    def on_log(data):
+        line_history.insert(0, '<log packet: decode with --elf>')
+
 serial_port = port.get_device(args.port)
 
 if serial_port == None:
@@ -27,7 +40,8 @@ print('Using serial port:', serial_port)
 
 dut = interface.Monitor(
     baudrate=115200, timeout=0.05, port=serial_port,
-    plaintext_callback=lambda x: line_history.insert(0, x))
+    plaintext_callback=lambda x: line_history.insert(0, x),
+    log_callback=on_log, binary=args.binary)
 
 commands = {
     'q': ('Quit', None),
@@ -35,6 +49,7 @@ commands = {
     's': ('Standby', lambda: dut.standby()),
     'e': ('Erase', lambda: dut.erase()),
     'w': ('Watchdog', lambda: dut.watchdog()),
+    'l': ('Reset load and latency', lambda: dut.reset_load()),
     'c': ('Clear log', lambda: line_history.clear()),
 }
 
@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import os
 import sys
 import serial
 
@@ -34,5 +35,9 @@ def get_device(port):
 
     if serial_port in [p.device for p in ports]:
         return serial_port
+    elif os.path.exists(port) and not os.path.isdir(port):
+        # A device that isn't enumerated, such as the pseudo-terminal of
+        # the host virtual device.
+        return port
     else:
         return None
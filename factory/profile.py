@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Prints the device's software profiler statistics.
+
+Build the firmware with ENABLE_PROFILER defined (for example in
+common/config.inc.h) in a debug build; every profiling pin scope is then timed
+with the cycle counter. Shows each profile that ran with its count and
+min/mean/max time, and optionally its log2 histogram.
+"""
+import argparse
+import os
+import re
+import sys
+import interface
+import port
+
+MIN_PYTHON = (3, 6)
+if sys.version_info < (MIN_PYTHON):
+    sys.exit("Python %s.%s or later is required.\n" % MIN_PYTHON)
+
+def profile_names():
+    dirname = os.path.dirname(os.path.realpath(__file__))
+    path = os.path.join(dirname, '..', 'drivers', 'profiling.h')
+    try:
+        with open(path) as file:
+            source = file.read()
+    except OSError:
+        return []
+    body = re.search(r'enum Profile\s*{([^}]*)}', source).group(1)
+    return re.findall(r'^\s*(\w+)\s*,?\s*$', body, re.MULTILINE)
+
+def format_time(cycles, frequency):
+    us = cycles * 1e6 / frequency
+    return '%10.2f' % us
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', help='Serial port')
+    parser.add_argument('--reset', action='store_true',
+        help='Clear the statistics after reading them')
+    parser.add_argument('--histogram', action='store_true',
+        help='Show each profile\'s histogram')
+    args = parser.parse_args()
+
+    serial_port = port.get_device(args.port)
+    if serial_port is None:
+        sys.exit('Serial port not found: ' + args.port)
+
+    dut = interface.Monitor(baudrate=115200, timeout=0.5, port=serial_port)
+    names = profile_names()
+
+    reports = []
+    index = 0
+    while True:
+        report = dut.profile(index)
+        if index >= report['num_profiles']:
+            break
+        reports.append(report)
+        index += 1
+
+    if args.reset:
+        dut.profile(index, reset=True)
+
+    if not reports or not reports[0]['enabled']:
+        sys.exit('The firmware was built without ENABLE_PROFILER')
+
+    frequency = reports[0]['frequency']
+    print('%-28s %10s %10s %10s %10s  (us)' %
+          ('profile', 'count', 'min', 'mean', 'max'))
+    for report in reports:
+        if report['count'] == 0:
+            continue
+        i = report['profile']
+        name = names[i] if i < len(names) else str(i)
+        print('%-28s %10u %s %s %s' % (
+            name, report['count'],
+            format_time(report['min'], frequency),
+            format_time(report['total'] / report['count'], frequency),
+            format_time(report['max'], frequency)))
+        if args.histogram:
+            histogram = report['histogram']
+            used = [b for b in range(len(histogram)) if histogram[b]]
+            for b in range(used[0], used[-1] + 1):
+                print('    >= %9.2f us %10u' % (
+                    (1 << b) * 1e6 / frequency, histogram[b]))
+
+main()
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Streams a signal from inside the device to a WAV file as it plays.
+
+The device taps one point of its audio path (see common/tap.h), averages it
+down to a lower sample rate and sends it over the monitor link, by default
+as IMA ADPCM. Without --rate, the highest rate the link can carry is chosen.
+The WAV file is valid while it's being written, so it can be opened before
+the tap is stopped with Ctrl-C.
+
+When the link falls behind, the device drops samples rather than hold up the
+audio; the gaps are filled with silence so the file keeps time.
+"""
+import argparse
+import atexit
+import struct
+import sys
+import time
+import wave
+import interface
+import port
+from transfer import Adpcm
+
+MIN_PYTHON = (3, 6)
+if sys.version_info < (MIN_PYTHON):
+    sys.exit("Python %s.%s or later is required.\n" % MIN_PYTHON)
+
+SAMPLE_RATE = 16000
+DECIMATIONS = (1, 2, 4, 8, 16)
+BAUD_RATE = 115200
+# Leave room for replies and logs
+LINK_SHARE = 0.75
+# Matches Monitor::kTapChunkSize and the TapChunk header
+CHUNK_DATA = 128
+CHUNK_HEADER = 15
+POLL_DURATION = 0.1
+
+def link_rate(decimation, codec, binary):
+    """Estimates the bytes per second a tap sends."""
+    samples = CHUNK_DATA * 2 if codec == interface.Monitor.CODEC_ADPCM \
+        else CHUNK_DATA // 2
+    payload = CHUNK_HEADER + CHUNK_DATA
+    if binary:
+        # Channel, CRC, COBS overhead and delimiters
+        size = payload + 3 + payload // 254 + 3
+    else:
+        # Size and checksum, ASCII85, header and newline
+        size = (payload + 2 + 3) // 4 * 5 + 2
+    return SAMPLE_RATE / decimation / samples * size
+
+def choose_decimation(codec, binary):
+    budget = BAUD_RATE / 10 * LINK_SHARE
+    for decimation in DECIMATIONS:
+        if link_rate(decimation, codec, binary) <= budget:
+            return decimation
+    return DECIMATIONS[-1]
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', help='Serial port')
+    parser.add_argument('file', help='WAV file to write')
+    parser.add_argument('--point', default='output',
+        choices=interface.Monitor.TAP_POINTS[1:],
+        help='Signal to tap (default: output)')
+    parser.add_argument('--rate', type=int,
+        choices=[SAMPLE_RATE // d for d in DECIMATIONS],
+        help='Sample rate (default: the highest the link can carry)')
+    parser.add_argument('--raw', action='store_true',
+        help='Send 16-bit samples rather than ADPCM')
+    parser.add_argument('--text', action='store_true',
+        help='Use text lines instead of binary frames')
+    parser.add_argument('--duration', type=float,
+        help='Stop after this many seconds')
+    args = parser.parse_args()
+
+    codec = (interface.Monitor.CODEC_RAW if args.raw
+             else interface.Monitor.CODEC_ADPCM)
+    binary = not args.text
+    if args.rate is None:
+        decimation = choose_decimation(codec, binary)
+    else:
+        decimation = SAMPLE_RATE // args.rate
+        if link_rate(decimation, codec, binary) > BAUD_RATE / 10:
+            print('Warning: the link can\'t keep up with %u Hz, expect gaps' %
+                  args.rate, file=sys.stderr)
+
+    serial_port = port.get_device(args.port)
+    if serial_port is None:
+        sys.exit('Serial port not found: ' + args.port)
+
+    file = wave.open(args.file, 'wb')
+    file.setnchannels(1)
+    file.setsampwidth(2)
+    file.setframerate(SAMPLE_RATE // decimation)
+
+    stats = {'position': None, 'written': 0, 'dropped': 0, 'lost': 0}
+
+    def on_tap(data):
+        (chunk, data) = dut.parse_tap(data)
+        length = chunk['length']
+        if chunk['codec'] == dut.CODEC_ADPCM:
+            state = Adpcm(chunk['predictor'], chunk['index'])
+            samples = [state.decode(data[i // 2] >> (i % 2 * 4) & 0xF)
+                       for i in range(length)]
+        else:
+            samples = struct.unpack_from('<%uh' % length, data)
+
+        # Samples dropped on the device, or packets lost on the link
+        position = chunk['position']
+        if stats['position'] is None:
+            stats['position'] = position
+        gap = position - stats['position']
+        stats['dropped'] += chunk['dropped']
+        if gap < 0:
+            print('Stream restarted', file=sys.stderr)
+        elif gap > 0:
+            stats['lost'] += max(gap - chunk['dropped'], 0)
+            file.writeframes(bytes(2 * gap))
+        stats['position'] = position + length
+
+        file.writeframes(struct.pack('<%uh' % length, *samples))
+        stats['written'] += max(gap, 0) + length
+
+    dut = interface.Monitor(baudrate=BAUD_RATE, timeout=0.05,
+        port=serial_port, binary=binary, tap_callback=on_tap)
+    atexit.register(dut.close)
+
+    point = interface.Monitor.TAP_POINTS.index(args.point)
+    dut.tap(point, decimation, codec)
+    print('Tapping %s at %u Hz to %s, press Ctrl-C to stop' %
+          (args.point, SAMPLE_RATE // decimation, args.file))
+
+    start = time.time()
+    try:
+        while args.duration is None or time.time() - start < args.duration:
+            dut.poll(POLL_DURATION)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dut.tap(0)
+        dut.poll()
+        file.close()
+
+    print('Wrote %.1f s; %u samples dropped by the device, %u lost on the '
+          'link' % (stats['written'] * decimation / SAMPLE_RATE,
+                    stats['dropped'], stats['lost']))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+"""Downloads and uploads recordings and flash contents over the monitor link.
+
+Recordings are read from and written to the device's sample memory as 16-bit
+mono WAV files at the device's sample rate. With --adpcm the samples travel as
+IMA ADPCM, four times smaller than as stored. An uploaded recording replaces
+the current one as if it had just been recorded.
+
+Transfers go a chunk at a time, each checked with a CRC-32, and retry failed
+chunks. An interrupted download resumes from <file>.part when run again, as
+long as the recording hasn't changed; an interrupted upload resumes with
+--resume.
+"""
+import argparse
+import atexit
+import os
+import struct
+import sys
+import time
+import wave
+import interface
+import port
+
+MIN_PYTHON = (3, 6)
+if sys.version_info < (MIN_PYTHON):
+    sys.exit("Python %s.%s or later is required.\n" % MIN_PYTHON)
+
+PART_MAGIC = b'RPRT'
+PART_HEADER = '<4sII'
+TRIES = 5
+RETRY_DELAY = 0.1
+
+STEP_TABLE = (
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+    963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+    3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+    24623, 27086, 29794, 32767)
+INDEX_TABLE = (-1, -1, -1, -1, 2, 4, 6, 8)
+
+class Adpcm:
+    """IMA ADPCM, as util/adpcm.h."""
+    def __init__(self, predictor=0, index=0):
+        self.predictor = predictor
+        self.index = min(index, len(STEP_TABLE) - 1)
+
+    def _update(self, code):
+        step = STEP_TABLE[self.index]
+        delta = step >> 3
+        if code & 4:
+            delta += step
+        if code & 2:
+            delta += step >> 1
+        if code & 1:
+            delta += step >> 2
+        predictor = self.predictor + (-delta if code & 8 else delta)
+        self.predictor = max(-32768, min(32767, predictor))
+        self.index = max(0, min(len(STEP_TABLE) - 1,
+                                self.index + INDEX_TABLE[code & 7]))
+        return self.predictor
+
+    def encode(self, sample):
+        step = STEP_TABLE[self.index]
+        difference = sample - self.predictor
+        code = 0
+        if difference < 0:
+            code = 8
+            difference = -difference
+        for bit in (4, 2, 1):
+            if difference >= step:
+                code |= bit
+                difference -= step
+            step >>= 1
+        self._update(code)
+        return code
+
+    def decode(self, code):
+        return self._update(code)
+
+def step_index(difference):
+    """As adpcm::StepIndex()."""
+    index = 0
+    while index < len(STEP_TABLE) - 1 and STEP_TABLE[index] < abs(difference):
+        index += 1
+    return index
+
+def adpcm_encode(state, samples):
+    header = struct.pack('<hBx', state.predictor, state.index)
+    codes = bytearray((len(samples) + 1) // 2)
+    for (i, sample) in enumerate(samples):
+        codes[i // 2] |= state.encode(sample) << ((i % 2) * 4)
+    return header + bytes(codes)
+
+def adpcm_decode(data, length):
+    (predictor, index) = struct.unpack_from('<hB', data)
+    state = Adpcm(predictor, index)
+    return [state.decode(data[4 + i // 2] >> ((i % 2) * 4) & 0xF)
+            for i in range(length)]
+
+def fp16_to_int16(data):
+    values = struct.unpack('<%ue' % (len(data) // 2), data)
+    return [int(round(max(-1, min(1, value)) * 32767)) for value in values]
+
+def int16_to_fp16(samples):
+    return struct.pack('<%ue' % len(samples),
+                       *(sample / 32767 for sample in samples))
+
+def retry(function, *args):
+    for attempt in range(TRIES):
+        try:
+            return function(*args)
+        except interface.InterfaceError as error:
+            if attempt == TRIES - 1:
+                raise
+            print('Retrying: %r' % error, file=sys.stderr)
+            time.sleep(RETRY_DELAY)
+
+def progress(done, total, start):
+    rate = done / max(time.time() - start, 1e-3)
+    print('\r%u/%u (%.0f/s)' % (done, total, rate), end='', flush=True)
+
+def connect(args):
+    serial_port = port.get_device(args.port)
+    if serial_port is None:
+        sys.exit('Serial port not found: ' + args.port)
+    dut = interface.Monitor(baudrate=115200, timeout=0.1, port=serial_port,
+                            binary=not args.text)
+    # Closing returns the device to text lines
+    atexit.register(dut.close)
+    return dut
+
+def info(args):
+    dut = connect(args)
+    for (key, value) in retry(dut.transfer_info).items():
+        if key not in ('type', 'status'):
+            print('%-16s %u' % (key, value))
+
+def download(args):
+    dut = connect(args)
+    state = retry(dut.transfer_info)
+    length = state['sample_length']
+    codec = dut.CODEC_ADPCM if args.adpcm else dut.CODEC_RAW
+    part_path = args.file + '.part'
+    header = struct.pack(PART_HEADER, PART_MAGIC, state['sample_crc32'],
+                         length)
+
+    # Resume only a download of the same recording
+    offset = 0
+    try:
+        with open(part_path, 'rb') as part:
+            if part.read(len(header)) == header:
+                offset = len(part.read()) // 2
+    except OSError:
+        pass
+    if offset:
+        print('Resuming at sample %u' % offset)
+    else:
+        with open(part_path, 'wb') as part:
+            part.write(header)
+
+    start = time.time()
+    with open(part_path, 'r+b') as part:
+        part.seek(len(header) + offset * 2)
+        while offset < length:
+            (chunk, data) = retry(dut.download, dut.REGION_SAMPLES, codec,
+                                  offset, min(length - offset, 0xFFFF))
+            if chunk['length'] == 0:
+                sys.exit('\nDevice returned no samples at %u' % offset)
+            if codec == dut.CODEC_ADPCM:
+                samples = adpcm_decode(data, chunk['length'])
+            else:
+                samples = fp16_to_int16(data)
+            part.write(struct.pack('<%uh' % len(samples), *samples))
+            offset += chunk['length']
+            progress(offset, length, start)
+    print()
+
+    with open(part_path, 'rb') as part:
+        part.seek(len(header))
+        frames = part.read()
+    with wave.open(args.file, 'wb') as file:
+        file.setnchannels(1)
+        file.setsampwidth(2)
+        file.setframerate(state['sample_rate'])
+        file.writeframes(frames)
+    os.remove(part_path)
+    print('Wrote %u samples to %s' % (length, args.file))
+
+def upload(args):
+    with wave.open(args.file, 'rb') as file:
+        if file.getnchannels() != 1 or file.getsampwidth() != 2:
+            sys.exit('Need a mono 16-bit WAV file')
+        rate = file.getframerate()
+        frames = file.readframes(file.getnframes())
+    samples = struct.unpack('<%uh' % (len(frames) // 2), frames)
+
+    dut = connect(args)
+    state = retry(dut.transfer_info)
+    if rate != state['sample_rate']:
+        sys.exit('Sample rate is %u Hz, the device needs %u Hz' %
+                 (rate, state['sample_rate']))
+    length = len(samples)
+    if length > state['sample_capacity']:
+        print('Truncating to %u samples' % state['sample_capacity'])
+        length = state['sample_capacity']
+
+    offset = state['upload_length'] if args.resume else 0
+    if offset:
+        print('Resuming at sample %u' % offset)
+    max_data = state['max_data']
+    if args.adpcm:
+        codec = dut.CODEC_ADPCM
+        chunk_length = (max_data - 4) * 2
+        first = samples[offset] if offset < length else 0
+        second = samples[offset + 1] if offset + 1 < length else first
+        encoder = Adpcm(first, step_index(second - first))
+    else:
+        codec = dut.CODEC_RAW
+        chunk_length = max_data // 2
+
+    start = time.time()
+    while offset < length:
+        chunk = samples[offset:min(length, offset + chunk_length)]
+        if args.adpcm:
+            data = adpcm_encode(encoder, chunk)
+        else:
+            data = int16_to_fp16(chunk)
+        retry(dut.upload, dut.REGION_SAMPLES, codec, offset, len(chunk), data)
+        offset += len(chunk)
+        progress(offset, length, start)
+    print()
+
+    retry(dut.upload_end, length)
+    print('Uploaded %u samples' % length)
+
+def read_flash(args):
+    dut = connect(args)
+    address = args.address
+    end = address + args.length
+    start = time.time()
+    with open(args.file, 'wb') as file:
+        while address < end:
+            (chunk, data) = retry(dut.download, dut.REGION_FLASH,
+                                  dut.CODEC_RAW, address,
+                                  min(end - address, 0xFFFF))
+            if chunk['length'] == 0:
+                sys.exit('\nDevice returned no data at 0x%X' % address)
+            file.write(data)
+            address += chunk['length']
+            progress(address - args.address, args.length, start)
+    print()
+
+def write_flash(args):
+    with open(args.file, 'rb') as file:
+        contents = file.read()
+
+    dut = connect(args)
+    state = retry(dut.transfer_info)
+    # Whole powers of two, so chunks don't straddle sectors needlessly
+    chunk_size = 1 << (state['max_data'].bit_length() - 1)
+    position = args.offset
+    start = time.time()
+    while position < len(contents):
+        data = contents[position:position + chunk_size]
+        retry(dut.upload, dut.REGION_FLASH, dut.CODEC_RAW,
+              args.address + position, len(data), data)
+        position += len(data)
+        progress(position, len(contents), start)
+    print()
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--text', action='store_true',
+        help='Use text lines instead of binary frames (slow)')
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    command = commands.add_parser('info', help='Show transfer parameters')
+    command.add_argument('port', help='Serial port')
+    command.set_defaults(function=info)
+
+    command = commands.add_parser('download', help='Save the recording')
+    command.add_argument('port', help='Serial port')
+    command.add_argument('file', help='WAV file to write')
+    command.add_argument('--adpcm', action='store_true',
+        help='Compress with IMA ADPCM')
+    command.set_defaults(function=download)
+
+    command = commands.add_parser('upload', help='Replace the recording')
+    command.add_argument('port', help='Serial port')
+    command.add_argument('file', help='WAV file to read')
+    command.add_argument('--adpcm', action='store_true',
+        help='Compress with IMA ADPCM')
+    command.add_argument('--resume', action='store_true',
+        help='Continue an interrupted upload')
+    command.set_defaults(function=upload)
+
+    command = commands.add_parser('read-flash', help='Save flash contents')
+    command.add_argument('port', help='Serial port')
+    command.add_argument('address', type=lambda x: int(x, 0))
+    command.add_argument('length', type=lambda x: int(x, 0))
+    command.add_argument('file', help='File to write')
+    command.set_defaults(function=read_flash)
+
+    command = commands.add_parser('write-flash',
+        help='Write a file to flash, erasing the sectors it starts')
+    command.add_argument('port', help='Serial port')
+    command.add_argument('address', type=lambda x: int(x, 0))
+    command.add_argument('file', help='File to read')
+    command.add_argument('--offset', type=lambda x: int(x, 0), default=0,
+        help='Resume from this offset into the file')
+    command.set_defaults(function=write_flash)
+
+    args = parser.parse_args()
+    args.function(args)
+
+if __name__ == '__main__':
+    main()
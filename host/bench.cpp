@@ -0,0 +1,248 @@
+// Throughput benchmark for util/fifo.h.
+//
+// Moves a counting sequence through a Fifo with each of its access styles:
+// an item at a time (Push/Pop), bulk copies (PushSpan/PopSpan), and in place
+// (AcquireWrite/CommitWrite, AcquireRead/Release). Each style runs on one
+// thread, alternating producer and consumer, and on two threads as a
+// concurrent single producer and consumer; the consumer checks the sequence,
+// so lost, duplicated or torn items fail the run.
+//
+// Usage:
+//   bench [options]
+//
+// Options:
+//   -n <items>    Items to move per run (default 50000000)
+//   -b <block>    Items per bulk call (default 64)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#include "util/fifo.h"
+
+using namespace recorder;
+
+static constexpr uint32_t kFifoSize = 1024;
+
+enum Style
+{
+    STYLE_ITEM,
+    STYLE_SPAN,
+    STYLE_IN_PLACE,
+};
+
+static const char* const kStyleNames[] = {"item", "span", "in place"};
+
+template <typename T>
+class Bench
+{
+public:
+    Bench(Style style, uint32_t block) : style_{style}, block_{block}
+    {
+        fifo_.Init();
+    }
+
+    // Pushes up to a block of the sequence, returning how many
+    uint32_t Produce(uint32_t& next, uint32_t end)
+    {
+        uint32_t length = std::min(block_, end - next);
+
+        if (style_ == STYLE_ITEM)
+        {
+            uint32_t i = 0;
+
+            while (i < length && fifo_.Push(T(next + i)))
+            {
+                i++;
+            }
+
+            length = i;
+        }
+        else if (style_ == STYLE_SPAN)
+        {
+            T buffer[kFifoSize];
+
+            for (uint32_t i = 0; i < length; i++)
+            {
+                buffer[i] = T(next + i);
+            }
+
+            length = fifo_.PushSpan(buffer, length);
+        }
+        else
+        {
+            auto span = fifo_.AcquireWrite(length);
+
+            for (uint32_t s = 0, n = next; s < 2; s++)
+            {
+                for (uint32_t i = 0; i < span.length[s]; i++)
+                {
+                    span.data[s][i] = T(n++);
+                }
+            }
+
+            length = span.total();
+            fifo_.CommitWrite(length);
+        }
+
+        next += length;
+        return length;
+    }
+
+    // Pops up to a block and checks it continues the sequence, returning how
+    // many, or -1 on a mismatch
+    int32_t Consume(uint32_t& next)
+    {
+        uint32_t length = 0;
+        bool ok = true;
+
+        if (style_ == STYLE_ITEM)
+        {
+            T item;
+
+            while (length < block_ && fifo_.Pop(item))
+            {
+                ok &= (item == T(next + length++));
+            }
+        }
+        else if (style_ == STYLE_SPAN)
+        {
+            T buffer[kFifoSize];
+            length = fifo_.PopSpan(buffer, block_);
+
+            for (uint32_t i = 0; i < length; i++)
+            {
+                ok &= (buffer[i] == T(next + i));
+            }
+        }
+        else
+        {
+            auto span = fifo_.AcquireRead(block_);
+
+            for (uint32_t s = 0, n = next; s < 2; s++)
+            {
+                for (uint32_t i = 0; i < span.length[s]; i++)
+                {
+                    ok &= (span.data[s][i] == T(n++));
+                }
+            }
+
+            length = span.total();
+            fifo_.Release(length);
+        }
+
+        next += length;
+        return ok ? length : -1;
+    }
+
+protected:
+    Fifo<T, kFifoSize> fifo_;
+    Style style_;
+    uint32_t block_;
+};
+
+// Returns items per second, or 0 if the sequence came out wrong
+template <typename T>
+static double Run(Style style, uint32_t block, uint32_t items, bool threaded)
+{
+    Bench<T> bench{style, block};
+    uint32_t produced = 0;
+    uint32_t consumed = 0;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+
+    if (threaded)
+    {
+        std::thread producer([&]
+        {
+            // Yield when stuck, for hosts with fewer cores than threads
+            while (produced < items)
+            {
+                if (bench.Produce(produced, items) == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        while (ok && consumed < items)
+        {
+            int32_t length = bench.Consume(consumed);
+            ok = length >= 0;
+
+            if (length == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+    }
+    else
+    {
+        while (ok && consumed < items)
+        {
+            bench.Produce(produced, items);
+            ok = bench.Consume(consumed) >= 0;
+        }
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return ok ? items / elapsed.count() : 0;
+}
+
+template <typename T>
+static bool Report(const char* type, uint32_t block, uint32_t items)
+{
+    bool ok = true;
+
+    for (bool threaded : {false, true})
+    {
+        for (Style style : {STYLE_ITEM, STYLE_SPAN, STYLE_IN_PLACE})
+        {
+            double rate = Run<T>(style, block, items, threaded);
+            std::printf("%-8s %-8s %-10s %10.1f Mitems/s%s\n", type,
+                threaded ? "2 thread" : "1 thread", kStyleNames[style],
+                rate / 1e6, rate ? "" : "  FAILED");
+            ok &= (rate != 0);
+        }
+    }
+
+    return ok;
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [-n items] [-b block]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t items = 50000000;
+    uint32_t block = 64;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': items = std::strtoul(optarg, nullptr, 0); break;
+            case 'b': block = std::strtoul(optarg, nullptr, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    if (block == 0 || block > kFifoSize)
+    {
+        std::fprintf(stderr, "block must be 1 to %u\n", kFifoSize);
+        return 2;
+    }
+
+    bool ok = Report<uint8_t>("uint8_t", block, items);
+    ok &= Report<float>("float", block, items);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,4 @@
+TARGET := bench
+SOURCES := bench.cpp
+TGT_CXXFLAGS := $(HOST_CXXFLAGS)
+TGT_LDLIBS := -lpthread
@@ -0,0 +1,624 @@
+#include "host/board.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "common/config.h"
+#include "drivers/adc.h"
+#include "drivers/profiling.h"
+#include "host/replay.h"
+#include "host/stress.h"
+#include "host/trace.h"
+#include "host/wav.h"
+
+namespace recorder::board
+{
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t kCallbacksPerMs = kAudioSampleRate / 1000;
+static constexpr uint32_t kWatchdogTimeout_ms = 100;
+
+// Carried across a simulated reset, which re-executes the program
+static constexpr const char* kRestartEnv = "VDEVICE_RESTART";
+static constexpr const char* kResetSourceEnv = "VDEVICE_RESET_SOURCE";
+static constexpr const char* kWakeupEnv = "VDEVICE_WAKEUP";
+static constexpr const char* kFlashFdEnv = "VDEVICE_FLASH_FD";
+
+struct Options
+{
+    const char* replay_path = nullptr;
+    const char* audio_in_path = nullptr;
+    const char* audio_out_path = nullptr;
+    const char* profile_path = nullptr;
+    const char* flash_path = nullptr;
+    const char* pty_link = nullptr;
+    const char* trace_path = nullptr;
+    uint32_t tail_ms = 1000;
+    float speed = -1;
+    bool pty = false;
+    stress::Options stress;
+};
+
+// Filled in by ParseOptions() below, which may run before dynamic
+// initializers, so the defaults must be constant-initialized.
+static constinit Options options_;
+
+static char** argv_;
+
+static HumanInput input_;
+static Replay replay_;
+static bool replaying_;
+static uint32_t tail_;
+static std::vector<float> audio_in_;
+static std::vector<float> audio_out_;
+static size_t audio_in_position_;
+static uint32_t loop_;
+static uint32_t callbacks_;
+static std::vector<CallbackTime> callback_times_;
+static CallbackTime callback_time_;
+static Clock::time_point section_start_;
+static std::FILE* profile_file_;
+static Clock::time_point start_time_;
+static float speed_;
+static uint32_t watchdog_ms_;
+static const char* reset_source_;
+static bool wakeup_was_play_button_;
+static int flash_fd_;
+static volatile std::sig_atomic_t interrupted_;
+static volatile std::sig_atomic_t play_pressed_;
+
+static void Usage(const char* name)
+{
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "Runs the firmware's main loop against a simulated board.\n"
+        "  -r capture   replay an input capture, then exit\n"
+        "  -t ms        keep running this long after the capture ends"
+            " (default 1000)\n"
+        "  -i in.wav    audio input (mono, %u Hz); silence otherwise\n"
+        "  -o out.wav   write the audio output (%u Hz)\n"
+        "  -p prof.csv  write the time taken by every audio callback\n"
+        "  -T out.json  write a timeline of the profiling pins as a\n"
+        "               Chrome trace (covers the run since the last reset)\n"
+        "  -f flash.bin back the flash with a file; otherwise it only\n"
+        "               survives simulated resets\n"
+        "  -P           serve the monitor on a pseudo-terminal instead of\n"
+        "               stdin/stdout (defaults to real-time pacing)\n"
+        "  -L path      with -P, symlink the pseudo-terminal to path\n"
+        "  -x speed     pace the simulation at speed times real time;\n"
+        "               0 runs as fast as possible (the default without -P)\n"
+        "  -R           same as -x 1\n"
+        "  -S trials    search for the input sequence that makes a single\n"
+        "               audio callback slowest (see host/stress.h)\n"
+        "  -d ms        length of each search trial (default %u)\n"
+        "  -n repeats   runs per trial, keeping each callback's fastest\n"
+        "               time to reject scheduling noise (default %u)\n"
+        "  -s seed      search random seed\n"
+        "  -w trace     write the slowest trial as a capture\n"
+        "In standby, send SIGUSR1 to press the play button.\n",
+        name, unsigned(kAudioOSRate), unsigned(kAudioOSRate),
+        unsigned(options_.stress.duration_ms),
+        unsigned(options_.stress.repeats));
+}
+
+// The firmware's main() takes no arguments, so the options are parsed by an
+// ELF constructor instead; glibc passes it the program's argc and argv.
+__attribute__ ((constructor))
+static void ParseOptions(int argc, char** argv)
+{
+    int opt;
+    argv_ = argv;
+
+    while ((opt = getopt(argc, argv, "r:t:i:o:p:T:f:PL:x:RS:d:n:s:w:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': options_.replay_path = optarg; break;
+            case 't': options_.tail_ms = std::atoi(optarg); break;
+            case 'i': options_.audio_in_path = optarg; break;
+            case 'o': options_.audio_out_path = optarg; break;
+            case 'p': options_.profile_path = optarg; break;
+            case 'T': options_.trace_path = optarg; break;
+            case 'f': options_.flash_path = optarg; break;
+            case 'P': options_.pty = true; break;
+            case 'L': options_.pty_link = optarg; break;
+            case 'x': options_.speed = std::atof(optarg); break;
+            case 'R': options_.speed = 1; break;
+            case 'S': options_.stress.trials = std::atoi(optarg); break;
+            case 'd': options_.stress.duration_ms = std::atoi(optarg); break;
+            case 'n':
+                options_.stress.repeats = std::max(1, std::atoi(optarg));
+                break;
+            case 's': options_.stress.seed = std::atoi(optarg); break;
+            case 'w': options_.stress.trace_path = optarg; break;
+            default:
+                Usage(argv[0]);
+                std::exit(opt == 'h' ? 0 : 1);
+        }
+    }
+}
+
+// The monitor talks to stdin/stdout, so the pseudo-terminal's master side
+// takes their place. Writes don't block, so output is dropped rather than
+// stalling the main loop when nobody is listening, much like the device's
+// UART. A reset re-executes the program with the descriptors inherited.
+static void OpenPty(void)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    const char* name = nullptr;
+
+    if (master < 0 || grantpt(master) || unlockpt(master) ||
+        (name = ptsname(master)) == nullptr)
+    {
+        std::perror("Can't open a pseudo-terminal");
+        std::exit(1);
+    }
+
+    // Hold the device side open so it keeps its settings between clients
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    termios tio;
+
+    if (slave >= 0 && tcgetattr(slave, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    dup2(master, STDIN_FILENO);
+    dup2(master, STDOUT_FILENO);
+    close(master);
+
+    if (options_.pty_link)
+    {
+        unlink(options_.pty_link);
+
+        if (symlink(name, options_.pty_link))
+        {
+            std::perror(options_.pty_link);
+        }
+    }
+
+    std::fprintf(stderr, "Serial port: %s\n",
+        options_.pty_link ? options_.pty_link : name);
+}
+
+static void OpenFlash(void)
+{
+    if (options_.flash_path)
+    {
+        flash_fd_ = open(options_.flash_path, O_RDWR | O_CREAT, 0644);
+
+        if (flash_fd_ < 0)
+        {
+            std::perror(options_.flash_path);
+        }
+    }
+    else
+    {
+        std::FILE* file = std::tmpfile();
+        flash_fd_ = file ? dup(fileno(file)) : -1;
+    }
+}
+
+void Init(void)
+{
+    bool restarted = std::getenv(kRestartEnv);
+    input_.Init();
+    loop_ = 0;
+    callbacks_ = 0;
+    tail_ = 0;
+    watchdog_ms_ = 0;
+    audio_in_position_ = 0;
+    replaying_ = false;
+    reset_source_ = restarted ? std::getenv(kResetSourceEnv) : "POR";
+    wakeup_was_play_button_ = restarted && std::getenv(kWakeupEnv);
+    speed_ = (options_.speed >= 0) ? options_.speed : options_.pty ? 1 : 0;
+
+    if (restarted)
+    {
+        flash_fd_ = std::atoi(std::getenv(kFlashFdEnv));
+    }
+    else if (options_.stress.trials)
+    {
+        // Each trial gets a private, blank flash
+        flash_fd_ = -1;
+        speed_ = 0;
+    }
+    else
+    {
+        OpenFlash();
+
+        if (options_.pty)
+        {
+            OpenPty();
+        }
+    }
+
+    std::setvbuf(stdout, nullptr, options_.pty ? _IONBF : _IOLBF, 0);
+    start_time_ = Clock::now();
+
+    if (options_.stress.trials)
+    {
+        // Only returns in a trial process, which runs one candidate trace
+        replay_.Set(stress::Search(options_.stress), false);
+        replaying_ = true;
+        options_.tail_ms = 0;
+    }
+    else if (options_.replay_path)
+    {
+        if (!replay_.Load(options_.replay_path))
+        {
+            std::fprintf(stderr, "Can't load capture %s\n",
+                options_.replay_path);
+            std::exit(1);
+        }
+
+        replaying_ = true;
+    }
+
+    if (options_.audio_in_path)
+    {
+        uint32_t rate;
+
+        if (!wav::Read(options_.audio_in_path, audio_in_, rate))
+        {
+            std::fprintf(stderr, "Can't read %s\n", options_.audio_in_path);
+            std::exit(1);
+        }
+
+        if (rate != kAudioOSRate)
+        {
+            std::fprintf(stderr, "%s: expected %u Hz, got %u Hz\n",
+                options_.audio_in_path, unsigned(kAudioOSRate),
+                unsigned(rate));
+        }
+    }
+
+    if (options_.profile_path)
+    {
+        profile_file_ = std::fopen(options_.profile_path, "w");
+
+        if (profile_file_)
+        {
+            std::fprintf(profile_file_,
+                "callback,loop,ns,section,section_ns\n");
+        }
+    }
+
+    if (options_.trace_path && !stress::trial())
+    {
+        trace::Start();
+    }
+
+    std::signal(SIGINT, [](int) { interrupted_ = true; });
+    std::signal(SIGTERM, [](int) { interrupted_ = true; });
+    std::signal(SIGUSR1, [](int) { play_pressed_ = true; });
+}
+
+HumanInput& input(void)
+{
+    return input_;
+}
+
+void ReadAudio(AudioInput& audio)
+{
+    for (uint32_t i = 0; i < kAudioOSFactor; i++)
+    {
+        float sample = (audio_in_position_ < audio_in_.size()) ?
+            audio_in_[audio_in_position_++] : 0;
+
+        for (uint32_t ch = 0; ch < NUM_AUDIO_INS; ch++)
+        {
+            audio[ch][i] = sample;
+        }
+    }
+}
+
+void WriteAudio(const AudioOutput& audio)
+{
+    if (options_.audio_out_path)
+    {
+        for (uint32_t i = 0; i < kAudioOSFactor; i++)
+        {
+            audio_out_.push_back(
+                std::clamp<float>(audio[AUDIO_OUT_LINE][i], -1, 1));
+        }
+    }
+}
+
+static void RunCallbacks(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        callback_time_ = {loop_, 0, 0, SECTION_NONE};
+        auto start = Clock::now();
+        trace::SetTrack(trace::TRACK_AUDIO);
+        bool performed = Adc::Tick();
+        trace::SetTrack(trace::TRACK_MAIN);
+
+        if (!performed)
+        {
+            continue;
+        }
+
+        callback_time_.ns = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(Clock::now() - start).count();
+        callback_times_.push_back(callback_time_);
+        callbacks_++;
+
+        if (profile_file_)
+        {
+            std::fprintf(profile_file_, "%u,%u,%u,%s,%u\n",
+                unsigned(callbacks_), unsigned(loop_),
+                unsigned(callback_time_.ns),
+                section_name(callback_time_.section),
+                unsigned(callback_time_.section_ns));
+        }
+    }
+}
+
+void Advance(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        if (interrupted_)
+        {
+            PowerOff("interrupted");
+        }
+
+        loop_++;
+
+        if (++watchdog_ms_ > kWatchdogTimeout_ms)
+        {
+            Reset("IWDG1");
+        }
+
+        if (replaying_)
+        {
+            uint32_t count =
+                replay_.Callbacks(loop_, callbacks_, kCallbacksPerMs);
+            RunCallbacks(count ? count - 1 : 0);
+            replay_.Apply(loop_, input_);
+            RunCallbacks(count ? 1 : 0);
+            replay_.Check(callbacks_);
+
+            if (replay_.done() && tail_++ >= options_.tail_ms)
+            {
+                PowerOff("end of capture");
+            }
+        }
+        else
+        {
+            RunCallbacks(kCallbacksPerMs);
+        }
+
+        if (speed_ > 0)
+        {
+            std::this_thread::sleep_until(start_time_ +
+                std::chrono::microseconds(int64_t(loop_ * 1000 / speed_)));
+        }
+    }
+}
+
+static void Report(void)
+{
+    std::fprintf(stderr, "%u main-loop iterations, %u audio callbacks\n",
+        unsigned(loop_), unsigned(callbacks_));
+
+    if (replaying_)
+    {
+        std::fprintf(stderr, "Replayed %u frames, %u timing divergences\n",
+            replay_.frames(), replay_.divergences());
+    }
+
+    if (!callback_times_.empty())
+    {
+        std::vector<uint32_t> ns;
+        double sum = 0;
+
+        for (auto& t : callback_times_)
+        {
+            ns.push_back(t.ns);
+            sum += t.ns;
+        }
+
+        auto percentile = [&](double p)
+        {
+            auto nth = ns.begin() + size_t(p * (ns.size() - 1));
+            std::nth_element(ns.begin(), nth, ns.end());
+            return *nth / 1e3;
+        };
+
+        std::fprintf(stderr, "Callback time (host us): mean %.2f, "
+            "p50 %.2f, p99 %.2f, p99.9 %.2f, max %.2f "
+            "(period %.1f us)\n",
+            sum / ns.size() / 1e3, percentile(0.5), percentile(0.99),
+            percentile(0.999), percentile(1), 1e6 / kAudioSampleRate);
+
+        for (uint32_t section = 0; section < NUM_SECTIONS; section++)
+        {
+            uint32_t count = 0;
+            double section_sum = 0;
+            uint32_t section_max = 0;
+
+            for (auto& t : callback_times_)
+            {
+                if (t.section == section)
+                {
+                    count++;
+                    section_sum += t.section_ns;
+                    section_max = std::max(section_max, t.section_ns);
+                }
+            }
+
+            if (count && section != SECTION_NONE)
+            {
+                std::fprintf(stderr, "  %-10s %8u callbacks, engine mean "
+                    "%.2f us, max %.2f us\n", section_name(section),
+                    unsigned(count), section_sum / count / 1e3,
+                    section_max / 1e3);
+            }
+        }
+    }
+}
+
+static void Finish(void)
+{
+    std::fflush(stdout);
+    Report();
+
+    if (profile_file_)
+    {
+        std::fclose(profile_file_);
+        profile_file_ = nullptr;
+    }
+
+    if (options_.audio_out_path &&
+        !wav::Write(options_.audio_out_path, audio_out_, kAudioOSRate))
+    {
+        std::fprintf(stderr, "Can't write %s\n", options_.audio_out_path);
+    }
+
+    if (trace::enabled() && !trace::Write(options_.trace_path))
+    {
+        std::fprintf(stderr, "Can't write %s\n", options_.trace_path);
+    }
+}
+
+void ReloadWatchdog(void)
+{
+    watchdog_ms_ = 0;
+}
+
+void BeginSection(uint32_t profile)
+{
+    callback_time_.section = SECTION_SYNTH + (profile - PROFILE_SYNTH);
+    section_start_ = Clock::now();
+}
+
+void EndSection(uint32_t profile)
+{
+    callback_time_.section_ns += std::chrono::duration_cast<
+        std::chrono::nanoseconds>(Clock::now() - section_start_).count();
+}
+
+const char* section_name(uint32_t section)
+{
+    static constexpr const char* kNames[NUM_SECTIONS] =
+    {
+        "none", "synth", "jingle", "playback", "recording",
+    };
+
+    return (section < NUM_SECTIONS) ? kNames[section] : "?";
+}
+
+void Standby(void)
+{
+    if (replaying_)
+    {
+        PowerOff("standby");
+    }
+
+    std::fflush(stdout);
+    std::fprintf(stderr, "Standby; press play with kill -USR1 %d\n",
+        int(getpid()));
+
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+    play_pressed_ = false;
+
+    while (!play_pressed_ && !interrupted_)
+    {
+        sigsuspend(&old_mask);
+    }
+
+    sigprocmask(SIG_SETMASK, &old_mask, nullptr);
+
+    if (interrupted_)
+    {
+        PowerOff("interrupted");
+    }
+
+    // The UART is off in standby, so anything sent meanwhile is lost
+    pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    char byte;
+
+    while (poll(&fd, 1, 0) == 1 && (fd.revents & POLLIN) &&
+        read(STDIN_FILENO, &byte, 1) == 1);
+
+    setenv(kWakeupEnv, "1", 1);
+    Reset("WAKE");
+}
+
+void Reset(const char* source)
+{
+    if (replaying_)
+    {
+        PowerOff(source);
+    }
+
+    std::fprintf(stderr, "Reset: %s\n", source);
+    Finish();
+
+    char fd[16];
+    std::snprintf(fd, sizeof(fd), "%d", flash_fd_);
+    setenv(kRestartEnv, "1", 1);
+    setenv(kResetSourceEnv, source, 1);
+    setenv(kFlashFdEnv, fd, 1);
+
+    if (std::strcmp(source, "WAKE"))
+    {
+        unsetenv(kWakeupEnv);
+    }
+
+    optind = 1;
+    execv("/proc/self/exe", argv_);
+    execvp(argv_[0], argv_);
+    std::perror("Reset failed");
+    std::exit(1);
+}
+
+void PowerOff(const char* reason)
+{
+    if (stress::trial())
+    {
+        stress::FinishTrial(callback_times_, replay_.trace());
+    }
+
+    std::fprintf(stderr, "Simulation ended: %s\n", reason);
+    Finish();
+    std::exit(0);
+}
+
+const char* reset_source(void)
+{
+    return reset_source_ ? reset_source_ : "unknown";
+}
+
+bool wakeup_was_play_button(void)
+{
+    return wakeup_was_play_button_;
+}
+
+int flash_fd(void)
+{
+    return flash_fd_;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common/io.h"
+
+namespace recorder::board
+{
+
+// Simulated hardware behind the host drivers in host/drivers. It owns the
+// control inputs (already debounced and filtered, which is also what a
+// capture records), the audio streams, the serial port, and the simulated
+// clock that paces the audio callbacks against the main loop.
+
+void Init(void);
+
+HumanInput& input(void);
+void ReadAudio(AudioInput& audio);
+void WriteAudio(const AudioOutput& audio);
+
+// Called from system::WaitForEvents(); each millisecond is one main-loop
+// iteration and its audio callbacks.
+void Advance(uint32_t ms);
+
+void ReloadWatchdog(void);
+
+// Timing of one audio callback. The engine sections of the callback are
+// marked by their profiling pins (see host/drivers/profiling.h).
+struct CallbackTime
+{
+    uint32_t loop;
+    uint32_t ns;
+    uint32_t section_ns;
+    uint8_t section;
+};
+
+enum Section
+{
+    SECTION_NONE,
+    SECTION_SYNTH,
+    SECTION_JINGLE,
+    SECTION_PLAYBACK,
+    SECTION_RECORDING,
+    NUM_SECTIONS,
+};
+
+void BeginSection(uint32_t profile);
+void EndSection(uint32_t profile);
+const char* section_name(uint32_t section);
+
+// Sleeps until the play button is pressed (SIGUSR1), then resets
+[[noreturn]] void Standby(void);
+
+// Restarts the firmware from scratch like a hardware reset. The serial port
+// and flash contents survive; `source` is reported as the reset source.
+[[noreturn]] void Reset(const char* source);
+
+// Ends the simulation, reporting the callback timing profile
+[[noreturn]] void PowerOff(const char* reason);
+
+const char* reset_source(void);
+bool wakeup_was_play_button(void);
+
+// Backing file for the flash model, or -1
+int flash_fd(void);
+
+}
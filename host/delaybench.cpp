@@ -0,0 +1,211 @@
+// CPU benchmark for app/engine/delay_engine.h.
+//
+// Times the delay a sample per call, as PlaybackEngine runs it, and over
+// blocks, with 0 to kMaxTaps extra read taps, on a sine through a moving
+// delay time with feedback. It runs with float, half float and Q15 storage:
+// x86 converts half floats in software, where the Cortex-M7 takes one
+// instruction, so the float figures are closer to the device's balance.
+//
+// Then it measures each 16 bit storage's SNR against float storage on the
+// same input and taps, at a few levels, since half floats keep their
+// precision as the signal falls and Q15 doesn't.
+//
+// Usage:
+//   delaybench [options]
+//
+// Options:
+//   -n <samples>  Samples per run (default 4000000)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+#include "app/engine/delay_engine.h"
+
+using namespace recorder;
+
+static constexpr uint32_t kMaxTaps = 4;
+
+template <typename Storage>
+using Engine = BasicDelayEngine<Storage, kMaxTaps>;
+
+static constexpr float kTaps[kMaxTaps][2] = {
+    {0.25, 0.5}, {0.5, -0.5}, {0.75, 0.5}, {0.125, -0.25},
+};
+
+// A whole number of every block size
+static constexpr uint32_t kInputSize = 48 * 1024;
+static float input_[kInputSize];
+
+// The delay's output can peak at 2
+using Q15DelayStorage = Q15Storage<2>;
+
+// The input's peak in the SNR runs
+static constexpr float kLevels_dB[] = {-6, -20, -40};
+
+// Switch the delay time every second, to keep the ramps busy
+static float Delay(uint32_t n)
+{
+    return 0.5f + 0.3f * ((n >> 14) & 1);
+}
+
+template <typename Storage>
+static void Start(Engine<Storage>& engine, uint32_t taps)
+{
+    typename Engine<Storage>::Tap tap_list[kMaxTaps];
+
+    for (uint32_t i = 0; i < kMaxTaps; i++)
+    {
+        tap_list[i] = {kTaps[i][0], kTaps[i][1]};
+    }
+
+    engine.Init();
+    engine.SetTaps(tap_list, taps);
+}
+
+// Returns nanoseconds per sample, the best of a few runs
+template <typename Storage>
+static double Run(uint32_t block, uint32_t taps, uint32_t samples)
+{
+    // Too big for the stack
+    static Engine<Storage> engine_;
+
+    double best = 1e9;
+    float sum = 0;
+    float out[48] = {};
+
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        Start(engine_, taps);
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t n = 0; n < samples; n += block)
+        {
+            float delay = Delay(n);
+            const float* in = &input_[n % kInputSize];
+
+            if (block == 1)
+            {
+                out[0] = engine_.Process(in[0], delay, 0.7f);
+            }
+            else
+            {
+                engine_.Process(in, out, block, delay, 0.7f);
+            }
+
+            sum += out[0];
+        }
+
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() * 1e9 / samples);
+    }
+
+    volatile float sink = sum;
+    (void)sink;
+    return best;
+}
+
+// The engine's output over kSnrSize samples in blocks of 48 with every tap,
+// on the input at `level`
+static constexpr uint32_t kSnrSize = 4 * kInputSize;
+
+template <typename Storage>
+static void Render(float level, float* out)
+{
+    static Engine<Storage> engine_;
+    float in[48];
+
+    Start(engine_, kMaxTaps);
+
+    for (uint32_t n = 0; n < kSnrSize; n += 48)
+    {
+        for (uint32_t i = 0; i < 48; i++)
+        {
+            in[i] = level * input_[(n + i) % kInputSize];
+        }
+
+        engine_.Process(in, &out[n], 48, Delay(n), 0.7f);
+    }
+}
+
+static double Snr(const float* reference, const float* test, uint32_t size)
+{
+    double signal = 0;
+    double noise = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        double e = double(test[i]) - reference[i];
+        signal += double(reference[i]) * reference[i];
+        noise += e * e;
+    }
+
+    return 10 * std::log10(signal / std::max<double>(noise, 1e-30));
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [-n samples]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t samples = 4000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': samples = std::strtoul(optarg, nullptr, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    samples -= samples % 48;
+
+    for (uint32_t i = 0; i < kInputSize; i++)
+    {
+        input_[i] = 0.5f * std::sin(i * 0.01f);
+    }
+
+    std::printf("%-8s %-6s %12s %12s %12s\n", "block", "taps", "ns float",
+        "ns half", "ns q15");
+
+    for (uint32_t block : {1u, 16u, 48u})
+    {
+        for (uint32_t taps = 0; taps <= kMaxTaps; taps++)
+        {
+            double ns_float = Run<FloatStorage>(block, taps, samples);
+            double ns_half = Run<HalfStorage>(block, taps, samples);
+            double ns_q15 = Run<Q15DelayStorage>(block, taps, samples);
+            std::printf("%-8u %-6u %12.2f %12.2f %12.2f\n", block, taps,
+                ns_float, ns_half, ns_q15);
+        }
+    }
+
+    // Too big for the stack
+    static float expected[kSnrSize];
+    static float actual[kSnrSize];
+
+    std::printf("\n%-8s %12s %12s\n", "dBFS", "snr half", "snr q15");
+
+    for (float level_dB : kLevels_dB)
+    {
+        // input_ peaks at 0.5
+        float level = 2 * std::pow(10.f, level_dB / 20);
+        Render<FloatStorage>(level, expected);
+        Render<HalfStorage>(level, actual);
+        double snr_half = Snr(expected, actual, kSnrSize);
+        Render<Q15DelayStorage>(level, actual);
+        double snr_q15 = Snr(expected, actual, kSnrSize);
+        std::printf("%-8.0f %12.1f %12.1f\n", level_dB, snr_half, snr_q15);
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common/io.h"
+#include "host/board.h"
+
+namespace recorder
+{
+
+// Host stand-in for drivers/adc.h. There is no conversion sequence or pot
+// filtering: the simulated board supplies audio and already-filtered pot
+// positions, and calls Tick() once per audio callback period.
+class Adc
+{
+public:
+    using Callback = void (*)(const AudioInput&, const PotInput& pot);
+
+    void Init(Callback callback)
+    {
+        instance_ = this;
+        callback_ = callback;
+        started_ = false;
+    }
+
+    void Start(void)
+    {
+        started_ = true;
+    }
+
+    void Stop(void)
+    {
+        started_ = false;
+    }
+
+    // The simulated board never runs a callback late
+    uint32_t overruns(void) const
+    {
+        return 0;
+    }
+
+    // Returns true if a callback was performed
+    static bool Tick(void)
+    {
+        if (instance_ == nullptr || !instance_->started_)
+        {
+            return false;
+        }
+
+        AudioInput audio;
+        board::ReadAudio(audio);
+        instance_->callback_(audio, board::input().pot);
+        return true;
+    }
+
+protected:
+    static inline Adc* instance_;
+    Callback callback_;
+    bool started_;
+};
+
+}
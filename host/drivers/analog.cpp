@@ -0,0 +1,37 @@
+#include "drivers/analog.h"
+
+namespace recorder
+{
+
+// Host implementation of the out-of-line parts of drivers/analog.h. The
+// simulated board paces the audio callbacks, so there is no sample timer.
+
+void Analog::Init(Callback callback)
+{
+    instance_ = this;
+    callback_ = callback;
+
+    adc_enable_.Init();
+    adc_enable_.Set();
+    boost_enable_.Init();
+    amp_enable_.Init();
+
+    adc_.Init(AdcCallback);
+    dac_.Init();
+    InitTimer();
+
+    fade_position_ = 0;
+    state_ = STATE_STOPPED;
+    cue_stop_ = false;
+    callbacks_.store(0, std::memory_order_relaxed);
+    cycle_counter::Init();
+    load_meter_.Init(kAudioSampleRate, cycle_counter::kFrequency);
+    Stop();
+}
+
+void Analog::InitTimer(void) {}
+void Analog::StartTimer(void) {}
+void Analog::StopTimer(void) {}
+void Analog::TimerHandler(void) {}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+namespace recorder
+{
+
+// Host stand-in for drivers/crc.h. Computes the same value as the STM32 CRC
+// unit in the configuration the firmware uses: CRC-32 polynomial, no bit
+// reversal, inverted seed and output, and 32-bit words fed MSB first.
+class Crc
+{
+public:
+    void Init(void)
+    {
+        Seed(0);
+    }
+
+    void Seed(uint32_t value)
+    {
+        crc_ = ~value;
+    }
+
+    uint32_t Process(const uint8_t* data, uint32_t size)
+    {
+        while (size >= 4)
+        {
+            uint32_t word = data[0] | (data[1] << 8) | (data[2] << 16) |
+                (uint32_t(data[3]) << 24);
+            Feed(word, 32);
+            size -= 4;
+            data += 4;
+        }
+
+        while (size--)
+        {
+            Feed(*data++, 8);
+        }
+
+        return value();
+    }
+
+    template <typename T>
+    uint32_t Process(const T* data, uint32_t size)
+    {
+        return Process(reinterpret_cast<const uint8_t*>(data), size);
+    }
+
+    uint32_t value(void) const
+    {
+        return ~crc_;
+    }
+
+protected:
+    static constexpr uint32_t kPolynomial = 0x04C11DB7;
+    uint32_t crc_;
+
+    void Feed(uint32_t data, uint32_t bits)
+    {
+        crc_ ^= data << (32 - bits);
+
+        for (uint32_t i = 0; i < bits; i++)
+        {
+            crc_ = (crc_ & 0x80000000) ? (crc_ << 1) ^ kPolynomial : crc_ << 1;
+        }
+    }
+};
+
+}
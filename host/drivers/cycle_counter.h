@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+namespace recorder::cycle_counter
+{
+
+// Host stand-in for drivers/cycle_counter.h, counting nanoseconds of the
+// monotonic clock instead of core cycles.
+constexpr uint32_t kFrequency = 1000000000;
+
+inline void Init(void) {}
+
+inline uint32_t Read(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
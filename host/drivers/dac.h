@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common/config.h"
+#include "common/io.h"
+#include "host/board.h"
+
+namespace recorder
+{
+
+// Host stand-in for drivers/dac.h; samples go straight to the simulated
+// board's audio output.
+class Dac
+{
+public:
+    void Init(void) {}
+
+    void Process(const AudioOutput& audio)
+    {
+        board::WriteAudio(audio);
+    }
+
+    void Start(void) {}
+    void Stop(void) {}
+
+    uint32_t underruns(void) const
+    {
+        return 0;
+    }
+};
+
+}
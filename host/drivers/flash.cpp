@@ -0,0 +1,54 @@
+#include "drivers/flash.h"
+
+#include <cstdio>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "host/board.h"
+
+namespace recorder
+{
+
+void Flash::Init(void)
+{
+    if (memory_ != nullptr)
+    {
+        return;
+    }
+
+    // The board keeps the image open across simulated resets
+    int fd = board::flash_fd();
+    struct stat st;
+
+    // A new or short image is extended with erased bytes
+    if (fd >= 0 && fstat(fd, &st) == 0 &&
+        (st.st_size >= kSize || ftruncate(fd, kSize) == 0))
+    {
+        void* map = mmap(nullptr, kSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            memory_ = static_cast<uint8_t*>(map);
+
+            if (st.st_size < kSize)
+            {
+                std::memset(memory_ + st.st_size, kFillByte,
+                    kSize - st.st_size);
+            }
+        }
+        else
+        {
+            std::perror("Can't map flash image");
+        }
+    }
+
+    if (memory_ == nullptr)
+    {
+        memory_ = new uint8_t[kSize];
+        ChipErase();
+    }
+}
+
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "drivers/profiling.h"
+
+namespace recorder
+{
+
+// Host stand-in for drivers/flash.h: a NOR flash model with the same
+// geometry and API. Programming can only clear bits, erasing sets whole
+// sectors to kFillByte, and each Finish call completes one page or block
+// just like one status-polling round on the device. Operations never report
+// busy, so simulated time does not pass while the firmware polls.
+//
+// The contents live in memory, or in a file mapped by Init() when the
+// simulated board was given one, so saves survive a simulated reset.
+class Flash
+{
+public:
+    static constexpr uint32_t kSize = 8 * 1024 * 1024;
+    static constexpr uint32_t kEraseGranularity = 4 * 1024;
+    static constexpr uint32_t kWriteGranularity = 1;
+    static constexpr uint8_t kFillByte = 0xFF;
+
+    void Init(void);
+
+    void PowerDown(void) {}
+
+    void ChipErase(void)
+    {
+        std::memset(memory_, kFillByte, kSize);
+    }
+
+    bool Read(void* dst, uint32_t location, uint32_t length)
+    {
+        if (!InRange(location, length))
+        {
+            return false;
+        }
+
+        ScopedProfilingPin<PROFILE_FLASH_READ> profile1;
+        ScopedProfilingPin<PROFILE_FLASH_ACCESS> profile2;
+        std::memcpy(dst, memory_ + location, length);
+        return true;
+    }
+
+    bool Writable(uint32_t location, uint32_t length)
+    {
+        return InRange(location, length) &&
+            std::all_of(memory_ + location, memory_ + location + length,
+                [](uint8_t byte) { return byte == kFillByte; });
+    }
+
+    bool Write(uint32_t location, const void* src, uint32_t length)
+    {
+        if (!BeginWrite(location, src, length))
+        {
+            return false;
+        }
+
+        while (!FinishWrite());
+        return true;
+    }
+
+    bool BeginWrite(uint32_t location, const void* src, uint32_t length)
+    {
+        if ((location % kWriteGranularity) || (length % kWriteGranularity) ||
+            !InRange(location, length))
+        {
+            return false;
+        }
+
+        state_ =
+        {
+            .location = location,
+            .length = length,
+            .bytes = reinterpret_cast<const uint8_t*>(src),
+        };
+
+        ProfilingPin<PROFILE_FLASH_WRITE>::Set();
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Set();
+        return true;
+    }
+
+    bool FinishWrite(void)
+    {
+        if (state_.length == 0)
+        {
+            return true;
+        }
+
+        uint32_t offset_in_page = state_.location % kPageSize;
+        uint32_t len = std::min(state_.length, kPageSize - offset_in_page);
+
+        for (uint32_t i = 0; i < len; i++)
+        {
+            memory_[state_.location + i] &= state_.bytes[i];
+        }
+
+        state_.bytes += len;
+        state_.location += len;
+        state_.length -= len;
+
+        bool done = (state_.length == 0);
+        ProfilingPin<PROFILE_FLASH_WRITE>::Write(!done);
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Write(!done);
+        return done;
+    }
+
+    void AbortWrite(void)
+    {
+        ProfilingPin<PROFILE_FLASH_WRITE>::Clear();
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Clear();
+    }
+
+    bool Erase(uint32_t location, uint32_t length)
+    {
+        if (!BeginErase(location, length))
+        {
+            return false;
+        }
+
+        while (!FinishErase());
+        return true;
+    }
+
+    bool BeginErase(uint32_t location, uint32_t length)
+    {
+        if ((location % kEraseGranularity) || (length % kEraseGranularity) ||
+            !InRange(location, length))
+        {
+            return false;
+        }
+
+        state_ =
+        {
+            .location = location,
+            .length = length,
+            .bytes = nullptr,
+        };
+
+        ProfilingPin<PROFILE_FLASH_ERASE>::Set();
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Set();
+        return true;
+    }
+
+    bool FinishErase(void)
+    {
+        uint32_t length = state_.length;
+        uint32_t location = state_.location;
+
+        if (length == 0)
+        {
+            return true;
+        }
+
+        uint32_t block = kEraseGranularity;
+
+        if ((location % kBlock64Size == 0) && (length >= kBlock64Size))
+        {
+            block = kBlock64Size;
+        }
+        else if ((location % kBlock32Size == 0) && (length >= kBlock32Size))
+        {
+            block = kBlock32Size;
+        }
+
+        std::memset(memory_ + location, kFillByte, block);
+        state_.length = length - block;
+        state_.location = location + block;
+
+        bool done = (state_.length == 0);
+        ProfilingPin<PROFILE_FLASH_ERASE>::Write(!done);
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Write(!done);
+        return done;
+    }
+
+    void AbortErase(void)
+    {
+        ProfilingPin<PROFILE_FLASH_ERASE>::Clear();
+        ProfilingPin<PROFILE_FLASH_ACCESS>::Clear();
+    }
+
+protected:
+    static constexpr uint32_t kPageSize = 256;
+    static constexpr uint32_t kBlock32Size = 32 * 1024;
+    static constexpr uint32_t kBlock64Size = 64 * 1024;
+
+    struct State
+    {
+        uint32_t location;
+        uint32_t length;
+        const uint8_t* bytes;
+    };
+
+    State state_;
+    static inline uint8_t* memory_;
+
+    static bool InRange(uint32_t location, uint32_t length)
+    {
+        return location <= kSize && length <= kSize - location;
+    }
+};
+
+}
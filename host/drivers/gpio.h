@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+
+// Host stand-in for drivers/gpio.h. Output pins remember their level so the
+// simulated board can observe them; input pins read as released.
+
+#define GPIOA_BASE 0x58020000UL
+#define GPIOB_BASE 0x58020400UL
+#define GPIOC_BASE 0x58020800UL
+#define GPIOD_BASE 0x58020C00UL
+#define GPIOE_BASE 0x58021000UL
+#define GPIOF_BASE 0x58021400UL
+#define GPIOG_BASE 0x58021800UL
+#define GPIOH_BASE 0x58021C00UL
+#define GPIOI_BASE 0x58022000UL
+#define GPIOJ_BASE 0x58022400UL
+#define GPIOK_BASE 0x58022800UL
+
+namespace recorder
+{
+
+class GPIOPin
+{
+public:
+    enum Pull
+    {
+        PULL_NONE,
+        PULL_UP,
+        PULL_DOWN,
+    };
+
+    enum Speed
+    {
+        SPEED_LOW,
+        SPEED_MEDIUM,
+        SPEED_HIGH,
+    };
+
+    enum Type
+    {
+        TYPE_PUSHPULL,
+        TYPE_OPENDRAIN,
+    };
+};
+
+template <uint32_t gpio_base, uint32_t pin_number, bool invert = false>
+class OutputPin : public GPIOPin
+{
+public:
+    static void Init(Speed speed = SPEED_LOW,
+              Type  type  = TYPE_PUSHPULL,
+              Pull  pull  = PULL_NONE)
+    {
+        level_ = false;
+    }
+
+    static void Set(void)
+    {
+        level_ = !invert;
+    }
+
+    static void Clear(void)
+    {
+        level_ = invert;
+    }
+
+    static void Toggle(void)
+    {
+        level_ = !level_;
+    }
+
+    static void Write(bool state)
+    {
+        state ? Set() : Clear();
+    }
+
+    static bool level(void)
+    {
+        return level_;
+    }
+
+protected:
+    static inline bool level_;
+};
+
+template <uint32_t gpio_base, uint32_t pin_number, bool invert = false>
+class InputPin : public GPIOPin
+{
+public:
+    static void Init(Pull pull = PULL_NONE) {}
+
+    static uint32_t Read(void)
+    {
+        return 0;
+    }
+};
+
+class GenericInputPin : public GPIOPin
+{
+public:
+    void Init(uint32_t gpio_base, uint32_t pin_number, bool invert = false,
+        Pull pull = PULL_NONE) {}
+
+    uint32_t Read(void)
+    {
+        return 0;
+    }
+};
+
+}
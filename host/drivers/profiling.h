@@ -0,0 +1,87 @@
+#pragma once
+
+// Host stand-in for drivers/profiling.h. Every profiling pin writes begin and
+// end events to the trace (see host/trace.h), and the pins of the engine
+// sections of the audio callback also report to the simulated board, which
+// times them.
+#include "../../drivers/profiling.h"
+
+#include "host/board.h"
+#include "host/trace.h"
+
+namespace recorder::profiling::impl
+{
+
+// Level-triggered like a GPIO: only changes of state are events
+template <Profile profile>
+class TracePin : public ActiveType<true>, public DummyOutputPin
+{
+public:
+    static void Set(void)
+    {
+        if (!state_)
+        {
+            state_ = true;
+            trace::Begin(profile);
+        }
+    }
+
+    static void Clear(void)
+    {
+        if (state_)
+        {
+            state_ = false;
+            trace::End(profile);
+        }
+    }
+
+    static void Write(bool state)
+    {
+        state ? Set() : Clear();
+    }
+
+    static void Toggle(void)
+    {
+        trace::Instant(profile);
+    }
+
+protected:
+    static inline bool state_;
+};
+
+template <Profile profile>
+class BoardSection : public TracePin<profile>
+{
+public:
+    static void Set(void)
+    {
+        TracePin<profile>::Set();
+        board::BeginSection(profile);
+    }
+
+    static void Clear(void)
+    {
+        board::EndSection(profile);
+        TracePin<profile>::Clear();
+    }
+
+    static void Write(bool state)
+    {
+        state ? Set() : Clear();
+    }
+};
+
+// Every pin not assigned a GPIO by profiling_conf.h is traced
+template <Profile profile> requires true
+class ProfilingPin<profile> : public TracePin<profile> {};
+
+template <> class ProfilingPin<PROFILE_SYNTH> :
+    public BoardSection<PROFILE_SYNTH> {};
+template <> class ProfilingPin<PROFILE_JINGLE> :
+    public BoardSection<PROFILE_JINGLE> {};
+template <> class ProfilingPin<PROFILE_PLAYBACK> :
+    public BoardSection<PROFILE_PLAYBACK> {};
+template <> class ProfilingPin<PROFILE_RECORDING> :
+    public BoardSection<PROFILE_RECORDING> {};
+
+}
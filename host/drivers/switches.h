@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+#include "drivers/cycle_counter.h"
+#include "common/config.h"
+#include "common/events.h"
+#include "common/io.h"
+#include "host/board.h"
+
+namespace recorder
+{
+
+// Host stand-in for drivers/switches.h. The simulated board's switch and
+// detect states are already debounced.
+class Switches
+{
+public:
+    void Init(void)
+    {
+        scanned_ = ReadPins();
+        edge_time_ = 0;
+    }
+
+    bool Scan(void)
+    {
+        uint32_t pins = ReadPins();
+
+        if (pins == scanned_)
+        {
+            return false;
+        }
+
+        scanned_ = pins;
+        edge_time_ = cycle_counter::Read();
+        events::Post(events::EVENT_SWITCH);
+        return true;
+    }
+
+    void Process(HumanInput& in, bool tick)
+    {
+        auto& board = board::input();
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            in.sw[i] = (kEnableReverse || i != SWITCH_REVERSE) && board.sw[i];
+        }
+
+        for (uint32_t i = 0; i < NUM_DETECTS; i++)
+        {
+            in.detect[i] = kEnableLineIn && board.detect[i];
+        }
+    }
+
+    uint32_t edge_time(void) const
+    {
+        return edge_time_;
+    }
+
+protected:
+    uint32_t scanned_;
+    uint32_t edge_time_;
+
+    uint32_t ReadPins(void)
+    {
+        auto& board = board::input();
+        uint32_t pins = 0;
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            pins |= uint32_t(board.sw[i]) << i;
+        }
+
+        for (uint32_t i = 0; i < NUM_DETECTS; i++)
+        {
+            pins |= uint32_t(board.detect[i]) << (NUM_SWITCHES + i);
+        }
+
+        return pins;
+    }
+};
+
+}
@@ -0,0 +1,136 @@
+#include "drivers/system.h"
+
+#include <cstdio>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "drivers/profiling.h"
+#include "common/events.h"
+#include "host/board.h"
+
+namespace recorder::system
+{
+
+// Host implementation of drivers/system.h. The serial port is stdin/stdout
+// and time is the simulated board's clock.
+
+static void (*tick_callback_)(void);
+
+void Init(void)
+{
+    events::flags_.Init();
+    tick_callback_ = nullptr;
+    board::Init();
+    profiling::Init();
+    printf("Reset source was %s\n", board::reset_source());
+
+    if (board::wakeup_was_play_button())
+    {
+        printf("Wakeup event was play button\n");
+    }
+}
+
+// The flash model never reports busy, so nothing calls this on the host.
+void Delay_ms(uint32_t ms)
+{
+    board::Advance(ms);
+}
+
+// Every call is one housekeeping tick and one main-loop iteration, whatever
+// else was posted, which keeps runs and replays deterministic. Switches are
+// scanned once per call rather than every 100 us.
+uint32_t WaitForEvents(void)
+{
+    board::Advance(1);
+
+    if (tick_callback_)
+    {
+        tick_callback_();
+    }
+
+    uint32_t events = events::EVENT_TICK;
+
+    if (SerialBytesAvailable())
+    {
+        events |= events::EVENT_SERIAL;
+    }
+
+    return events | events::flags_.Take();
+}
+
+void SetTickCallback(void (*callback)(void))
+{
+    tick_callback_ = callback;
+}
+
+void RequestPoll(void)
+{
+    events::Post(events::EVENT_POLL);
+}
+
+uint32_t SerialBytesAvailable(void)
+{
+    int count = 0;
+
+    if (ioctl(STDIN_FILENO, FIONREAD, &count) < 0)
+    {
+        return 0;
+    }
+
+    return count;
+}
+
+uint8_t SerialGetByteBlocking(void)
+{
+    pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    uint8_t byte = 0;
+
+    if (poll(&fd, 1, -1) != 1 || !(fd.revents & POLLIN) ||
+        read(STDIN_FILENO, &byte, 1) != 1)
+    {
+        board::PowerOff("serial port closed");
+    }
+
+    return byte;
+}
+
+void SerialWrite(const void* data, uint32_t size)
+{
+    std::fwrite(data, 1, size, stdout);
+}
+
+void SerialFlushTx(bool discard)
+{
+    std::fflush(stdout);
+}
+
+// Writes to stdout never block (the pseudo-terminal drops what nobody reads)
+uint32_t SerialTxSpace(void)
+{
+    return UINT32_MAX;
+}
+
+void Standby(void)
+{
+    board::Standby();
+}
+
+bool WakeupWasPlayButton(void)
+{
+    return board::wakeup_was_play_button();
+}
+
+void Sleep(void) {}
+
+void Reset(void)
+{
+    board::Reset("SFT");
+}
+
+void ReloadWatchdog(void)
+{
+    board::ReloadWatchdog();
+}
+
+}
@@ -0,0 +1,344 @@
+// Float against Q15 (util/fixed.h) for the paths that have a fixed point
+// variant: the anti-aliasing filter, the mixer, and the delay line's storage.
+//
+// First checks Q15's saturating arithmetic against the exact result, rounded
+// and clamped, for every pair of a grid of values, and fails if any differ.
+// Then, for each path, prints:
+//
+//   ns      time per sample in float and in Q15, the best of a few runs
+//   snr     Q15's output against float's, in dB, with the input at -6 dBFS
+//           and at -40 dBFS, as fixed point's error doesn't fall with the
+//           level
+//
+// Last, it runs the anti-aliasing filter on its worst case full scale input,
+// the signs of its impulse response reversed, which takes its output (and
+// its last section's state) as high as any input can. It prints the float
+// output's peak, and the SNR of the Q15 output against the float output
+// clamped to Q15's range, as the Q15 output saturates there.
+//
+// On the host the DSP instructions are emulated in several x86 instructions
+// each, where the Cortex-M7 takes one, so the Q15 timings are pessimistic;
+// time the device before switching an engine over.
+//
+// Usage:
+//   fixedbench [options]
+//
+// Options:
+//   -n <samples>  Samples per timed run (default 4000000)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+#include "util/fixed.h"
+#include "app/engine/aafilter.h"
+#include "app/engine/mixer.h"
+#include "app/engine/delay_engine.h"
+
+using namespace recorder;
+
+static constexpr uint32_t kMixerChannels = 8;
+// A whole number of delay blocks
+static constexpr uint32_t kInputSize = 64 * 1024;
+static constexpr float kLevels_dB[] = {-6, -40};
+
+// Each channel a pair of tones of its own, peaking at 0 dBFS
+static float tones_[kMixerChannels][kInputSize];
+
+// The tones at a level, in each sample type, so that the timed runs don't
+// include the conversion
+template <typename T>
+static T input_[kMixerChannels][kInputSize];
+
+template <typename T>
+static void Load(float level)
+{
+    for (uint32_t i = 0; i < kMixerChannels; i++)
+    {
+        for (uint32_t n = 0; n < kInputSize; n++)
+        {
+            input_<T>[i][n] = T(level * tones_[i][n]);
+        }
+    }
+}
+
+// -fsingle-precision-constant makes M_PI a float
+static const double kPi = std::acos(-1.0);
+
+// Returns the number of mismatches
+static uint32_t CheckArithmetic(void)
+{
+    uint32_t failures = 0;
+
+    for (int32_t a = -32768; a < 32768; a += 97)
+    {
+        for (int32_t b = -32768; b < 32768; b += 89)
+        {
+            Q15 x = Q15::FromRaw(a);
+            Q15 y = Q15::FromRaw(b);
+            int32_t sum = std::clamp(a + b, -32768, 32767);
+            int32_t difference = std::clamp(a - b, -32768, 32767);
+            int32_t product = std::clamp<int32_t>(
+                std::floor(double(a) * b / 32768 + 0.5), -32768, 32767);
+
+            failures += ((x + y).raw() != sum);
+            failures += ((x - y).raw() != difference);
+            failures += ((x * y).raw() != product);
+        }
+    }
+
+    for (float f = -1.5; f <= 1.5; f += 1 / 1024.f)
+    {
+        int32_t expected = std::clamp<int32_t>(
+            std::floor(double(f) * 32768 + 0.5), -32768, 32767);
+        failures += (Q15(f).raw() != expected);
+    }
+
+    return failures;
+}
+
+static double Snr(const float* reference, const float* test, uint32_t size)
+{
+    double signal = 0;
+    double noise = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        double e = double(test[i]) - reference[i];
+        signal += double(reference[i]) * reference[i];
+        noise += e * e;
+    }
+
+    return 10 * std::log10(signal / std::max<double>(noise, 1e-30));
+}
+
+// Times `process(n)` over samples, in nanoseconds per sample
+template <typename Process>
+static double Time(uint32_t samples, Process&& process)
+{
+    double best = 1e9;
+
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t n = 0; n < samples; n++)
+        {
+            process(n);
+        }
+
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() * 1e9 / samples);
+    }
+
+    return best;
+}
+
+// Each path's Runner<T> runs a sample at a time in T, from input_<T>
+struct FilterPath
+{
+    template <typename T>
+    struct Runner
+    {
+        AAFilter<T> filter;
+
+        void Init(void)
+        {
+            filter.Init();
+        }
+
+        float Process(uint32_t n)
+        {
+            return float(filter.Process(input_<T>[0][n % kInputSize]));
+        }
+    };
+};
+
+struct MixerPath
+{
+    template <typename T>
+    struct Runner
+    {
+        Mixer<T, kMixerChannels> mixer;
+
+        void Init(void)
+        {
+            mixer.Init();
+
+            for (uint32_t i = 0; i < kMixerChannels; i++)
+            {
+                mixer.SetGain(i, 0.9f / kMixerChannels);
+            }
+        }
+
+        float Process(uint32_t n)
+        {
+            T in[kMixerChannels];
+
+            for (uint32_t i = 0; i < kMixerChannels; i++)
+            {
+                in[i] = input_<T>[i][n % kInputSize];
+            }
+
+            return float(mixer.Process(in));
+        }
+    };
+};
+
+// Only the storage is Q15 here, Q15Storage<2> as the delay's output can peak
+// at 2; the input is float either way
+struct DelayPath
+{
+    template <typename T>
+    using Storage = std::conditional_t<std::is_same_v<T, float>,
+        FloatStorage, Q15Storage<2>>;
+
+    template <typename T>
+    struct Runner
+    {
+        BasicDelayEngine<Storage<T>> engine;
+
+        void Init(void)
+        {
+            engine.Init();
+        }
+
+        float Process(uint32_t n)
+        {
+            return engine.Process(input_<float>[0][n % kInputSize], 0.3f,
+                0.7f);
+        }
+    };
+};
+
+template <typename Path>
+static void Row(const char* name, uint32_t samples)
+{
+    // Too big for the stack
+    static typename Path::template Runner<float> reference;
+    static typename Path::template Runner<Q15> test;
+    static float expected[kInputSize];
+    static float actual[kInputSize];
+    float sum = 0;
+
+    Load<float>(0.5f);
+    Load<Q15>(0.5f);
+    reference.Init();
+    double ns_float = Time(samples, [&](uint32_t n) {
+        sum += reference.Process(n);
+    });
+    test.Init();
+    double ns_q15 = Time(samples, [&](uint32_t n) {
+        sum += test.Process(n);
+    });
+    std::printf("%-8s %9.2f %9.2f", name, ns_float, ns_q15);
+
+    for (float level_dB : kLevels_dB)
+    {
+        float level = std::pow(10.f, level_dB / 20);
+        Load<float>(level);
+        Load<Q15>(level);
+        reference.Init();
+        test.Init();
+
+        for (uint32_t n = 0; n < kInputSize; n++)
+        {
+            expected[n] = reference.Process(n);
+            actual[n] = test.Process(n);
+        }
+
+        std::printf(" %9.1f", Snr(expected, actual, kInputSize));
+    }
+
+    std::printf("\n");
+    volatile float sink = sum;
+    (void)sink;
+}
+
+// Returns the SNR
+static double WorstCase(float* peak)
+{
+    // Long enough for the impulse response to die away
+    constexpr uint32_t kResponseSize = 4096;
+    constexpr float kMax = 32767 / 32768.f;
+    static AAFilter<float> reference;
+    static AAFilter<Q15> test;
+    static float response[kResponseSize];
+    static float expected[kInputSize];
+    static float actual[kInputSize];
+
+    reference.Init();
+
+    for (uint32_t n = 0; n < kResponseSize; n++)
+    {
+        response[n] = reference.Process((n == 0) ? 1 : 0);
+    }
+
+    reference.Init();
+    test.Init();
+    *peak = 0;
+
+    for (uint32_t n = 0; n < kInputSize; n++)
+    {
+        float in = (response[kResponseSize - 1 - n % kResponseSize] < 0) ?
+            -1 : kMax;
+        float out = reference.Process(in);
+        *peak = std::max(*peak, std::fabs(out));
+        expected[n] = std::clamp(out, -1.f, kMax);
+        actual[n] = float(test.Process(Q15(in)));
+    }
+
+    return Snr(expected, actual, kInputSize);
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [-n samples]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t samples = 4000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': samples = std::strtoul(optarg, nullptr, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    uint32_t failures = CheckArithmetic();
+    std::printf("Q15 arithmetic: %u mismatches\n\n", failures);
+
+    for (uint32_t i = 0; i < kMixerChannels; i++)
+    {
+        // Spread over the 6 kHz band, at 48 kHz for the filter
+        double frequency = 0.003 + 0.017 * i;
+
+        for (uint32_t n = 0; n < kInputSize; n++)
+        {
+            tones_[i][n] = 0.5 * std::sin(2 * kPi * frequency * n) +
+                0.5 * std::sin(2 * kPi * 1.618 * frequency * n);
+        }
+    }
+
+    std::printf("%-8s %9s %9s %9s %9s\n", "path", "ns float", "ns q15",
+        "snr -6", "snr -40");
+    Row<FilterPath>("aafilter", samples);
+    Row<MixerPath>("mixer", samples);
+    Row<DelayPath>("delay", samples);
+
+    float peak;
+    double snr = WorstCase(&peak);
+    std::printf("\naafilter, worst case full scale input: peak %.2f, "
+        "snr %.1f\n", peak, snr);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+# Host-side tools. These build with the native toolchain and only pull in the
+# hardware-independent parts of the tree (engines, utilities, config), except
+# vdevice, which builds the firmware itself against the stand-in drivers in
+# host/drivers.
+
+HOST_TOOLS := render sweep vdevice bench mathbench delaybench resamplebench \
+    fixedbench
+
+HOST_CXXFLAGS := -ggdb3 -O2 -std=gnu++2a \
+    -Wall -Wextra -Wno-unused-parameter \
+    -ffast-math -fsingle-precision-constant
+
+SUBMAKEFILES := $(addsuffix .mk,$(HOST_TOOLS))
+
+.PHONY: host
+host: $(addprefix $(TARGET_DIR)/,$(HOST_TOOLS))
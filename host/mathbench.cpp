@@ -0,0 +1,246 @@
+// Accuracy and speed check for util/fast_math.h and util/lut.h.
+//
+// Sweeps each approximation over its documented range against libm in
+// double, and fails if the max error exceeds the bound documented in the
+// headers. Then times each one against the float libm expression it
+// replaces.
+// The constexpr path is checked against the runtime path as well, since they
+// do the bit manipulation differently.
+//
+// Usage:
+//   mathbench [options]
+//
+// Options:
+//   -n <points>   Points per accuracy sweep (default 1000000)
+//   -c <calls>    Calls per timing run (default 20000000)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <unistd.h>
+
+#include "util/fast_math.h"
+#include "util/lut.h"
+
+using namespace recorder;
+
+enum ErrorKind
+{
+    ERROR_ABSOLUTE,
+    ERROR_RELATIVE,
+    // Absolute while the result is within +-1, relative beyond
+    ERROR_LOG,
+};
+
+static const char* const kErrorNames[] = {"abs", "rel", "abs/rel"};
+
+struct Function
+{
+    const char* name;
+    float (*fast)(float);
+    float (*libm)(float);
+    double (*exact)(double);
+    // Sweep range; for log-spaced sweeps, as powers of 2
+    double lo, hi;
+    bool log_spaced;
+    ErrorKind kind;
+    // Documented max error
+    double bound;
+};
+
+static const Function kFunctions[] = {
+    {"Exp2", fast::Exp2, [](float x) { return ::exp2f(x); },
+        [](double x) { return std::exp2(x); }, -126, 127, false,
+        ERROR_RELATIVE, 2e-7},
+    {"Log2", fast::Log2, [](float x) { return ::log2f(x); },
+        [](double x) { return std::log2(x); }, -126, 127, true,
+        ERROR_LOG, 5e-7},
+    {"Pow10", fast::Pow10, [](float x) { return ::powf(10, x); },
+        [](double x) { return std::pow(10.0, x); }, -6, 6, false,
+        ERROR_RELATIVE, 1.5e-6},
+    {"Log10", fast::Log10, [](float x) { return ::log10f(x); },
+        [](double x) { return std::log10(x); }, -126, 127, true,
+        ERROR_LOG, 2.5e-7},
+    {"Exp", fast::Exp, [](float x) { return ::expf(x); },
+        [](double x) { return std::exp(x); }, -10, 10, false,
+        ERROR_RELATIVE, 7e-7},
+    {"Exp", fast::Exp, [](float x) { return ::expf(x); },
+        [](double x) { return std::exp(x); }, -80, 80, false,
+        ERROR_RELATIVE, 4e-6},
+    {"Tanh", fast::Tanh, [](float x) { return ::tanhf(x); },
+        [](double x) { return std::tanh(x); }, -20, 20, false,
+        ERROR_ABSOLUTE, 2.5e-7},
+    {"Sin", fast::Sin, [](float x) { return ::sinf(x); },
+        [](double x) { return std::sin(x); }, -2 * M_PI, 2 * M_PI, false,
+        ERROR_ABSOLUTE, 1e-6},
+    {"Cos", fast::Cos, [](float x) { return ::cosf(x); },
+        [](double x) { return std::cos(x); }, -2 * M_PI, 2 * M_PI, false,
+        ERROR_ABSOLUTE, 1e-6},
+    {"Tan", fast::Tan, [](float x) { return ::tanf(x); },
+        [](double x) { return std::tan(x); }, -1.5, 1.5, false,
+        ERROR_RELATIVE, 1e-6},
+    // The tables take turns, or fade positions in [0, 1]
+    {"Sine", lut::Sine, [](float x) { return ::sinf(x * fast::kTwoPi); },
+        [](double x) { return std::sin(x * 2 * M_PI); }, -4, 4, false,
+        ERROR_ABSOLUTE, 2e-5},
+    {"Cosine", lut::Cosine, [](float x) { return ::cosf(x * fast::kTwoPi); },
+        [](double x) { return std::cos(x * 2 * M_PI); }, -4, 4, false,
+        ERROR_ABSOLUTE, 2e-5},
+    {"RCos", lut::RaisedCosine,
+        [](float x) { return 0.5f * (1 - ::cosf(x * (fast::kTwoPi / 2))); },
+        [](double x) { return 0.5 * (1 - std::cos(x * M_PI)); }, 0, 1, false,
+        ERROR_ABSOLUTE, 1e-5},
+    {"EqPow", lut::EqualPower,
+        [](float x) { return ::sinf(x * (fast::kTwoPi / 4)); },
+        [](double x) { return std::sin(x * M_PI / 2); }, 0, 1, false,
+        ERROR_ABSOLUTE, 5e-6},
+};
+
+static float Point(const Function& f, uint32_t i, uint32_t n)
+{
+    double x = f.lo + (f.hi - f.lo) * i / (n - 1);
+    return f.log_spaced ? std::exp2(x) : x;
+}
+
+// Returns the max error over the sweep, and where it was
+static double Sweep(const Function& f, uint32_t n, float& worst)
+{
+    double max_error = 0;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float x = Point(f, i, n);
+        double exact = f.exact(x);
+        double error = std::fabs(f.fast(x) - exact);
+
+        if (f.kind == ERROR_RELATIVE)
+        {
+            error /= std::fabs(exact);
+        }
+        else if (f.kind == ERROR_LOG)
+        {
+            error /= std::max<double>(std::fabs(exact), 1);
+        }
+
+        if (error > max_error)
+        {
+            max_error = error;
+            worst = x;
+        }
+    }
+
+    return max_error;
+}
+
+// Returns nanoseconds per call
+static double Time(const Function& f, float (*function)(float), uint32_t calls)
+{
+    static constexpr uint32_t kPoints = 4096;
+    static float points[kPoints];
+
+    for (uint32_t i = 0; i < kPoints; i++)
+    {
+        points[i] = Point(f, (i * 2654435761u) % kPoints, kPoints);
+    }
+
+    volatile float sink = 0;
+    float sum = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        sum += function(points[i % kPoints]);
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    sink = sum;
+    (void)sink;
+    return elapsed.count() * 1e9 / calls;
+}
+
+// The constant-evaluated results, to compare with the runtime ones
+static constexpr float kInputs[] = {-100.5, -3.25, -0.1, 0.001, 0.7, 1, 2.5, 99};
+static constexpr float kExp2[] = {
+    fast::Exp2(kInputs[0]), fast::Exp2(kInputs[1]), fast::Exp2(kInputs[2]),
+    fast::Exp2(kInputs[3]), fast::Exp2(kInputs[4]), fast::Exp2(kInputs[5]),
+    fast::Exp2(kInputs[6]), fast::Exp2(kInputs[7])};
+static constexpr float kLog2[] = {
+    fast::Log2(kInputs[0]), fast::Log2(kInputs[1]), fast::Log2(kInputs[2]),
+    fast::Log2(kInputs[3]), fast::Log2(kInputs[4]), fast::Log2(kInputs[5]),
+    fast::Log2(kInputs[6]), fast::Log2(kInputs[7])};
+static constexpr float kSin[] = {
+    fast::Sin(kInputs[0]), fast::Sin(kInputs[1]), fast::Sin(kInputs[2]),
+    fast::Sin(kInputs[3]), fast::Sin(kInputs[4]), fast::Sin(kInputs[5]),
+    fast::Sin(kInputs[6]), fast::Sin(kInputs[7])};
+
+static bool CheckConstexpr(void)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < std::size(kInputs); i++)
+    {
+        // Through a volatile, so that these evaluate at run time
+        volatile float x = kInputs[i];
+        ok &= (fast::Exp2(x) == kExp2[i]);
+        ok &= (fast::Log2(x) == kLog2[i]);
+        ok &= (fast::Sin(x) == kSin[i]);
+    }
+
+    std::printf("constexpr and runtime results %s\n", ok ? "match" : "DIFFER");
+    return ok;
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [-n points] [-c calls]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t points = 1000000;
+    uint32_t calls = 20000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': points = std::strtoul(optarg, nullptr, 0); break;
+            case 'c': calls = std::strtoul(optarg, nullptr, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    if (points < 2 || calls == 0)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    bool ok = CheckConstexpr();
+    std::printf("%-6s %-18s %10s %10s %12s %9s %9s\n", "", "range",
+        "max error", "bound", "at", "ns fast", "ns libm");
+
+    for (auto& f : kFunctions)
+    {
+        float worst = 0;
+        double error = Sweep(f, points, worst);
+        double fast_ns = Time(f, f.fast, calls);
+        double libm_ns = Time(f, f.libm, calls);
+        bool pass = error <= f.bound;
+        char range[32];
+        std::snprintf(range, sizeof(range), f.log_spaced ? "2^%g:2^%g" : "%.4g:%.4g",
+            f.lo, f.hi);
+        std::printf("%-6s %-18s %10.3g %10.3g %12.6g %9.2f %9.2f %s%s\n",
+            f.name, range, error, f.bound, worst, fast_ns, libm_ns,
+            kErrorNames[f.kind], pass ? "" : "  FAILED");
+        ok &= pass;
+    }
+
+    return ok ? 0 : 1;
+}
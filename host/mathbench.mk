@@ -0,0 +1,3 @@
+TARGET := mathbench
+SOURCES := mathbench.cpp
+TGT_CXXFLAGS := $(HOST_CXXFLAGS)
@@ -0,0 +1,177 @@
+// Offline renderer for the audio engines.
+//
+// Renders each scenario in host/scenarios.h to a WAV file, or compares fresh
+// renders against a directory of reference WAVs using SNR and peak error
+// tolerances rather than bit-exactness, so that optimisations which change
+// rounding (block processing, approximations, fixed point) can be checked for
+// audible regressions.
+//
+// Usage:
+//   render [options] <dir> [scenario...]
+//
+// Options:
+//   -l            List scenarios and exit
+//   -c            Compare against <dir>/<scenario>.wav instead of writing
+//   -s <dB>       Override the minimum SNR for every scenario
+//   -e <error>    Override the maximum absolute error for every scenario
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unistd.h>
+
+#include "host/scenarios.h"
+#include "host/wav.h"
+
+using namespace recorder;
+
+struct Comparison
+{
+    double snr_db;
+    double max_error;
+    bool length_matches;
+};
+
+static Comparison Compare(const std::vector<float>& ref,
+    const std::vector<float>& test)
+{
+    double signal = 0;
+    double noise = 0;
+    double max_error = 0;
+    size_t length = std::min(ref.size(), test.size());
+
+    for (size_t i = 0; i < length; i++)
+    {
+        double error = double(test[i]) - double(ref[i]);
+        signal += double(ref[i]) * double(ref[i]);
+        noise += error * error;
+        max_error = std::max(max_error, std::fabs(error));
+    }
+
+    double snr_db = (noise == 0) ? INFINITY :
+        (signal == 0) ? -INFINITY : 10 * std::log10(signal / noise);
+
+    return {snr_db, max_error, ref.size() == test.size()};
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-l] [-c] [-s min_snr_db] [-e max_error] <dir> "
+        "[scenario...]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    bool compare = false;
+    float min_snr_db = 0;
+    float max_error = 0;
+    bool override_snr = false;
+    bool override_error = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "lcs:e:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+                for (auto& scenario : kScenarios)
+                {
+                    std::printf("%s\n", scenario.name);
+                }
+                return 0;
+            case 'c': compare = true; break;
+            case 's':
+                min_snr_db = std::atof(optarg);
+                override_snr = true;
+                break;
+            case 'e':
+                max_error = std::atof(optarg);
+                override_error = true;
+                break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    std::string dir = argv[optind++];
+    std::vector<const Scenario*> scenarios;
+
+    for (int i = optind; i < argc; i++)
+    {
+        auto scenario = FindScenario(argv[i]);
+
+        if (scenario == nullptr)
+        {
+            std::fprintf(stderr, "Unknown scenario: %s\n", argv[i]);
+            return 2;
+        }
+
+        scenarios.push_back(scenario);
+    }
+
+    if (scenarios.empty())
+    {
+        for (auto& scenario : kScenarios)
+        {
+            scenarios.push_back(&scenario);
+        }
+    }
+
+    auto rig = std::make_unique<Rig>();
+    int failures = 0;
+
+    for (auto scenario : scenarios)
+    {
+        std::vector<float> out;
+        uint32_t sample_rate = Render(*scenario, *rig, out);
+        std::string path = dir + "/" + scenario->name + ".wav";
+
+        if (!compare)
+        {
+            if (!wav::Write(path.c_str(), out, sample_rate))
+            {
+                std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+                return 1;
+            }
+
+            std::printf("%-24s %s\n", scenario->name, path.c_str());
+            continue;
+        }
+
+        std::vector<float> ref;
+        uint32_t ref_rate;
+
+        if (!wav::Read(path.c_str(), ref, ref_rate))
+        {
+            std::printf("%-24s FAIL  missing reference %s\n",
+                scenario->name, path.c_str());
+            failures++;
+            continue;
+        }
+
+        float snr_limit = override_snr ? min_snr_db : scenario->min_snr_db;
+        float error_limit = override_error ? max_error : scenario->max_error;
+        auto result = Compare(ref, out);
+        bool pass = result.length_matches && ref_rate == sample_rate &&
+            result.snr_db >= snr_limit && result.max_error <= error_limit;
+
+        std::printf("%-24s %s  snr %7.2f dB (min %.1f)  "
+            "max error %.3g (max %.3g)%s\n",
+            scenario->name, pass ? "PASS" : "FAIL",
+            result.snr_db, snr_limit, result.max_error, error_limit,
+            result.length_matches ? "" : "  length mismatch");
+
+        failures += !pass;
+    }
+
+    return failures ? 1 : 0;
+}
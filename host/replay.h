@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "common/io.h"
+#include "common/capture.h"
+
+namespace recorder
+{
+
+// Feeds a recorded input capture (see common/capture.h) back into the
+// simulated board. Frames are applied before the main-loop iteration they
+// were recorded in, and the audio callbacks in between are paced so that the
+// callback count matches the device's at every recorded frame.
+class Replay
+{
+public:
+    bool Load(const char* path)
+    {
+        std::FILE* file = std::fopen(path, "rb");
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        uint8_t buffer[4096];
+        size_t size;
+
+        while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            data.insert(data.end(), buffer, buffer + size);
+        }
+
+        std::fclose(file);
+
+        const uint8_t* p = data.data();
+        const uint8_t* end = p + data.size();
+
+        if ((p = capture::Decoder::Header(p, end)) == nullptr)
+        {
+            std::fprintf(stderr, "%s: not a capture for this build\n", path);
+            return false;
+        }
+
+        capture::Decoder decoder;
+        capture::Frame frame;
+        decoder.Init();
+        frames_.clear();
+
+        while (p < end)
+        {
+            if ((p = decoder.Decode(p, end, frame)) == nullptr)
+            {
+                std::fprintf(stderr, "%s: truncated after %zu frames\n",
+                    path, frames_.size());
+                break;
+            }
+
+            frames_.push_back(frame);
+        }
+
+        Start(true);
+        return true;
+    }
+
+    // Feeds synthesized frames instead. Unless `paced`, their callback
+    // counts are ignored and the board runs at its own rate; Check() then
+    // fills in the counts actually seen, so frames() can be saved as a
+    // capture that replays exactly.
+    void Set(const std::vector<capture::Frame>& frames, bool paced)
+    {
+        frames_ = frames;
+        Start(paced);
+    }
+
+    const std::vector<capture::Frame>& trace(void) const
+    {
+        return frames_;
+    }
+
+    bool done(void) const
+    {
+        return next_ >= frames_.size();
+    }
+
+    uint32_t frames(void) const
+    {
+        return frames_.size();
+    }
+
+    uint32_t divergences(void) const
+    {
+        return divergences_;
+    }
+
+    // Number of callback periods to run before main-loop iteration `loop`,
+    // given that `callbacks` have been serviced so far. Gaps between frames
+    // are spread evenly over the iterations they span.
+    uint32_t Callbacks(uint32_t loop, uint32_t callbacks,
+        uint32_t default_count) const
+    {
+        if (!paced_ || done() || frames_[next_].loop < loop)
+        {
+            return default_count;
+        }
+
+        auto& next = frames_[next_];
+
+        if (next.callback <= callbacks)
+        {
+            return 0;
+        }
+
+        uint32_t remaining = next.callback - callbacks;
+        uint32_t loops = next.loop - loop + 1;
+        return (remaining + loops - 1) / loops;
+    }
+
+    // Applies every frame due at or before `loop`. On the device the pots
+    // reach the main loop through the audio callback, so call this before the
+    // last callback preceding the iteration, then Check() after it.
+    void Apply(uint32_t loop, HumanInput& in)
+    {
+        applied_ = next_;
+
+        while (!done() && frames_[next_].loop <= loop)
+        {
+            auto& frame = frames_[next_++];
+            frame.Write(in);
+            expected_callback_ = frame.callback;
+            pending_check_ = true;
+        }
+    }
+
+    // A frame whose callback count doesn't match means the simulation has
+    // drifted from the device.
+    void Check(uint32_t callbacks)
+    {
+        if (!paced_)
+        {
+            for (uint32_t i = applied_; i < next_; i++)
+            {
+                frames_[i].callback = callbacks;
+            }
+        }
+        else if (pending_check_ && expected_callback_ != callbacks)
+        {
+            divergences_++;
+        }
+
+        pending_check_ = false;
+    }
+
+protected:
+    std::vector<capture::Frame> frames_;
+    bool paced_;
+    uint32_t applied_;
+    uint32_t next_;
+    uint32_t divergences_;
+    uint32_t expected_callback_;
+    bool pending_check_;
+
+    void Start(bool paced)
+    {
+        paced_ = paced;
+        next_ = 0;
+        applied_ = 0;
+        divergences_ = 0;
+        pending_check_ = false;
+    }
+};
+
+}
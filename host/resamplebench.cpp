@@ -0,0 +1,235 @@
+// Cost and alias rejection of the kernels in app/engine/resampling_kernel.h.
+//
+// Runs Resampler's pull side at a range of speeds (input samples per output
+// sample, as SamplePlayer reads the recording), and for each kernel prints:
+//
+//   ns      time per output sample, the best of a few runs
+//   spur    the loudest unwanted output, in dB below a full scale tone
+//
+// The spur figure is the worst over tones across the 6 kHz band that
+// recordings are filtered to at 16 kHz. Each tone should come out at speed
+// times its frequency: what's left once that's fitted away is images and
+// aliases. Tones that land within the kernels' transition band, between
+// 6 kHz and 10 kHz at the output, are skipped, since they alias into the top
+// of the band by design; beyond 10 kHz the output should be silent.
+//
+// Usage:
+//   resamplebench [options]
+//
+// Options:
+//   -n <samples>  Output samples per timed run (default 2000000)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+#include "app/engine/resampler.h"
+
+using namespace recorder;
+
+// Sixteenths, so that the resampler's phase steps are exact and the output
+// tones exactly where the fit expects them
+static constexpr float kSpeeds[] = {0.5, 0.6875, 1.0625, 1.4375, 2};
+
+static constexpr uint32_t kInputSize = 1 << 16;
+static float input_[kInputSize];
+
+// As fractions of the sampling rate
+static constexpr double kPassband = 0.375;
+static constexpr double kStopband = 0.625;
+static constexpr uint32_t kFitLength = 4096;
+static constexpr uint32_t kSettle = 64;
+
+// -fsingle-precision-constant makes M_PI a float
+static const double kPi = std::acos(-1.0);
+
+template <typename Kernel>
+static void Resample(float speed, const float* in, float* out, uint32_t size)
+{
+    static Resampler<1, Kernel> resampler_;
+    resampler_.Init();
+    resampler_.Reset();
+    uint32_t i = 0;
+    resampler_.Pull(out, size, 1 / speed, [&] {
+        return in[i++ % kInputSize];
+    });
+}
+
+// Level of what's left of `x` after removing a sine at `frequency`, in dB
+// relative to a full scale sine. A frequency of 0 removes nothing.
+static double Residual(const float* x, uint32_t size, double frequency)
+{
+    double power = 0;
+
+    if (frequency == 0)
+    {
+        for (uint32_t n = 0; n < size; n++)
+        {
+            power += double(x[n]) * x[n];
+        }
+
+        return 10 * std::log10(std::max<double>(power / size / 0.5, 1e-30));
+    }
+
+    double ss = 0, sc = 0, cc = 0, xs = 0, xc = 0;
+
+    for (uint32_t n = 0; n < size; n++)
+    {
+        double s = std::sin(2 * kPi * frequency * n);
+        double c = std::cos(2 * kPi * frequency * n);
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        xs += x[n] * s;
+        xc += x[n] * c;
+    }
+
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc) / det;
+    double b = (xc * ss - xs * sc) / det;
+
+    for (uint32_t n = 0; n < size; n++)
+    {
+        double e = x[n] - a * std::sin(2 * kPi * frequency * n) -
+            b * std::cos(2 * kPi * frequency * n);
+        power += e * e;
+    }
+
+    return 10 * std::log10(std::max<double>(power / size / 0.5, 1e-30));
+}
+
+// Returns the loudest spur, in dB
+template <typename Kernel>
+static double Spur(float speed)
+{
+    static float tone[kInputSize];
+    static float out[kSettle + kFitLength];
+    // As the resampler works it out from the ratio
+    float ratio = 1 / speed;
+    speed = 1 / ratio;
+    double worst = -300;
+
+    for (double f = 0.01; f <= kPassband; f += 0.004)
+    {
+        double g = f * speed;
+
+        if (g > kPassband && g < kStopband)
+        {
+            continue;
+        }
+
+        for (uint32_t n = 0; n < kInputSize; n++)
+        {
+            tone[n] = std::sin(2 * kPi * f * n);
+        }
+
+        Resample<Kernel>(speed, tone, out, kSettle + kFitLength);
+        // Above the Nyquist frequency, all of it is unwanted
+        double wanted = (g < 0.5) ? g : 0;
+        worst = std::max(worst, Residual(out + kSettle, kFitLength, wanted));
+    }
+
+    return worst;
+}
+
+// Returns nanoseconds per output sample
+template <typename Kernel>
+static double Time(float speed, uint32_t samples)
+{
+    static float out[256];
+    double best = 1e9;
+    float sum = 0;
+
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        Resampler<1, Kernel> resampler;
+        resampler.Init();
+        resampler.Reset();
+        uint32_t i = 0;
+        auto source = [&] {
+            return input_[i++ % kInputSize];
+        };
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t n = 0; n < samples; n += 256)
+        {
+            resampler.Pull(out, 256, 1 / speed, source);
+            sum += out[0];
+        }
+
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() * 1e9 / samples);
+    }
+
+    volatile float sink = sum;
+    (void)sink;
+    return best;
+}
+
+template <typename Kernel>
+static void Row(const char* name, uint32_t samples)
+{
+    std::printf("%-8s", name);
+
+    for (float speed : kSpeeds)
+    {
+        std::printf(" %6.2f %6.1f", Time<Kernel>(speed, samples),
+            Spur<Kernel>(speed));
+    }
+
+    std::printf("\n");
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [-n samples]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t samples = 2000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': samples = std::strtoul(optarg, nullptr, 0); break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    samples -= samples % 256;
+
+    for (uint32_t i = 0; i < kInputSize; i++)
+    {
+        input_[i] = 0.5f * std::sin(i * 0.01f);
+    }
+
+    std::printf("%-8s", "speed");
+
+    for (float speed : kSpeeds)
+    {
+        std::printf(" %13.4f", speed);
+    }
+
+    std::printf("\n%-8s", "kernel");
+
+    for (uint32_t i = 0; i < std::size(kSpeeds); i++)
+    {
+        std::printf(" %6s %6s", "ns", "spur");
+    }
+
+    std::printf("\n");
+
+    Row<LinearKernel>("linear", samples);
+    Row<HermiteKernel>("hermite", samples);
+    Row<SincKernel<8>>("sinc8", samples);
+    Row<SincKernel<16>>("sinc16", samples);
+    return 0;
+}
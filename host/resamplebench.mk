@@ -0,0 +1,5 @@
+TARGET := resamplebench
+SOURCES := resamplebench.cpp
+TGT_CXXFLAGS := $(HOST_CXXFLAGS)
+TGT_DEFS := __fp16=_Float16
+TGT_LDLIBS := -lm
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace recorder
+{
+
+// Host stand-in for SampleMemory: same accessors the engines use, backed by a
+// plain vector instead of the SRAM buffer chain and flash.
+class SampleBuffer
+{
+public:
+    explicit SampleBuffer(uint32_t capacity = 0) : capacity_{capacity} {}
+
+    void StartRecording(void)
+    {
+        samples_.clear();
+    }
+
+    void StartPlayback(void) {}
+
+    const float& operator[](size_t index)
+    {
+        return (index < samples_.size()) ? samples_[index] : dummy_;
+    }
+
+    uint32_t Read(size_t index, float* items, uint32_t length)
+    {
+        if (index >= samples_.size())
+        {
+            return 0;
+        }
+
+        length = std::min<size_t>(length, samples_.size() - index);
+        std::copy_n(&samples_[index], length, items);
+        return length;
+    }
+
+    uint32_t length(void)
+    {
+        return samples_.size();
+    }
+
+    void Append(float item)
+    {
+        if (capacity_ == 0 || samples_.size() < capacity_)
+        {
+            samples_.push_back(item);
+        }
+    }
+
+    void Append(const float* items, uint32_t length)
+    {
+        if (capacity_)
+        {
+            length = std::min<size_t>(length, capacity_ - samples_.size());
+        }
+
+        samples_.insert(samples_.end(), items, items + length);
+    }
+
+    std::vector<float>& samples(void)
+    {
+        return samples_;
+    }
+
+protected:
+    uint32_t capacity_;
+    std::vector<float> samples_;
+    float dummy_ = 0;
+};
+
+}
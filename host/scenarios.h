@@ -0,0 +1,368 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/config.h"
+#include "common/io.h"
+#include "app/engine/synth_engine.h"
+#include "app/engine/jingle_engine.h"
+#include "app/engine/playback_engine.h"
+#include "app/engine/recording_engine.h"
+#include "host/sample_buffer.h"
+
+namespace recorder
+{
+
+enum EngineID
+{
+    ENGINE_SYNTH,
+    ENGINE_JINGLE,
+    ENGINE_PLAYBACK,
+    ENGINE_RECORDING,
+    NUM_ENGINES,
+};
+
+// Everything a control script can move. The mapping onto engine arguments
+// mirrors recorder::Process() in app/main.cpp.
+struct Controls
+{
+    PotInput pot;
+    bool key[4];
+    bool loop;
+};
+
+// Main-loop rate; scripts and strum detection run at this rate just like
+// StateMachine() does on the device.
+constexpr uint32_t kTickRate = 1000;
+constexpr uint32_t kSamplesPerTick = kAudioSampleRate / kTickRate;
+
+using Script = void (*)(uint32_t ms, Controls& controls);
+
+// Tuning for every engine a scenario can run; defaults match the firmware.
+struct Tuning
+{
+    SynthEngine::Tuning synth;
+    DelayEngine::Tuning delay;
+};
+
+struct Scenario
+{
+    const char* name;
+    EngineID engine;
+    float duration;
+    Script script;
+    float min_snr_db;
+    float max_error;
+};
+
+// Drives one engine the same way the firmware does, minus the hardware.
+class Rig
+{
+public:
+    void Init(EngineID engine, const Tuning& tuning = {})
+    {
+        engine_ = engine;
+        last_strum_idx_ = 0;
+        last_chord_idx_ = -1;
+        callbacks_ = 0;
+        controls_.Init();
+
+        for (bool& key : keys_)
+        {
+            key = false;
+        }
+
+        ending_ = false;
+        input_phase_ = 0;
+
+        if (engine_ == ENGINE_SYNTH)
+        {
+            synth_.Init(tuning.synth);
+        }
+        else if (engine_ == ENGINE_JINGLE)
+        {
+            jingle_.Init();
+            jingle_.StartupJingle();
+        }
+        else if (engine_ == ENGINE_PLAYBACK)
+        {
+            FillSource(memory_);
+            playback_.Init(tuning.delay);
+            playback_.Reset();
+            playback_.Play();
+        }
+        else if (engine_ == ENGINE_RECORDING)
+        {
+            memory_.StartRecording();
+            recording_.Init();
+            recording_.Reset();
+        }
+    }
+
+    // Once per main-loop tick. Scripts are exact, so their events apply at
+    // the next callback, without the firmware's kControlDelay.
+    void Tick(const Controls& controls)
+    {
+        if (engine_ == ENGINE_SYNTH)
+        {
+            PostControls(controls);
+        }
+
+        if (engine_ == ENGINE_JINGLE && !jingle_.JingleActive() && !ending_)
+        {
+            ending_ = true;
+            jingle_.EndingJingle();
+        }
+    }
+
+    // Once per audio callback
+    void Process(const Controls& controls, float (&block)[kAudioOSFactor])
+    {
+        for (uint32_t i = 0; i < kAudioOSFactor; i++)
+        {
+            block[i] = 0;
+        }
+
+        if (engine_ == ENGINE_SYNTH)
+        {
+            ControlEvent event;
+
+            while (controls_.Next(callbacks_, event))
+            {
+                synth_.Apply(event);
+            }
+
+            synth_.Process(block, controls.pot[POT_5], controls.pot[POT_1],
+                controls.loop, false, false);
+        }
+        else if (engine_ == ENGINE_JINGLE)
+        {
+            jingle_.Process(block);
+        }
+        else if (engine_ == ENGINE_PLAYBACK)
+        {
+            playback_.Process(block, true, false, controls.pot);
+        }
+        else if (engine_ == ENGINE_RECORDING)
+        {
+            float input[kAudioOSFactor];
+
+            for (uint32_t i = 0; i < kAudioOSFactor; i++)
+            {
+                input[i] = NextInputSample();
+            }
+
+            recording_.Process(input, 1);
+        }
+
+        callbacks_++;
+    }
+
+    SynthEngine& synth(void) { return synth_; }
+    JingleEngine& jingle(void) { return jingle_; }
+    PlaybackEngine<SampleBuffer>& playback(void) { return playback_; }
+    SampleBuffer& memory(void) { return memory_; }
+
+protected:
+    EngineID engine_;
+    SynthEngine synth_;
+    JingleEngine jingle_;
+    SampleBuffer memory_;
+    PlaybackEngine<SampleBuffer> playback_{memory_};
+    RecordingEngine<SampleBuffer> recording_{memory_};
+    ControlQueue controls_;
+    uint32_t callbacks_;
+    bool keys_[4];
+    int last_strum_idx_;
+    int last_chord_idx_;
+    bool ending_;
+    double input_phase_;
+
+    // Queues what changed since the last tick, as main.cpp's StateMachine()
+    void PostControls(const Controls& controls)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            if (controls.key[i] != keys_[i])
+            {
+                keys_[i] = controls.key[i];
+                controls_.Post(keys_[i] ? ControlEvent::TYPE_KEY_ON :
+                    ControlEvent::TYPE_KEY_OFF, i, callbacks_);
+            }
+        }
+
+        // The chord first, so that a strum at the same time strums it
+        int chord_idx = SynthEngine::ChordIndex(controls.pot[POT_5]);
+        if (chord_idx != last_chord_idx_)
+        {
+            controls_.Post(ControlEvent::TYPE_CHORD, chord_idx, callbacks_);
+            last_chord_idx_ = chord_idx;
+        }
+
+        int strum_idx = int(controls.pot[POT_2] * 5.99f);
+        if (strum_idx != last_strum_idx_)
+        {
+            controls_.Post(ControlEvent::TYPE_STRUM, strum_idx, callbacks_);
+            last_strum_idx_ = strum_idx;
+        }
+    }
+
+    // Deterministic source material for the playback engine: a 2 second
+    // phrase of decaying harmonic notes.
+    static void FillSource(SampleBuffer& memory)
+    {
+        static constexpr float kNotes[] = {220.f, 277.18f, 329.63f, 440.f};
+        uint32_t length = 2 * kAudioSampleRate;
+        uint32_t note_length = length / 4;
+        memory.StartRecording();
+
+        for (uint32_t n = 0; n < length; n++)
+        {
+            float f0 = kNotes[n / note_length];
+            float t = float(n % note_length) / kAudioSampleRate;
+            float sample = 0;
+
+            for (uint32_t h = 1; h <= 4; h++)
+            {
+                sample += std::sin(2 * float(M_PI) * f0 * h * t) / h;
+            }
+
+            memory.Append(0.4f * sample * std::exp(-3 * t));
+        }
+    }
+
+    // Oversampled linear chirp from 100 Hz to 4 kHz for the recording engine
+    float NextInputSample(void)
+    {
+        constexpr double kDuration = 2;
+        double t = std::fmod(input_phase_, kDuration);
+        double f = 100 + (4000 - 100) * t / kDuration;
+        input_phase_ += 1.0 / kAudioOSRate;
+        return 0.5 * std::sin(2 * M_PI * f * t / 2);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Control scripts /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+inline float Triangle(uint32_t ms, uint32_t period_ms)
+{
+    float phase = float(ms % period_ms) / period_ms;
+    return phase < 0.5f ? 2 * phase : 2 - 2 * phase;
+}
+
+inline void StrumSweep(uint32_t ms, Controls& c)
+{
+    c.pot[POT_1] = 0.5f;
+    c.pot[POT_2] = Triangle(ms, 2000);
+    c.pot[POT_5] = (ms / 4000) * 0.5f;
+}
+
+inline void ChordChanges(uint32_t ms, Controls& c)
+{
+    uint32_t chord = (ms / 1000) % 8;
+    bool gap = (ms % 1000) >= 900;
+    c.pot[POT_1] = 0.3f;
+    c.pot[POT_5] = (chord + 0.5f) / 8;
+    c.loop = (ms >= 4000);
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        c.key[i] = !gap && (i <= chord % 4);
+    }
+}
+
+inline void HoldSweep(uint32_t ms, Controls& c)
+{
+    c.pot[POT_1] = std::min(1.f, ms / 7000.f);
+    c.pot[POT_2] = Triangle(ms, 1500);
+    c.pot[POT_5] = 0.4f;
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        c.key[i] = ((ms / 500) % 4 == i) && (ms % 500) < 200;
+    }
+}
+
+inline void JingleScript(uint32_t ms, Controls& c) {}
+
+inline void DelayFeedbackRamp(uint32_t ms, Controls& c)
+{
+    c.pot[POT_1] = 0.5f;
+    c.pot[POT_2] = 0.3f;
+    c.pot[POT_3] = std::min(1.f, ms / 6000.f);
+}
+
+inline void PitchKnob(uint32_t ms, Controls& c)
+{
+    c.pot[POT_1] = Triangle(ms, 3000);
+    c.pot[POT_2] = 0.1f;
+    c.pot[POT_3] = 0.2f;
+}
+
+inline void RecordingScript(uint32_t ms, Controls& c) {}
+
+inline const Scenario kScenarios[] =
+{
+    {"synth_strum_sweep",   ENGINE_SYNTH,     8, StrumSweep,        60, 1e-2},
+    {"synth_chords",        ENGINE_SYNTH,     8, ChordChanges,      60, 1e-2},
+    {"synth_hold_sweep",    ENGINE_SYNTH,     8, HoldSweep,         60, 1e-2},
+    {"jingle",              ENGINE_JINGLE,    3, JingleScript,      60, 1e-2},
+    {"playback_delay_ramp", ENGINE_PLAYBACK,  8, DelayFeedbackRamp, 50, 2e-2},
+    {"playback_pitch",      ENGINE_PLAYBACK,  6, PitchKnob,         50, 2e-2},
+    {"recording",           ENGINE_RECORDING, 2, RecordingScript,   60, 1e-2},
+};
+
+inline const Scenario* FindScenario(const char* name)
+{
+    for (auto& scenario : kScenarios)
+    {
+        if (!std::strcmp(scenario.name, name))
+        {
+            return &scenario;
+        }
+    }
+
+    return nullptr;
+}
+
+// Renders a scenario at the oversampled output rate (or, for the recording
+// engine, returns what was written to sample memory at the base rate).
+inline uint32_t Render(const Scenario& scenario, Rig& rig,
+    std::vector<float>& out, const Tuning& tuning = {})
+{
+    Controls controls = {};
+    uint32_t num_ticks = scenario.duration * kTickRate;
+    out.clear();
+    out.reserve(num_ticks * kSamplesPerTick * kAudioOSFactor);
+    rig.Init(scenario.engine, tuning);
+
+    for (uint32_t ms = 0; ms < num_ticks; ms++)
+    {
+        scenario.script(ms, controls);
+        rig.Tick(controls);
+
+        for (uint32_t n = 0; n < kSamplesPerTick; n++)
+        {
+            float block[kAudioOSFactor];
+            rig.Process(controls, block);
+            out.insert(out.end(), block, block + kAudioOSFactor);
+        }
+    }
+
+    if (scenario.engine == ENGINE_RECORDING)
+    {
+        out = rig.memory().samples();
+        return kAudioSampleRate;
+    }
+
+    return kAudioOSRate;
+}
+
+}
@@ -0,0 +1,482 @@
+#include "host/stress.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "common/config.h"
+
+namespace recorder::stress
+{
+
+// Input state for every main-loop iteration of a trial
+using Trace = std::vector<capture::Frame>;
+
+static bool trial_;
+static int result_fd_ = -1;
+
+bool trial(void)
+{
+    return trial_;
+}
+
+// Random walk over the controls, one main-loop iteration at a time. The
+// rates favour what loads the audio callback: strums landing on a new
+// position every few milliseconds, chords held on several keys, the hold pot
+// at full sustain and the delay feedback at its extremes.
+class Generator
+{
+public:
+    explicit Generator(uint32_t seed) : rng_{seed} {}
+
+    void Step(capture::Frame& frame)
+    {
+        static constexpr SwitchID kKeys[] =
+        {
+            SWITCH_KEY_1, SWITCH_KEY_2, SWITCH_KEY_3, SWITCH_PLAY,
+        };
+
+        for (auto key : kKeys)
+        {
+            Toggle(frame, key, 0.01f);
+        }
+
+        Toggle(frame, SWITCH_LOOP, 0.002f);
+        Toggle(frame, SWITCH_RECORD, 0.001f);
+
+        if (Chance(0.1f))
+        {
+            frame.pot[POT_2] = Uniform();
+        }
+
+        if (Chance(0.01f))
+        {
+            frame.pot[POT_5] = Uniform();
+        }
+
+        if (Chance(0.005f))
+        {
+            frame.pot[POT_1] = Chance(0.5f) ? 1 : Uniform();
+        }
+
+        for (auto pot : {POT_3, POT_4, POT_6, POT_7})
+        {
+            if (Chance(0.005f))
+            {
+                frame.pot[pot] = Chance(0.3f) ? Chance(0.5f) : Uniform();
+            }
+        }
+    }
+
+    Trace Random(uint32_t duration_ms)
+    {
+        capture::Frame frame = {};
+        Trace trace;
+
+        for (uint32_t i = 0; i < duration_ms; i++)
+        {
+            Step(frame);
+            frame.loop = i + 1;
+            trace.push_back(frame);
+        }
+
+        return trace;
+    }
+
+    // Regenerates a window of a trace, continuing from the state before it
+    Trace Mutate(const Trace& trace)
+    {
+        Trace mutant = trace;
+        uint32_t length = std::min<uint32_t>(trace.size(),
+            10 + std::exponential_distribution<float>(1 / 200.f)(rng_));
+        uint32_t start = std::uniform_int_distribution<uint32_t>(
+            0, trace.size() - length)(rng_);
+        capture::Frame frame = mutant[start];
+
+        for (uint32_t i = start; i < start + length; i++)
+        {
+            Step(frame);
+            frame.loop = mutant[i].loop;
+            mutant[i] = frame;
+        }
+
+        return mutant;
+    }
+
+    bool Chance(float p)
+    {
+        return std::uniform_real_distribution<float>()(rng_) < p;
+    }
+
+protected:
+    std::mt19937 rng_;
+
+    float Uniform(void)
+    {
+        return std::uniform_real_distribution<float>()(rng_);
+    }
+
+    void Toggle(capture::Frame& frame, SwitchID sw, float p)
+    {
+        if (Chance(p))
+        {
+            frame.sw ^= 1 << sw;
+        }
+    }
+};
+
+// Only the frames where an input changed, as a capture would hold them
+static std::vector<capture::Frame> Changes(const Trace& trace)
+{
+    std::vector<capture::Frame> frames;
+
+    for (uint32_t i = 0; i < trace.size(); i++)
+    {
+        auto& frame = trace[i];
+
+        if (i == 0 || frame.sw != trace[i - 1].sw ||
+            frame.detect != trace[i - 1].detect ||
+            frame.pot != trace[i - 1].pot)
+        {
+            frames.push_back(frame);
+        }
+    }
+
+    return frames;
+}
+
+struct Result
+{
+    std::vector<board::CallbackTime> times;
+    std::vector<capture::Frame> frames;
+    uint32_t worst;
+
+    uint32_t worst_ns(void) const
+    {
+        return times.empty() ? 0 : times[worst].ns;
+    }
+};
+
+static bool WriteAll(int fd, const void* data, size_t size)
+{
+    auto p = static_cast<const uint8_t*>(data);
+
+    while (size)
+    {
+        ssize_t written = write(fd, p, size);
+
+        if (written <= 0)
+        {
+            return false;
+        }
+
+        p += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+template <typename T>
+static bool WriteVector(int fd, const std::vector<T>& v)
+{
+    uint32_t size = v.size();
+    return WriteAll(fd, &size, sizeof(size)) &&
+        WriteAll(fd, v.data(), size * sizeof(T));
+}
+
+template <typename T>
+static const uint8_t* ReadVector(const uint8_t* p, const uint8_t* end,
+    std::vector<T>& v)
+{
+    uint32_t size;
+
+    if (p == nullptr || end - p < int32_t(sizeof(size)))
+    {
+        return nullptr;
+    }
+
+    std::copy(p, p + sizeof(size), reinterpret_cast<uint8_t*>(&size));
+    p += sizeof(size);
+
+    if (size_t(end - p) < size * sizeof(T))
+    {
+        return nullptr;
+    }
+
+    v.resize(size);
+    std::copy(p, p + size * sizeof(T), reinterpret_cast<uint8_t*>(v.data()));
+    return p + size * sizeof(T);
+}
+
+void FinishTrial(const std::vector<board::CallbackTime>& times,
+    const std::vector<capture::Frame>& frames)
+{
+    bool ok = WriteVector(result_fd_, times) && WriteVector(result_fd_, frames);
+    _exit(ok ? 0 : 1);
+}
+
+// Forks a trial process. Returns true in the child.
+static bool Fork(int& read_fd, pid_t& pid)
+{
+    int fds[2];
+
+    if (pipe(fds) || (pid = fork()) < 0)
+    {
+        std::perror("Can't start a trial");
+        std::exit(1);
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        result_fd_ = fds[1];
+        trial_ = true;
+
+        // The firmware's serial output goes nowhere
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+        return true;
+    }
+
+    close(fds[1]);
+    read_fd = fds[0];
+    return false;
+}
+
+static bool Collect(int fd, pid_t pid, Result& result)
+{
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    ssize_t size;
+
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + size);
+    }
+
+    close(fd);
+    int status;
+    waitpid(pid, &status, 0);
+
+    const uint8_t* end = data.data() + data.size();
+    const uint8_t* p = ReadVector(data.data(), end, result.times);
+    p = ReadVector(p, end, result.frames);
+
+    if (p == nullptr || !WIFEXITED(status) || WEXITSTATUS(status))
+    {
+        std::fprintf(stderr, "Trial failed\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Keeps each callback's fastest time over the repeats of a trial
+static void Merge(Result& result, const Result& repeat)
+{
+    if (repeat.times.size() != result.times.size())
+    {
+        std::fprintf(stderr, "Trial repeat diverged (%zu vs %zu callbacks)\n",
+            repeat.times.size(), result.times.size());
+        result.times.resize(std::min(result.times.size(),
+            repeat.times.size()));
+    }
+
+    for (uint32_t i = 0; i < result.times.size(); i++)
+    {
+        auto& t = result.times[i];
+        t.ns = std::min(t.ns, repeat.times[i].ns);
+        t.section_ns = std::min(t.section_ns, repeat.times[i].section_ns);
+    }
+}
+
+static void FindWorst(Result& result)
+{
+    result.worst = 0;
+
+    for (uint32_t i = 0; i < result.times.size(); i++)
+    {
+        if (result.times[i].ns > result.times[result.worst].ns)
+        {
+            result.worst = i;
+        }
+    }
+}
+
+static bool WriteTrace(const char* path,
+    const std::vector<capture::Frame>& frames)
+{
+    std::FILE* file = std::fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t record[capture::kMaxRecordSize];
+    capture::Encoder encoder;
+    encoder.Init();
+    std::fwrite(record, 1, capture::Encoder::Header(record), file);
+
+    for (auto& frame : frames)
+    {
+        std::fwrite(record, 1, encoder.Encode(frame, record), file);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+static void Report(const Options& options, const Result& best)
+{
+    constexpr float kPeriod_us = 1e6 / kAudioSampleRate;
+
+    if (best.times.empty())
+    {
+        std::fprintf(stderr, "No audio callbacks ran\n");
+        return;
+    }
+
+    auto& worst = best.times[best.worst];
+    std::fprintf(stderr,
+        "\nSlowest callback: %.2f us (host), %.0f%% of the %.1f us period\n"
+        "  callback %u, main-loop iteration %u\n"
+        "  %-10s %8.2f us\n"
+        "  %-10s %8.2f us\n",
+        worst.ns / 1e3, 100 * worst.ns / 1e3 / kPeriod_us, kPeriod_us,
+        unsigned(best.worst + 1), unsigned(worst.loop),
+        board::section_name(worst.section), worst.section_ns / 1e3,
+        "other", (worst.ns - worst.section_ns) / 1e3);
+
+    std::fprintf(stderr, "Slowest callback of the trace by engine:\n");
+
+    for (uint32_t section = 0; section < board::NUM_SECTIONS; section++)
+    {
+        uint32_t count = 0;
+        uint32_t max_ns = 0;
+        uint32_t max_section_ns = 0;
+
+        for (auto& t : best.times)
+        {
+            if (t.section == section)
+            {
+                count++;
+                max_ns = std::max(max_ns, t.ns);
+                max_section_ns = std::max(max_section_ns, t.section_ns);
+            }
+        }
+
+        if (count)
+        {
+            std::fprintf(stderr, "  %-10s %8u callbacks, max %.2f us "
+                "(engine %.2f us)\n", board::section_name(section),
+                unsigned(count), max_ns / 1e3, max_section_ns / 1e3);
+        }
+    }
+
+    // The inputs in effect at the slowest callback
+    const capture::Frame* state = nullptr;
+
+    for (auto& frame : best.frames)
+    {
+        if (frame.loop <= worst.loop)
+        {
+            state = &frame;
+        }
+    }
+
+    if (state)
+    {
+        std::fprintf(stderr, "Inputs at that point: switches ");
+
+        for (uint32_t i = 0; i < NUM_SWITCHES; i++)
+        {
+            std::fputc((state->sw >> i) & 1 ? '1' : '0', stderr);
+        }
+
+        std::fprintf(stderr, ", pots");
+
+        for (uint32_t i = 0; i < NUM_POTS; i++)
+        {
+            std::fprintf(stderr, " %.3f", state->pot[i]);
+        }
+
+        std::fprintf(stderr, "\n");
+    }
+
+    if (options.trace_path)
+    {
+        if (WriteTrace(options.trace_path, best.frames))
+        {
+            std::fprintf(stderr, "Trace written to %s\n", options.trace_path);
+        }
+        else
+        {
+            std::fprintf(stderr, "Can't write %s\n", options.trace_path);
+        }
+    }
+}
+
+std::vector<capture::Frame> Search(const Options& options)
+{
+    Generator generator(options.seed);
+    Trace best_trace;
+    Result best = {};
+
+    for (uint32_t i = 0; i < options.trials; i++)
+    {
+        Trace trace = (best_trace.empty() || generator.Chance(0.25f)) ?
+            generator.Random(options.duration_ms) :
+            generator.Mutate(best_trace);
+        Result result = {};
+        bool ok = true;
+
+        for (uint32_t r = 0; r < options.repeats && ok; r++)
+        {
+            int fd;
+            pid_t pid;
+
+            if (Fork(fd, pid))
+            {
+                return Changes(trace);
+            }
+
+            Result repeat;
+            ok = Collect(fd, pid, (r == 0) ? result : repeat);
+
+            if (ok && r > 0)
+            {
+                Merge(result, repeat);
+            }
+        }
+
+        if (!ok)
+        {
+            continue;
+        }
+
+        FindWorst(result);
+
+        if (result.worst_ns() > best.worst_ns())
+        {
+            auto& worst = result.times[result.worst];
+            std::fprintf(stderr, "Trial %u: %.2f us at callback %u "
+                "(loop %u, %s)\n", unsigned(i), worst.ns / 1e3,
+                unsigned(result.worst + 1), unsigned(worst.loop),
+                board::section_name(worst.section));
+            best = std::move(result);
+            best_trace = std::move(trace);
+        }
+    }
+
+    Report(options, best);
+    std::exit(0);
+}
+
+}
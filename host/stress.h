@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/capture.h"
+#include "host/board.h"
+
+namespace recorder::stress
+{
+
+// Worst-case execution time search for the audio callback.
+//
+// Each trial runs the firmware from reset against a synthesized input trace
+// (key presses, strums, chord changes, pot jumps, record and play) and times
+// every audio callback, including the engine section it spent its time in.
+// Trials run in forked processes so each starts from a clean firmware state,
+// and each is repeated, keeping every callback's fastest time so that host
+// scheduling noise doesn't masquerade as a slow input. Traces are either
+// fresh random ones or mutations of a window of the slowest trace so far.
+//
+// The slowest trace is saved as an input capture, so it replays with
+// `vdevice -r trace -p profile.csv`.
+struct Options
+{
+    uint32_t trials = 0;
+    uint32_t duration_ms = 5000;
+    uint32_t repeats = 3;
+    uint32_t seed = 1;
+    const char* trace_path = nullptr;
+};
+
+// Runs the search and exits with the report. Returns only in a trial
+// process, with the frames it should replay.
+std::vector<capture::Frame> Search(const Options& options);
+
+// True in a trial process
+bool trial(void);
+
+// Hands a trial's results back to the search; the frames carry the callback
+// counts they were applied at.
+[[noreturn]] void FinishTrial(const std::vector<board::CallbackTime>& times,
+    const std::vector<capture::Frame>& frames);
+
+}
@@ -0,0 +1,353 @@
+// Parameter sweep for engine tuning constants.
+//
+// Renders a scenario from host/scenarios.h once for every point of a
+// Cartesian grid over the fields of Tuning, spreading the jobs over a pool of
+// threads that each own an engine rig, and prints one CSV row of metrics per
+// job: peak, RMS, clipped samples, and the CPU time the render took.
+//
+// Usage:
+//   sweep [options] <scenario> <param>=<values> [<param>=<values>...]
+//
+// Values are a comma-separated list (0.1,0.2,0.5) or a range (start:stop:step,
+// stop inclusive).
+//
+// Options:
+//   -l            List parameters and their defaults, then exit
+//   -j <jobs>     Worker threads (default: one per core)
+//   -o <file>     Write the CSV to a file instead of stdout
+//   -w <dir>      Also write each render to <dir>/<scenario>_<job>.wav
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "host/scenarios.h"
+#include "host/wav.h"
+
+using namespace recorder;
+
+struct Parameter
+{
+    const char* name;
+    float& (*field)(Tuning& tuning);
+};
+
+#define PARAMETER(name, member) \
+    {name, [](Tuning& t) -> float& { return t.member; }}
+
+static const Parameter kParameters[] =
+{
+    PARAMETER("synth.strum_min_rel_time", synth.strum_min_rel_time),
+    PARAMETER("synth.strum_max_rel_time", synth.strum_max_rel_time),
+    PARAMETER("synth.attenuation0", synth.attenuation_levels[0]),
+    PARAMETER("synth.attenuation1", synth.attenuation_levels[1]),
+    PARAMETER("synth.attenuation2", synth.attenuation_levels[2]),
+    PARAMETER("synth.attenuation3", synth.attenuation_levels[3]),
+    PARAMETER("synth.attenuation4", synth.attenuation_levels[4]),
+    PARAMETER("synth.comp_threshold", synth.comp_threshold),
+    PARAMETER("synth.comp_release_time", synth.comp_release_time),
+    PARAMETER("delay.threshold_dB", delay.threshold_dB),
+    PARAMETER("delay.ratio", delay.ratio),
+    PARAMETER("delay.softness", delay.softness),
+    PARAMETER("delay.attack_ms", delay.attack_ms),
+    PARAMETER("delay.decay_ms", delay.decay_ms),
+    PARAMETER("delay.hold_ms", delay.hold_ms),
+};
+
+#undef PARAMETER
+
+struct Axis
+{
+    const Parameter* parameter;
+    std::vector<float> values;
+};
+
+struct Metrics
+{
+    float peak;
+    float rms;
+    uint32_t clipped;
+    double cpu_ms;
+};
+
+static const Parameter* FindParameter(const std::string& name)
+{
+    for (auto& parameter : kParameters)
+    {
+        if (name == parameter.name)
+        {
+            return &parameter;
+        }
+    }
+
+    return nullptr;
+}
+
+// Parses "name=a,b,c" or "name=start:stop:step"
+static bool ParseAxis(const char* arg, Axis& axis)
+{
+    const char* equals = std::strchr(arg, '=');
+
+    if (equals == nullptr ||
+        (axis.parameter = FindParameter(std::string(arg, equals))) == nullptr)
+    {
+        return false;
+    }
+
+    const char* values = equals + 1;
+    float start, stop, step;
+    int consumed = 0;
+
+    if (std::sscanf(values, "%f:%f:%f%n", &start, &stop, &step, &consumed) == 3
+        && values[consumed] == '\0')
+    {
+        if (step <= 0 || stop < start)
+        {
+            return false;
+        }
+
+        // Stepping by index keeps the end point despite rounding
+        uint32_t count = std::floor((stop - start) / step + 1e-3f) + 1;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            axis.values.push_back(start + i * step);
+        }
+
+        return true;
+    }
+
+    for (const char* p = values; *p; )
+    {
+        char* end;
+        axis.values.push_back(std::strtof(p, &end));
+
+        if (end == p || (*end != ',' && *end != '\0'))
+        {
+            return false;
+        }
+
+        p = *end ? end + 1 : end;
+    }
+
+    return !axis.values.empty();
+}
+
+// Mixed-radix decomposition of the job index, first axis varying slowest
+static Tuning JobTuning(const std::vector<Axis>& axes, uint32_t job)
+{
+    Tuning tuning;
+
+    for (auto axis = axes.rbegin(); axis != axes.rend(); axis++)
+    {
+        uint32_t size = axis->values.size();
+        axis->parameter->field(tuning) = axis->values[job % size];
+        job /= size;
+    }
+
+    return tuning;
+}
+
+static double ThreadCpuTime_ms(void)
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static Metrics Measure(const std::vector<float>& out, double cpu_ms)
+{
+    Metrics metrics = {0, 0, 0, cpu_ms};
+    double sum = 0;
+
+    for (float sample : out)
+    {
+        float level = std::fabs(sample);
+        metrics.peak = std::max(metrics.peak, level);
+        metrics.clipped += (level >= 1);
+        sum += double(sample) * sample;
+    }
+
+    metrics.rms = out.empty() ? 0 : std::sqrt(sum / out.size());
+    return metrics;
+}
+
+static void Usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-l] [-j jobs] [-o file.csv] [-w dir] <scenario> "
+        "<param>=<v1,v2,...|start:stop:step>...\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* csv_path = nullptr;
+    const char* wav_dir = nullptr;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "lj:o:w:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+            {
+                Tuning defaults;
+
+                for (auto& parameter : kParameters)
+                {
+                    std::printf("%-28s %g\n", parameter.name,
+                        parameter.field(defaults));
+                }
+
+                return 0;
+            }
+            case 'j': num_threads = std::max(1, std::atoi(optarg)); break;
+            case 'o': csv_path = optarg; break;
+            case 'w': wav_dir = optarg; break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    if (argc - optind < 2)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    const Scenario* scenario = FindScenario(argv[optind]);
+
+    if (scenario == nullptr)
+    {
+        std::fprintf(stderr, "Unknown scenario: %s\n", argv[optind]);
+        return 2;
+    }
+
+    std::vector<Axis> axes;
+    uint32_t num_jobs = 1;
+
+    for (int i = optind + 1; i < argc; i++)
+    {
+        Axis axis;
+
+        if (!ParseAxis(argv[i], axis))
+        {
+            std::fprintf(stderr, "Bad parameter (see -l): %s\n", argv[i]);
+            return 2;
+        }
+
+        num_jobs *= axis.values.size();
+        axes.push_back(std::move(axis));
+    }
+
+    std::FILE* csv = csv_path ? std::fopen(csv_path, "w") : stdout;
+
+    if (csv == nullptr)
+    {
+        std::fprintf(stderr, "Can't open %s\n", csv_path);
+        return 1;
+    }
+
+    // Jobs are handed out one at a time from a shared counter, so threads
+    // that draw cheap grid points simply take more of them.
+    std::vector<Metrics> results(num_jobs);
+    std::atomic<uint32_t> next_job{0};
+    std::atomic<uint32_t> failures{0};
+    num_threads = std::min(num_threads, num_jobs);
+
+    auto worker = [&]()
+    {
+        auto rig = std::make_unique<Rig>();
+        std::vector<float> out;
+        uint32_t job;
+
+        while ((job = next_job.fetch_add(1, std::memory_order_relaxed)) <
+            num_jobs)
+        {
+            double start = ThreadCpuTime_ms();
+            uint32_t sample_rate =
+                Render(*scenario, *rig, out, JobTuning(axes, job));
+            results[job] = Measure(out, ThreadCpuTime_ms() - start);
+
+            if (wav_dir)
+            {
+                std::string path = std::string(wav_dir) + "/" +
+                    scenario->name + "_" + std::to_string(job) + ".wav";
+
+                if (!wav::Write(path.c_str(), out, sample_rate))
+                {
+                    std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+                    failures++;
+                }
+            }
+        }
+    };
+
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start).count();
+
+    std::fprintf(csv, "job");
+
+    for (auto& axis : axes)
+    {
+        std::fprintf(csv, ",%s", axis.parameter->name);
+    }
+
+    std::fprintf(csv, ",peak,rms_dB,clipped,cpu_ms\n");
+
+    for (uint32_t job = 0; job < num_jobs; job++)
+    {
+        Tuning tuning = JobTuning(axes, job);
+        auto& m = results[job];
+        std::fprintf(csv, "%u", unsigned(job));
+
+        for (auto& axis : axes)
+        {
+            std::fprintf(csv, ",%g", axis.parameter->field(tuning));
+        }
+
+        std::fprintf(csv, ",%.6f,%.2f,%u,%.2f\n", m.peak,
+            20 * std::log10(std::max(m.rms, 1e-10f)), unsigned(m.clipped),
+            m.cpu_ms);
+    }
+
+    if (csv != stdout)
+    {
+        std::fclose(csv);
+    }
+
+    double cpu_s = 0;
+
+    for (auto& m : results)
+    {
+        cpu_s += m.cpu_ms / 1e3;
+    }
+
+    std::fprintf(stderr, "%u jobs on %u threads in %.2f s "
+        "(%.2f s CPU, %.1fx parallel speedup)\n", unsigned(num_jobs),
+        unsigned(num_threads), wall_s, cpu_s, cpu_s / wall_s);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,207 @@
+#include "host/trace.h"
+
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "drivers/profiling.h"
+
+namespace recorder::trace
+{
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t kRingSize = 1 << 21;
+
+static constexpr const char* kProfileNames[] =
+{
+    "MAIN",
+    "MAIN_LOOP",
+    "FLASH_READ",
+    "FLASH_WRITE",
+    "FLASH_ERASE",
+    "FLASH_ACCESS",
+    "SERIAL_IRQ",
+    "SERIAL_RX",
+    "SERIAL_TX",
+    "SERIAL_TX_FIFO_PUSH",
+    "SERIAL_TX_FIFO_POP",
+    "AUDIO_SAMPLING",
+    "POT_SAMPLING",
+    "POT_EOS",
+    "ADC_DMA_SERVICE",
+    "DAC_DMA_SERVICE",
+    "TICK",
+    "SLEEP",
+    "STANDBY",
+    "WATCHDOG",
+    "SYSTEM_INIT",
+    "PROCESS",
+    "SYNTH",
+    "JINGLE",
+    "PLAYBACK",
+    "RECORDING",
+    "DUMMY0",
+    "DUMMY1",
+    "DUMMY2",
+    "DUMMY3",
+    "DUMMY4",
+};
+
+static_assert(std::size(kProfileNames) == NUM_PROFILES,
+    "kProfileNames must follow the Profile enum");
+
+static constexpr const char* kTrackNames[NUM_TRACKS] =
+{
+    "main loop", "audio callback",
+};
+
+struct Event
+{
+    uint64_t ns;
+    uint8_t profile;
+    uint8_t track;
+    char phase;
+};
+
+struct Ring
+{
+    uint32_t thread;
+    Track track = TRACK_MAIN;
+    std::unique_ptr<Event[]> events{new Event[kRingSize]};
+    std::atomic<uint64_t> head{0};
+};
+
+static std::atomic<bool> enabled_;
+static Clock::time_point start_time_;
+static std::mutex rings_mutex_;
+static std::vector<std::unique_ptr<Ring>> rings_;
+static thread_local Ring* ring_;
+
+static Ring& ThreadRing(void)
+{
+    if (ring_ == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::make_unique<Ring>());
+        ring_ = rings_.back().get();
+        ring_->thread = rings_.size() - 1;
+    }
+
+    return *ring_;
+}
+
+static void Record(uint32_t profile, char phase)
+{
+    if (!enabled_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    auto& ring = ThreadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % kRingSize] =
+    {
+        uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start_time_).count()),
+        uint8_t(profile),
+        uint8_t(ring.track),
+        phase,
+    };
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Start(void)
+{
+    start_time_ = Clock::now();
+    enabled_ = true;
+}
+
+bool enabled(void)
+{
+    return enabled_;
+}
+
+void SetTrack(Track track)
+{
+    if (enabled_.load(std::memory_order_relaxed))
+    {
+        ThreadRing().track = track;
+    }
+}
+
+void Begin(uint32_t profile)
+{
+    Record(profile, 'B');
+}
+
+void End(uint32_t profile)
+{
+    Record(profile, 'E');
+}
+
+void Instant(uint32_t profile)
+{
+    Record(profile, 'i');
+}
+
+bool Write(const char* path)
+{
+    std::FILE* file = std::fopen(path, "w");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    const char* separator = "\n";
+    uint64_t lost = 0;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (auto& ring : rings_)
+    {
+        for (uint32_t track = 0; track < NUM_TRACKS; track++)
+        {
+            std::fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"name\":\"thread_name\",\"args\":{\"name\":\"%s %u\"}}",
+                separator, unsigned(ring->thread * NUM_TRACKS + track),
+                kTrackNames[track], unsigned(ring->thread));
+            separator = ",\n";
+        }
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = (head > kRingSize) ? head - kRingSize : 0;
+        lost += tail;
+
+        for (uint64_t i = tail; i < head; i++)
+        {
+            auto& event = ring->events[i % kRingSize];
+            const char* name = (event.profile < NUM_PROFILES) ?
+                kProfileNames[event.profile] : "?";
+
+            std::fprintf(file, "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,"
+                "\"ts\":%llu.%03u,\"name\":\"%s\"%s}", separator, event.phase,
+                unsigned(ring->thread * NUM_TRACKS + event.track),
+                static_cast<unsigned long long>(event.ns / 1000),
+                unsigned(event.ns % 1000), name,
+                (event.phase == 'i') ? ",\"s\":\"t\"" : "");
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+
+    if (lost)
+    {
+        std::fprintf(stderr, "Trace: %llu oldest events were overwritten\n",
+            static_cast<unsigned long long>(lost));
+    }
+
+    return std::fclose(file) == 0;
+}
+
+}
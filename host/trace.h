@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace recorder::trace
+{
+
+// Timeline of the profiling pins in the virtual device, written as a Chrome
+// trace (JSON, opened by chrome://tracing and ui.perfetto.dev).
+//
+// Every pin of the firmware reports to Begin()/End() (see
+// host/drivers/profiling.h). Events go into a fixed ring buffer per thread,
+// written only by its thread, so recording takes no locks and allocates
+// nothing after the first event; when a ring fills up the oldest events are
+// overwritten. Events land on the track of the context they ran in, so the
+// audio callbacks show up apart from the main loop they interrupt.
+
+enum Track
+{
+    TRACK_MAIN,
+    TRACK_AUDIO,
+    NUM_TRACKS,
+};
+
+// Starts recording; until then every call below returns at once
+void Start(void);
+bool enabled(void);
+
+// Context of the calling thread's subsequent events
+void SetTrack(Track track);
+
+void Begin(uint32_t profile);
+void End(uint32_t profile);
+void Instant(uint32_t profile);
+
+// Writes all threads' events; call once the other threads have stopped
+bool Write(const char* path);
+
+}
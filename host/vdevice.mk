@@ -0,0 +1,15 @@
+# Virtual device: the firmware's main loop built against the simulated board.
+# Quoted includes of "drivers/..." resolve to the stand-ins in host/drivers
+# first, and __fp16 (an ARM extension) maps to the native half type.
+TARGET := vdevice
+SOURCES := \
+	board.cpp \
+	stress.cpp \
+	trace.cpp \
+	drivers/analog.cpp \
+	drivers/flash.cpp \
+	drivers/system.cpp \
+	../app/main.cpp
+TGT_CXXFLAGS := $(HOST_CXXFLAGS) -iquote host
+TGT_DEFS := __fp16=_Float16
+TGT_LDLIBS := -lm -lpthread
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace wav
+{
+
+// Minimal RIFF/WAVE support for mono files. Writes 32-bit float; reads 32-bit
+// float or 16-bit PCM.
+
+inline bool Write(const char* path, const std::vector<float>& samples,
+    uint32_t sample_rate)
+{
+    std::FILE* file = std::fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t data_size = samples.size() * sizeof(float);
+
+    struct __attribute__ ((packed))
+    {
+        char riff[4];
+        uint32_t riff_size;
+        char wave[4];
+        char fmt[4];
+        uint32_t fmt_size;
+        uint16_t format;
+        uint16_t channels;
+        uint32_t sample_rate;
+        uint32_t byte_rate;
+        uint16_t block_align;
+        uint16_t bits_per_sample;
+        char data[4];
+        uint32_t data_size;
+    } header =
+    {
+        {'R', 'I', 'F', 'F'},
+        36 + data_size,
+        {'W', 'A', 'V', 'E'},
+        {'f', 'm', 't', ' '},
+        16,
+        3,
+        1,
+        sample_rate,
+        sample_rate * uint32_t(sizeof(float)),
+        sizeof(float),
+        32,
+        {'d', 'a', 't', 'a'},
+        data_size,
+    };
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(samples.data(), sizeof(float), samples.size(), file)
+        == samples.size();
+    std::fclose(file);
+    return ok;
+}
+
+inline bool Read(const char* path, std::vector<float>& samples,
+    uint32_t& sample_rate)
+{
+    std::FILE* file = std::fopen(path, "rb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    char id[4];
+    uint32_t size;
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    bool ok = false;
+
+    if (std::fread(id, 4, 1, file) != 1 || std::memcmp(id, "RIFF", 4) ||
+        std::fread(&size, 4, 1, file) != 1 ||
+        std::fread(id, 4, 1, file) != 1 || std::memcmp(id, "WAVE", 4))
+    {
+        std::fclose(file);
+        return false;
+    }
+
+    while (std::fread(id, 4, 1, file) == 1 &&
+           std::fread(&size, 4, 1, file) == 1)
+    {
+        if (!std::memcmp(id, "fmt ", 4))
+        {
+            uint8_t fmt[16];
+
+            if (size < sizeof(fmt) || std::fread(fmt, sizeof(fmt), 1, file) != 1)
+            {
+                break;
+            }
+
+            std::memcpy(&format, fmt + 0, 2);
+            std::memcpy(&channels, fmt + 2, 2);
+            std::memcpy(&sample_rate, fmt + 4, 4);
+            std::memcpy(&bits, fmt + 14, 2);
+            std::fseek(file, size - sizeof(fmt), SEEK_CUR);
+        }
+        else if (!std::memcmp(id, "data", 4))
+        {
+            if (channels != 1)
+            {
+                break;
+            }
+
+            if (format == 3 && bits == 32)
+            {
+                samples.resize(size / sizeof(float));
+                ok = std::fread(samples.data(), sizeof(float), samples.size(),
+                    file) == samples.size();
+            }
+            else if (format == 1 && bits == 16)
+            {
+                std::vector<int16_t> pcm(size / sizeof(int16_t));
+                ok = std::fread(pcm.data(), sizeof(int16_t), pcm.size(), file)
+                    == pcm.size();
+                samples.resize(pcm.size());
+
+                for (size_t i = 0; i < pcm.size(); i++)
+                {
+                    samples[i] = pcm[i] / 32768.f;
+                }
+            }
+
+            break;
+        }
+        else
+        {
+            std::fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    std::fclose(file);
+    return ok;
+}
+
+}
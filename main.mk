@@ -36,7 +36,7 @@ DEFS := VARIANT_DELAY=$(VARIANT_DELAY) \
 	VARIANT_LINE_IN=$(VARIANT_LINE_IN) \
 	VARIANT_REVERSE=$(VARIANT_REVERSE)
 TARGET_DIR := $(BUILD_DIR)/artifact
-SUBMAKEFILES := app.mk
+SUBMAKEFILES := app.mk host/host.mk
 INCDIRS := .
 
 APP_ELF := $(TARGET_DIR)/app.elf
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+
+namespace recorder
+{
+
+// IMA ADPCM, as in IMA/DVI WAV files: four bits a sample, tracking the
+// signal with a predictor and an adaptive step. Encoder and decoder stay in
+// step by running the same update on each code, so a stream can start
+// anywhere given the predictor and step index it starts from.
+namespace adpcm
+{
+
+inline constexpr int16_t kStepTable[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+    963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+    3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+    24623, 27086, 29794, 32767,
+};
+
+inline constexpr int8_t kIndexTable[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+constexpr uint8_t kMaxIndex = 88;
+
+// The smallest step index that covers a difference between samples, to start
+// an encoder without the few samples of slew from the smallest step
+inline uint8_t StepIndex(int32_t difference)
+{
+    uint8_t index = 0;
+
+    while (index < kMaxIndex && kStepTable[index] < std::abs(difference))
+    {
+        index++;
+    }
+
+    return index;
+}
+
+class State
+{
+public:
+    void Init(int16_t predictor = 0, uint8_t index = 0)
+    {
+        predictor_ = predictor;
+        index_ = std::min(index, kMaxIndex);
+    }
+
+    int16_t predictor(void) const
+    {
+        return predictor_;
+    }
+
+    uint8_t index(void) const
+    {
+        return index_;
+    }
+
+protected:
+    int16_t predictor_;
+    uint8_t index_;
+
+    // Applies a code to the predictor and step, returning the new prediction
+    int16_t Update(uint8_t code)
+    {
+        int32_t step = kStepTable[index_];
+        int32_t delta = step >> 3;
+
+        if (code & 4) delta += step;
+        if (code & 2) delta += step >> 1;
+        if (code & 1) delta += step >> 2;
+
+        int32_t predictor = predictor_ + ((code & 8) ? -delta : delta);
+        predictor_ = std::clamp<int32_t>(predictor, INT16_MIN, INT16_MAX);
+        index_ = std::clamp<int32_t>(index_ + kIndexTable[code], 0, kMaxIndex);
+        return predictor_;
+    }
+};
+
+class Encoder : public State
+{
+public:
+    uint8_t Process(int16_t sample)
+    {
+        int32_t step = kStepTable[index_];
+        int32_t difference = sample - predictor_;
+        uint8_t code = 0;
+
+        if (difference < 0)
+        {
+            code = 8;
+            difference = -difference;
+        }
+
+        if (difference >= step)
+        {
+            code |= 4;
+            difference -= step;
+        }
+
+        step >>= 1;
+
+        if (difference >= step)
+        {
+            code |= 2;
+            difference -= step;
+        }
+
+        step >>= 1;
+
+        if (difference >= step)
+        {
+            code |= 1;
+        }
+
+        Update(code);
+        return code;
+    }
+};
+
+class Decoder : public State
+{
+public:
+    int16_t Process(uint8_t code)
+    {
+        return Update(code & 0xF);
+    }
+};
+
+}
+
+}
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <iterator>
+#include <algorithm>
 
 namespace recorder
 {
@@ -52,6 +53,58 @@ public:
         return dummy_;
     }
 
+    // Copies items into the chain from `index` on, a run per link, and
+    // returns how many fit
+    template <typename U>
+    uint32_t Write(size_t index, const U* items, uint32_t length)
+    {
+        uint32_t written = 0;
+
+        for (uint32_t i = 0; i < num_links_ && written < length; i++)
+        {
+            if (index < chain_[i].length)
+            {
+                uint32_t run = std::min<size_t>(length - written,
+                    chain_[i].length - index);
+                std::copy_n(items + written, run, chain_[i].buffer + index);
+                written += run;
+                index = 0;
+            }
+            else
+            {
+                index -= chain_[i].length;
+            }
+        }
+
+        return written;
+    }
+
+    // Copies items out of the chain from `index` on, a run per link, and
+    // returns how many there were
+    template <typename U>
+    uint32_t Read(size_t index, U* items, uint32_t length)
+    {
+        uint32_t read = 0;
+
+        for (uint32_t i = 0; i < num_links_ && read < length; i++)
+        {
+            if (index < chain_[i].length)
+            {
+                uint32_t run = std::min<size_t>(length - read,
+                    chain_[i].length - index);
+                std::copy_n(chain_[i].buffer + index, run, items + read);
+                read += run;
+                index = 0;
+            }
+            else
+            {
+                index -= chain_[i].length;
+            }
+        }
+
+        return read;
+    }
+
     uint32_t size(void)
     {
         return total_size_;
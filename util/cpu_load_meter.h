@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace recorder
+{
+
+// Measures the share of a periodic callback's period that it spends running,
+// after libDaisy's CpuLoadMeter: a smoothed average plus the extremes since
+// the last Reset(). Loads are fractions of the period, and exceed 1 when a
+// callback overran it. Timestamps are ticks of a free-running counter.
+class CpuLoadMeter
+{
+public:
+    void Init(float block_rate, float counter_frequency,
+        float smoothing_cutoff = 1)
+    {
+        period_inv_ = block_rate / counter_frequency;
+        smoothing_ = 1 - std::exp(-2 * kPi * smoothing_cutoff / block_rate);
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        avg_ = 0;
+        min_ = 0;
+        max_ = 0;
+        first_ = true;
+    }
+
+    void OnBlockStart(uint32_t now)
+    {
+        start_ = now;
+    }
+
+    void OnBlockEnd(uint32_t now)
+    {
+        float load = (now - start_) * period_inv_;
+
+        if (first_)
+        {
+            avg_ = min_ = max_ = load;
+            first_ = false;
+        }
+        else
+        {
+            avg_ += (load - avg_) * smoothing_;
+            min_ = std::min(min_, load);
+            max_ = std::max(max_, load);
+        }
+    }
+
+    float avg(void) const
+    {
+        return avg_;
+    }
+
+    float min(void) const
+    {
+        return min_;
+    }
+
+    float max(void) const
+    {
+        return max_;
+    }
+
+protected:
+    static constexpr float kPi = 3.141592653589793;
+    float period_inv_;
+    float smoothing_;
+    uint32_t start_;
+    float avg_;
+    float min_;
+    float max_;
+    bool first_;
+};
+
+}
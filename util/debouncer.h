@@ -5,25 +5,54 @@
 namespace recorder
 {
 
+// Switch debouncer, counting in ticks. Process() may run between ticks, so
+// that a change is seen as soon as it's sampled.
+//
+// MODE_INTEGRATE takes a change once the input has held it for `duration`
+// ticks in a row, so a glitch shorter than that is never seen. MODE_LEADING
+// takes the first change at once and ignores further changes until
+// `duration` ticks have passed, which outlasts the bounce: no added latency,
+// but a single-sample glitch registers. Keep it for inputs where the latency
+// matters.
 template <typename T>
 class Debouncer
 {
 public:
-    void Init(uint32_t duration, bool initial_state = false)
+    enum Mode
+    {
+        MODE_INTEGRATE,
+        MODE_LEADING,
+    };
+
+    void Init(uint32_t duration, bool initial_state = false,
+        Mode mode = MODE_INTEGRATE)
     {
         duration_ = duration;
+        mode_ = mode;
         count_ = 0;
         history_ = initial_state;
         state_ = initial_state;
     }
 
-    T Process(T in)
+    T Process(T in, bool tick = true)
     {
-        if (in != history_)
+        if (mode_ == MODE_LEADING)
+        {
+            if (count_)
+            {
+                count_ -= tick;
+            }
+            else if (in != state_)
+            {
+                state_ = in;
+                count_ = duration_;
+            }
+        }
+        else if (in != history_)
         {
             count_ = 0;
         }
-        else if (in != state_)
+        else if (in != state_ && tick)
         {
             if (++count_ == duration_)
             {
@@ -42,9 +71,10 @@ public:
 
 protected:
     uint32_t duration_;
+    Mode mode_;
     uint32_t count_;
     T history_;
     T state_;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+namespace recorder
+{
+
+// A word of event bits that interrupts post and the main loop takes. Posting
+// an event that is already pending merges with it, so an event means "look
+// again", not a count.
+class EventFlags
+{
+public:
+    void Init(void)
+    {
+        flags_.store(0, std::memory_order_relaxed);
+    }
+
+    // Any context
+    void Post(uint32_t events)
+    {
+        flags_.fetch_or(events, std::memory_order_release);
+    }
+
+    // Clears and returns the pending events among `mask`
+    uint32_t Take(uint32_t mask = UINT32_MAX)
+    {
+        return flags_.fetch_and(~mask, std::memory_order_acquire) & mask;
+    }
+
+    uint32_t pending(uint32_t mask = UINT32_MAX) const
+    {
+        return flags_.load(std::memory_order_relaxed) & mask;
+    }
+
+protected:
+    std::atomic<uint32_t> flags_;
+};
+
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace recorder
+{
+
+// Float-only approximations of the transcendental functions on the audio
+// paths, in place of libm (which works in double for some of them on the
+// device). Each is a minimax polynomial after a bit-level range reduction,
+// with no table and at most a select or two. Every function is constexpr as
+// well, so they can initialise constants.
+//
+// The max errors below are measured over the whole float range given (see
+// host/mathbench.cpp), and include float rounding.
+namespace fast
+{
+
+constexpr float kLog2e = 1.44269504;
+constexpr float kLog2_10 = 3.32192809;
+constexpr float kLog10_2 = 0.301029996;
+constexpr float kTwoPi = 6.28318531;
+
+namespace detail
+{
+
+// x as m * 2^e, with m in [1, 2), for positive normal x
+constexpr float Split(float x, int32_t& e)
+{
+    if (std::is_constant_evaluated())
+    {
+        e = 0;
+
+        while (x >= 2)
+        {
+            x *= 0.5f;
+            e++;
+        }
+
+        while (x < 1)
+        {
+            x *= 2;
+            e--;
+        }
+
+        return x;
+    }
+
+    uint32_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(bits));
+    e = int32_t((bits >> 23) & 0xFF) - 127;
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// m * 2^e, for m in [1, 2) and e in [-126, 127]
+constexpr float Scale(float m, int32_t e)
+{
+    if (std::is_constant_evaluated())
+    {
+        for (; e > 0; e--)
+        {
+            m *= 2;
+        }
+
+        for (; e < 0; e++)
+        {
+            m *= 0.5f;
+        }
+
+        return m;
+    }
+
+    uint32_t bits = 0;
+    std::memcpy(&bits, &m, sizeof(bits));
+    bits += uint32_t(e) << 23;
+    std::memcpy(&m, &bits, sizeof(m));
+    return m;
+}
+
+}
+
+// 2^x. Max relative error 2e-7; x is clamped to [-126, 127].
+constexpr float Exp2(float x)
+{
+    x = std::clamp(x, -126.f, 127.f);
+    int32_t i = int32_t(x);
+    i -= (x < float(i));
+    float f = x - float(i);
+    // The constant term is exactly 1, so that integer x gives an exact
+    // power of two (a pitch of 0 plays at exactly unity speed)
+    float p = 0.00186713005f;
+    p = p * f + 0.00901703071f;
+    p = p * f + 0.0557999127f;
+    p = p * f + 0.240164444f;
+    p = p * f + 0.693151295f;
+    p = p * f + 1;
+    // p is within [1, 2) except for rounding at the top end
+    return detail::Scale(std::min(p, 1.99999988f), i);
+}
+
+// log2(|x|) for normal x; 0 gives -127. Max error 5e-7, absolute while the
+// result is within +-1 and relative beyond.
+constexpr float Log2(float x)
+{
+    x = x < 0 ? -x : x;
+
+    if (x == 0)
+    {
+        return -127;
+    }
+
+    int32_t e = 0;
+    float u = detail::Split(x, e) - 1;
+    float p = 0.0155299173f;
+    p = p * u - 0.0795577308f;
+    p = p * u + 0.194294322f;
+    p = p * u - 0.325901974f;
+    p = p * u + 0.473553411f;
+    p = p * u - 0.720585469f;
+    p = p * u + 1.44266783f;
+    return float(e) + p * u;
+}
+
+// 10^x. Max relative error 1.5e-6 for x in [-6, 6] (+-120 dB as gains); the
+// scaling of x adds rounding error in proportion to |x|.
+constexpr float Pow10(float x)
+{
+    return Exp2(x * kLog2_10);
+}
+
+// log10(|x|), as Log2(). Max error 2.5e-7.
+constexpr float Log10(float x)
+{
+    return Log2(x) * kLog10_2;
+}
+
+// e^x. Max relative error 7e-7 for x in [-10, 10], and 4e-6 in [-80, 80].
+constexpr float Exp(float x)
+{
+    return Exp2(x * kLog2e);
+}
+
+// tanh(x). Max absolute error 2.5e-7.
+constexpr float Tanh(float x)
+{
+    return 1 - 2 / (Exp2(x * (2 * kLog2e)) + 1);
+}
+
+// sin(x), x in radians. Max absolute error 1e-6 for x in [-2 pi, 2 pi]; the
+// range reduction adds about 1.5e-7 * |x| beyond that.
+constexpr float Sin(float x)
+{
+    float t = x * (1 / kTwoPi);
+    t -= float(int32_t(t + (t < 0 ? -0.5f : 0.5f)));
+    // Fold [-1/2, 1/2] turn onto [-1/4, 1/4], where sin is odd
+    t = t > 0.25f ? 0.5f - t : (t < -0.25f ? -0.5f - t : t);
+    float t2 = t * t;
+    float p = 39.8732318f;
+    p = p * t2 - 76.5982079f;
+    p = p * t2 + 81.6032657f;
+    p = p * t2 - 41.3416919f;
+    p = p * t2 + 6.2831853f;
+    return p * t;
+}
+
+// cos(x), as Sin()
+constexpr float Cos(float x)
+{
+    return Sin(x + kTwoPi / 4);
+}
+
+// tan(x), for x in (-pi / 2, pi / 2), as the bilinear transform's frequency
+// warping needs. Max relative error 1e-6 for |x| <= 1.5.
+constexpr float Tan(float x)
+{
+    // cos(x) as sin(pi / 2 - |x|), which keeps its relative accuracy near
+    // pi / 2 better than Cos()'s own reduction
+    return Sin(x) / Sin(kTwoPi / 4 - (x < 0 ? -x : x));
+}
+
+}
+
+}
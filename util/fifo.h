@@ -28,6 +28,7 @@
 
 #include <cstdint>
 #include <atomic>
+#include <algorithm>
 
 namespace recorder
 {
@@ -73,28 +74,88 @@ public:
         return tail - head >= size;
     }
 
+    // Up to two contiguous runs of slots, the second wrapping around to the
+    // start of the buffer
+    struct Span
+    {
+        T* data[2];
+        uint32_t length[2];
+
+        uint32_t total(void) const
+        {
+            return length[0] + length[1];
+        }
+    };
+
     bool Push(T item)
     {
         return Push(&item, 1);
     }
 
-    bool Push(T* buffer, uint32_t length)
+    // Pushes all of the buffer, or nothing if it doesn't fit
+    bool Push(const T* buffer, uint32_t length)
     {
-        uint32_t tail = tail_.load(std::memory_order_relaxed);
-        uint32_t head = head_.load(std::memory_order_acquire);
+        Span span = AcquireWrite(length);
 
-        if (tail - head > size - length)
+        if (span.total() < length)
         {
             return false;
         }
 
-        for (uint32_t i = 0; i < length; i++)
-        {
-            data_[(tail + i) % size] = buffer[i];
-        }
+        Copy(buffer, span);
+        CommitWrite(length);
+        return true;
+    }
 
+    // Pushes as much of the buffer as fits, returning how much
+    uint32_t PushSpan(const T* buffer, uint32_t length)
+    {
+        Span span = AcquireWrite(length);
+        Copy(buffer, span);
+        CommitWrite(span.total());
+        return span.total();
+    }
+
+    // Pops up to `length` items, returning how many
+    uint32_t PopSpan(T* buffer, uint32_t length)
+    {
+        Span span = AcquireRead(length);
+        std::copy_n(span.data[0], span.length[0], buffer);
+        std::copy_n(span.data[1], span.length[1], buffer + span.length[0]);
+        Release(span.total());
+        return span.total();
+    }
+
+    // Producer: up to `length` free slots to fill in place, published by
+    // CommitWrite()
+    Span AcquireWrite(uint32_t length = size)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        return Segments(tail, std::min(length, size - (tail - head)));
+    }
+
+    // Producer: publishes the first `length` slots of the last AcquireWrite()
+    void CommitWrite(uint32_t length)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
         tail_.store(tail + length, std::memory_order_release);
-        return true;
+    }
+
+    // Consumer: up to `length` queued items to read in place, freed by
+    // Release()
+    Span AcquireRead(uint32_t length = size)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        return Segments(head, std::min(length, tail - head));
+    }
+
+    // Consumer: frees the first `length` items of the last AcquireRead()
+    void Release(uint32_t length)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        head_.store(head + length, std::memory_order_release);
     }
 
     bool Peek(T& item)
@@ -131,6 +192,20 @@ public:
         T item;
         return Pop(item);
     }
+
+protected:
+    Span Segments(uint32_t position, uint32_t length)
+    {
+        uint32_t index = position % size;
+        uint32_t first = std::min(length, size - index);
+        return {{data_ + index, data_}, {first, length - first}};
+    }
+
+    static void Copy(const T* buffer, const Span& span)
+    {
+        std::copy_n(buffer, span.length[0], span.data[0]);
+        std::copy_n(buffer + span.length[0], span.length[1], span.data[1]);
+    }
 };
 
 }
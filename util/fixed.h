@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#if defined(__ARM_FEATURE_SAT) || defined(__ARM_FEATURE_DSP) || \
+    defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+namespace recorder
+{
+
+// Fixed point arithmetic for the engines' sample types. The primitives are
+// the Cortex-M7's DSP instructions (SSAT, QADD, QSUB, SMLAD, SMLALD, SMLAL)
+// where the target has them, and portable emulations with the same results
+// elsewhere, so the host tools measure what the device computes.
+namespace fixed
+{
+
+// x saturated to a kBits bit signed integer (SSAT)
+template <int kBits>
+inline int32_t Saturate(int32_t x)
+{
+    static_assert(kBits > 0 && kBits <= 32);
+#if defined(__ARM_FEATURE_SAT)
+    return __ssat(x, kBits);
+#else
+    constexpr int64_t kMax = (int64_t(1) << (kBits - 1)) - 1;
+    return std::clamp<int64_t>(x, -kMax - 1, kMax);
+#endif
+}
+
+template <int kBits>
+inline int32_t Saturate(int64_t x)
+{
+    static_assert(kBits > 0 && kBits <= 32);
+    constexpr int64_t kMax = (int64_t(1) << (kBits - 1)) - 1;
+    return std::clamp<int64_t>(x, -kMax - 1, kMax);
+}
+
+// Saturating a + b (QADD)
+inline int32_t Add(int32_t a, int32_t b)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return __qadd(a, b);
+#else
+    return Saturate<32>(int64_t(a) + b);
+#endif
+}
+
+// Saturating a - b (QSUB)
+inline int32_t Subtract(int32_t a, int32_t b)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return __qsub(a, b);
+#else
+    return Saturate<32>(int64_t(a) - b);
+#endif
+}
+
+// Two 16 bit values in one word, `low` in the bottom half
+inline uint32_t Pack(int16_t low, int16_t high)
+{
+    return uint16_t(low) | (uint32_t(uint16_t(high)) << 16);
+}
+
+// The two 16 bit values at p, in one load
+inline uint32_t LoadPair(const void* p)
+{
+    uint32_t pair;
+    std::memcpy(&pair, p, sizeof(pair));
+    return pair;
+}
+
+namespace detail
+{
+
+inline int32_t Low(uint32_t pair)
+{
+    return int16_t(pair);
+}
+
+inline int32_t High(uint32_t pair)
+{
+    return int16_t(pair >> 16);
+}
+
+}
+
+// acc + the products of the halves of x and y (SMLAD). The 32 bit sum wraps,
+// so it has 1 bit of headroom over a pair of Q15 by Q15 products.
+inline int32_t DualMultiplyAccumulate(uint32_t x, uint32_t y, int32_t acc)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+    return __smlad(x, y, acc);
+#else
+    return int32_t(uint32_t(acc) + uint32_t(detail::Low(x) * detail::Low(y)) +
+        uint32_t(detail::High(x) * detail::High(y)));
+#endif
+}
+
+// As DualMultiplyAccumulate(), into a 64 bit sum (SMLALD)
+inline int64_t DualMultiplyAccumulateLong(uint32_t x, uint32_t y, int64_t acc)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+    return __smlald(x, y, acc);
+#else
+    return acc + int64_t(detail::Low(x) * detail::Low(y)) +
+        int64_t(detail::High(x) * detail::High(y));
+#endif
+}
+
+// acc + x * y, into a 64 bit sum (SMLAL). There's no intrinsic for it, as
+// the compiler makes one SMLAL of the widening multiply and add
+inline int64_t MultiplyAccumulateLong(int32_t x, int32_t y, int64_t acc)
+{
+    return acc + int64_t(x) * y;
+}
+
+}
+
+// A fraction in [-1, 1) stored in Raw, a signed integer type: Q15 in 16
+// bits, Q31 in 32. Conversion from float rounds to nearest, and the
+// arithmetic saturates rather than wrapping. Multiplication rounds.
+template <typename Raw>
+class Fixed
+{
+public:
+    static constexpr int kFractionBits = std::numeric_limits<Raw>::digits;
+    static constexpr float kScale = float(int64_t(1) << kFractionBits);
+
+    Fixed() = default;
+
+    explicit Fixed(float x)
+    {
+        // The largest float below 1 in the format: 2^31 isn't exact below
+        // it, and a step of 128 is the nearest that is
+        constexpr float kMax = kScale - ((kFractionBits > 24) ? 128 : 1);
+        x = std::clamp(x * kScale, -kScale, kMax);
+        raw_ = int32_t(x + ((x < 0) ? -0.5f : 0.5f));
+    }
+
+    static Fixed FromRaw(Raw raw)
+    {
+        Fixed f;
+        f.raw_ = raw;
+        return f;
+    }
+
+    Raw raw(void) const
+    {
+        return raw_;
+    }
+
+    explicit operator float(void) const
+    {
+        return raw_ * (1 / kScale);
+    }
+
+    Fixed operator+(Fixed other) const
+    {
+        if constexpr (sizeof(Raw) == 4)
+        {
+            return FromRaw(fixed::Add(raw_, other.raw_));
+        }
+
+        return FromRaw(Narrow(Wide(raw_) + other.raw_));
+    }
+
+    Fixed operator-(Fixed other) const
+    {
+        if constexpr (sizeof(Raw) == 4)
+        {
+            return FromRaw(fixed::Subtract(raw_, other.raw_));
+        }
+
+        return FromRaw(Narrow(Wide(raw_) - other.raw_));
+    }
+
+    Fixed operator-(void) const
+    {
+        return FromRaw(Narrow(-Wide(raw_)));
+    }
+
+    Fixed operator*(Fixed other) const
+    {
+        constexpr Wide kHalf = Wide(1) << (kFractionBits - 1);
+        return FromRaw(Narrow((Wide(raw_) * other.raw_ + kHalf) >>
+            kFractionBits));
+    }
+
+    Fixed& operator+=(Fixed other)
+    {
+        return *this = *this + other;
+    }
+
+    Fixed& operator-=(Fixed other)
+    {
+        return *this = *this - other;
+    }
+
+    Fixed& operator*=(Fixed other)
+    {
+        return *this = *this * other;
+    }
+
+    bool operator==(const Fixed& other) const = default;
+
+protected:
+    // Holds any sum, difference or product before it's narrowed back
+    using Wide = std::conditional_t<sizeof(Raw) <= 2, int32_t, int64_t>;
+
+    Raw raw_;
+
+    static Raw Narrow(Wide x)
+    {
+        return fixed::Saturate<kFractionBits + 1>(x);
+    }
+};
+
+using Q15 = Fixed<int16_t>;
+using Q31 = Fixed<int32_t>;
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+namespace recorder
+{
+
+// Measures the time from an input edge to the response to it: the last
+// latency, a smoothed average and the maximum since Reset(), in seconds.
+// Timestamps are ticks of a free-running counter.
+class LatencyMeter
+{
+public:
+    void Init(float counter_frequency)
+    {
+        period_ = 1 / counter_frequency;
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        last_ = 0;
+        avg_ = 0;
+        max_ = 0;
+        first_ = true;
+        pending_ = false;
+    }
+
+    // An edge at `time`. While one is pending, later edges (bounces) are
+    // ignored.
+    void Start(uint32_t time)
+    {
+        if (!pending_)
+        {
+            start_ = time;
+            pending_ = true;
+        }
+    }
+
+    // The response to the pending edge, if there is one
+    void Stop(uint32_t now)
+    {
+        if (!pending_)
+        {
+            return;
+        }
+
+        float latency = (now - start_) * period_;
+        pending_ = false;
+        last_ = latency;
+
+        if (first_)
+        {
+            avg_ = max_ = latency;
+            first_ = false;
+        }
+        else
+        {
+            avg_ += (latency - avg_) * kSmoothing;
+            max_ = std::max(max_, latency);
+        }
+    }
+
+    // Forgets a pending edge that had no response
+    void Cancel(void)
+    {
+        pending_ = false;
+    }
+
+    float last(void) const
+    {
+        return last_;
+    }
+
+    float avg(void) const
+    {
+        return avg_;
+    }
+
+    float max(void) const
+    {
+        return max_;
+    }
+
+protected:
+    static constexpr float kSmoothing = 0.125;
+    float period_;
+    uint32_t start_;
+    float last_;
+    float avg_;
+    float max_;
+    bool first_;
+    bool pending_;
+};
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "util/fast_math.h"
+
+// Linearly interpolated lookup tables for the oscillators, fades and
+// resampling kernels, which are computed at compile time and shared by every
+// user.
+//
+// The tables live in the .lut.* sections, which the firmware's linker script
+// places in DTCM with the initialised data: the fades are read from the
+// audio DMA interrupt, and DTCM reads take a single cycle without relying on
+// the cache. The oscillator and fade tables take 4 KB there, and as much
+// flash for their initial values; each sinc table takes 2 or 4 KB more of
+// each, but only if a resampler uses it.
+//
+// The max errors below include float rounding; host/mathbench measures them.
+namespace recorder::lut
+{
+
+// f(x) sampled at N + 1 points over [0, 1]
+template <uint32_t N>
+class Table
+{
+public:
+    static constexpr uint32_t kSize = N;
+
+    template <typename F>
+    constexpr Table(F f) : data_{}
+    {
+        for (uint32_t i = 0; i <= N; i++)
+        {
+            data_[i] = f(float(i) / N);
+        }
+    }
+
+    // x in [0, 1]; outside that, x is clamped
+    constexpr float Clamped(float x) const
+    {
+        x = std::clamp<float>(x, 0, 1) * N;
+        uint32_t i = std::min(uint32_t(x), N - 1);
+        return Interpolate(i, x - float(i));
+    }
+
+    // x in turns of a periodic f; N must be a power of 2
+    constexpr float Wrapped(float x) const
+    {
+        static_assert((N & (N - 1)) == 0);
+        x *= N;
+        int32_t i = int32_t(x);
+        i -= (x < float(i));
+        return Interpolate(uint32_t(i) & (N - 1), x - float(i));
+    }
+
+protected:
+    float data_[N + 1];
+
+    constexpr float Interpolate(uint32_t i, float fraction) const
+    {
+        return data_[i] + (data_[i + 1] - data_[i]) * fraction;
+    }
+};
+
+// One section each, since the linker keeps or drops an inline variable with
+// the whole section it's in
+__attribute__ ((section (".lut.sine")))
+inline constexpr Table<512> kSine{[](float x)
+{
+    return fast::Sin(x * fast::kTwoPi);
+}};
+
+__attribute__ ((section (".lut.raised_cosine")))
+inline constexpr Table<256> kRaisedCosine{[](float x)
+{
+    return 0.5f * (1 - fast::Cos(x * (fast::kTwoPi / 2)));
+}};
+
+__attribute__ ((section (".lut.equal_power")))
+inline constexpr Table<256> kEqualPower{[](float x)
+{
+    return fast::Sin(x * (fast::kTwoPi / 4));
+}};
+
+// Points per sample in the sinc tables
+inline constexpr uint32_t kSincPhases = 128;
+
+namespace detail
+{
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser window
+constexpr float BesselI0(float x)
+{
+    float sum = 1;
+    float term = 1;
+
+    for (uint32_t k = 1; k < 32; k++)
+    {
+        term *= (0.5f * x / k) * (0.5f * x / k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+// Kaiser-windowed sinc, with x in [0, 1] spanning the half of the kernel from
+// its centre out to kTaps / 2 samples. The cutoff is at the Nyquist
+// frequency, so a kernel centred on a sample passes it through unchanged.
+// The window is designed for a transition band 1/4 of the sampling rate wide
+// around the cutoff, which passes the 6 kHz band the 16 kHz recordings are
+// filtered to, and leaves 37 dB of stopband for 8 taps and 65 dB for 16.
+template <uint32_t kTaps>
+constexpr float WindowedSinc(float x)
+{
+    float attenuation = 14.36f * 0.25f * kTaps + 7.95f;
+    float beta = (attenuation > 50) ?
+        0.1102f * (attenuation - 8.7f) :
+        0.5842f * std::pow(attenuation - 21, 0.4f) +
+            0.07886f * (attenuation - 21);
+
+    float t = x * (kTaps / 2);
+    float whole = std::round(t);
+
+    if (t == whole)
+    {
+        return (t == 0) ? 1 : 0;
+    }
+
+    // sin(pi t), reduced to [0, 2 pi)
+    float sine = fast::Sin((fast::kTwoPi / 2) * (t - 2 * std::floor(t / 2)));
+    float sinc = sine / ((fast::kTwoPi / 2) * t);
+    float window = BesselI0(beta * std::sqrt(1 - x * x)) / BesselI0(beta);
+    return sinc * window;
+}
+
+}
+
+// Half kernels for SincKernel<8> and SincKernel<16> (app/engine/resampling_kernel.h)
+__attribute__ ((section (".lut.sinc8")))
+inline constexpr Table<4 * kSincPhases> kSinc8{detail::WindowedSinc<8>};
+
+__attribute__ ((section (".lut.sinc16")))
+inline constexpr Table<8 * kSincPhases> kSinc16{detail::WindowedSinc<16>};
+
+// sin(2 pi phase), for any phase. Max absolute error 2e-5.
+inline float Sine(float phase)
+{
+    return kSine.Wrapped(phase);
+}
+
+// cos(2 pi phase), as Sine()
+inline float Cosine(float phase)
+{
+    return kSine.Wrapped(phase + 0.25f);
+}
+
+// Fade-in gain 0.5 * (1 - cos(pi tau)), with tau clamped to [0, 1]. Max
+// absolute error 1e-5.
+inline float RaisedCosine(float tau)
+{
+    return kRaisedCosine.Clamped(tau);
+}
+
+// Equal-power crossfade gain sin(pi / 2 * tau) for the incoming signal, with
+// tau clamped to [0, 1]; the outgoing one takes EqualPower(1 - tau). Max
+// absolute error 5e-6.
+inline float EqualPower(float tau)
+{
+    return kEqualPower.Clamped(tau);
+}
+
+}
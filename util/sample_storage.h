@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "util/fixed.h"
+
+namespace recorder
+{
+
+// Storage formats for audio buffers, so that a buffer's owner can trade
+// precision for RAM with a template argument. Each one converts samples to
+// and from float one at a time, and encodes blocks for span writes in plain
+// loops the compiler can unroll or vectorise.
+
+// 32 bit float: exact
+struct FloatStorage
+{
+    using Sample = float;
+
+    static Sample Encode(float x)
+    {
+        return x;
+    }
+
+    static float Decode(Sample s)
+    {
+        return s;
+    }
+
+    static void Encode(const float* in, Sample* out, uint32_t size)
+    {
+        std::copy(in, in + size, out);
+    }
+};
+
+// 16 bit half float, as SampleMemory stores recordings: 11 significant bits
+// at any level, so about 66 dB of SNR however quiet the signal.
+struct HalfStorage
+{
+    using Sample = __fp16;
+
+    static Sample Encode(float x)
+    {
+        return Sample(x);
+    }
+
+    static float Decode(Sample s)
+    {
+        return float(s);
+    }
+
+    static void Encode(const float* in, Sample* out, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            out[i] = Sample(in[i]);
+        }
+    }
+};
+
+// 16 bit fixed point over [-kFullScale, kFullScale), saturating beyond it: Q15
+// (util/fixed.h) scaled by kFullScale, a power of 2. A fixed step of
+// kFullScale / 32768, so 96 dB of SNR at full scale, falling with the level.
+template <int32_t kFullScale = 1>
+struct Q15Storage
+{
+    using Sample = int16_t;
+
+    static Sample Encode(float x)
+    {
+        return Q15(x * (1.f / kFullScale)).raw();
+    }
+
+    static float Decode(Sample s)
+    {
+        return float(Q15::FromRaw(s)) * kFullScale;
+    }
+
+    static void Encode(const float* in, Sample* out, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            out[i] = Encode(in[i]);
+        }
+    }
+};
+
+}